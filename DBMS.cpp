@@ -3,9 +3,45 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 #include <algorithm>
+#include <limits>
 #include <fstream>
 #include <iomanip>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <memory>
+#include <deque>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <strings.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "DBMS.h"
 
 using namespace std;
 
@@ -16,570 +52,8068 @@ struct TableSchema {
     vector<string> columnTypes;
 };
 
-// 테이블 데이터를 메모리에 저장할 구조체
+// 컬럼의 물리 저장 타입
+enum class ColumnType {
+    Int,    // int64_t 배열
+    Float,  // double 배열
+    Date,   // YYYYMMDD 형태의 int32_t 배열
+    String  // 오프셋 + 연속 버퍼 (string 및 알 수 없는 타입)
+};
+
+// 스키마의 타입 이름을 물리 저장 타입으로 변환하는 함수
+ColumnType toColumnType(const string& typeName) {
+    if (typeName == "int") return ColumnType::Int;
+    if (typeName == "float") return ColumnType::Float;
+    if (typeName == "date") return ColumnType::Date;
+    return ColumnType::String;
+}
+
+// ---- 버퍼 풀 ----
+// .mydb 파일은 mmap으로 열고, 스캔이 처음 읽는 kPageBytes 단위 페이지를 버퍼 풀에 올림
+// 풀이 가득 차면 CLOCK으로 오래 쓰지 않은 페이지를 골라 매핑에서 내리고 (MADV_DONTNEED, 다시 읽으면 파일에서 읽음)
+// 새로 올리는 페이지는 MADV_WILLNEED로 미리 읽음. 커널의 미리 읽기는 끄므로 (MADV_RANDOM) 메모리에 남는 파일 페이지는 풀 크기 이하
+// 파일에 아직 쓰지 않은 행(INSERT / COPY / UPDATE로 메모리에만 있는 배열)은 dirty 페이지로 세고,
+// 체크포인트가 파일에 쓴 뒤 테이블이 새 파일을 가리키게 하면 다시 풀에서 내릴 수 있는 페이지가 됨
+const size_t kPageBytes = 64 << 10;
+const uint32_t kNoFrame = UINT32_MAX;
+
+// mmap으로 연 파일 영역 (마지막 참조가 사라질 때 해제)
+struct MappedFile {
+    void* base = nullptr;
+    size_t size = 0;
+    vector<uint32_t> frames; // 페이지별 버퍼 풀 프레임 번호 (올라와 있지 않으면 kNoFrame, bufferPool이 잠그고 사용)
+
+    ~MappedFile();
+};
+
+// 버퍼 풀 크기 (MB)
+// 환경 변수 DBMS_BUFFER_POOL_MB로 지정할 수 있고, 없으면 물리 메모리의 절반
+size_t defaultBufferPoolMegabytes() {
+    const char* forced = getenv("DBMS_BUFFER_POOL_MB");
+    if (forced != nullptr && atoll(forced) > 0) return static_cast<size_t>(atoll(forced));
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGE_SIZE);
+    if (pages <= 0 || pageSize <= 0) return 1024;
+    return max<size_t>(1, static_cast<size_t>(pages) / 2 * static_cast<size_t>(pageSize) >> 20);
+}
+
+class BufferPool {
+public:
+    struct Stats {
+        size_t capacity = 0; // 페이지 수
+        size_t resident = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    BufferPool() : capacity_(defaultBufferPoolMegabytes() * ((1 << 20) / kPageBytes)) {}
+
+    // 매핑 안의 [begin, begin + bytes) 영역을 읽기 전에 호출: 페이지마다 hit이면 참조 표시, miss이면 올림
+    void touch(MappedFile& file, const void* begin, size_t bytes) {
+        if (bytes == 0) return;
+        size_t offset = static_cast<const char*>(begin) - static_cast<const char*>(file.base);
+        size_t first = offset / kPageBytes;
+        size_t last = (offset + bytes - 1) / kPageBytes;
+        lock_guard<mutex> lock(mutex_);
+        for (size_t page = first; page <= last && page < file.frames.size(); ++page) {
+            uint32_t frame = file.frames[page];
+            if (frame != kNoFrame) {
+                frames_[frame].referenced = true;
+                ++hits_;
+                continue;
+            }
+            ++misses_;
+            while (resident_ >= capacity_) evictOne();
+            if (free_.empty()) {
+                free_.push_back(static_cast<uint32_t>(frames_.size()));
+                frames_.emplace_back();
+            }
+            frame = free_.back();
+            free_.pop_back();
+            frames_[frame] = Frame{&file, page, true};
+            file.frames[page] = frame;
+            ++resident_;
+            madvise(pageAddress(file, page), pageLength(file, page), MADV_WILLNEED);
+        }
+    }
+
+    // 매핑이 해제될 때 그 파일의 프레임을 모두 비움
+    void release(MappedFile& file) {
+        lock_guard<mutex> lock(mutex_);
+        for (uint32_t& frame : file.frames) {
+            if (frame == kNoFrame) continue;
+            frames_[frame].file = nullptr;
+            free_.push_back(frame);
+            frame = kNoFrame;
+            --resident_;
+        }
+    }
+
+    // SET BUFFER_POOL mb: 줄이면 넘치는 페이지를 바로 내림
+    void setCapacity(size_t pages) {
+        lock_guard<mutex> lock(mutex_);
+        capacity_ = max<size_t>(1, pages);
+        while (resident_ > capacity_) evictOne();
+    }
+
+    Stats stats() const {
+        lock_guard<mutex> lock(mutex_);
+        return Stats{capacity_, resident_, hits_, misses_, evictions_};
+    }
+
+private:
+    struct Frame {
+        MappedFile* file = nullptr; // 비어 있으면 nullptr
+        size_t page = 0;
+        bool referenced = false; // CLOCK 참조 비트
+    };
+
+    static char* pageAddress(const MappedFile& file, size_t page) { return static_cast<char*>(file.base) + page * kPageBytes; }
+    static size_t pageLength(const MappedFile& file, size_t page) { return min(kPageBytes, file.size - page * kPageBytes); }
+
+    // 시계 바늘을 돌리며 참조 비트가 꺼진 첫 페이지를 내림 (켜져 있으면 끄고 지나감)
+    void evictOne() {
+        while (true) {
+            uint32_t index = static_cast<uint32_t>(hand_);
+            Frame& frame = frames_[index];
+            hand_ = (hand_ + 1) % frames_.size();
+            if (frame.file == nullptr) continue;
+            if (frame.referenced) {
+                frame.referenced = false;
+                continue;
+            }
+            madvise(pageAddress(*frame.file, frame.page), pageLength(*frame.file, frame.page), MADV_DONTNEED);
+            frame.file->frames[frame.page] = kNoFrame;
+            frame.file = nullptr;
+            free_.push_back(index);
+            --resident_;
+            ++evictions_;
+            return;
+        }
+    }
+
+    mutable mutex mutex_;
+    vector<Frame> frames_;
+    vector<uint32_t> free_; // 비어 있는 프레임 번호
+    size_t hand_ = 0;
+    size_t capacity_;
+    size_t resident_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+BufferPool bufferPool;
+
+MappedFile::~MappedFile() {
+    bufferPool.release(*this);
+    if (base != nullptr) munmap(base, size);
+}
+
+// 타입별 연속 배열
+// 직접 소유한 vector이거나, mmap된 파일 영역 / 다른 배열의 버퍼를 그대로 가리키는 읽기 전용 뷰
+// 뷰 상태에서 수정이 일어나면 그 시점에 한 번 복사해서 소유함 (copy-on-write)
+// 소유한 버퍼를 뷰가 같이 쓰고 있으면 뷰가 보는 값은 바꾸지 않음: 끝에 추가할 자리가 있으면 그대로 이어 쓰고,
+// 모자라거나 기존 값을 바꿀 때는 새 버퍼로 옮김 (예전 버퍼는 마지막 뷰가 사라질 때 해제)
+// 버퍼를 가리키는 뷰의 수는 pins로 셈: 뷰는 table latch를 공유로 잡고 만들고, 다른 스레드에서 놓을 때 release로 빼며,
+// 소유한 쪽은 acquire로 0을 확인한 뒤에만 제자리에서 쓰거나 버퍼를 늘리므로 뷰의 마지막 읽기가 그 쓰기보다 먼저임
+template <typename T>
+class ColumnArray {
+public:
+    ColumnArray() = default;
+    ColumnArray(const ColumnArray& other) { *this = other; }
+    ColumnArray(ColumnArray&& other) noexcept { *this = move(other); }
+
+    ColumnArray& operator=(const ColumnArray& other) {
+        if (this == &other) return *this;
+        keep_ = other.keep_;
+        owned_ = other.owned_ ? make_shared<Owned>(other.owned_->values) : nullptr;
+        file_ = other.file_;
+        data_ = owned_ ? owned_->values.data() : other.data_;
+        size_ = other.size_;
+        return *this;
+    }
+
+    ColumnArray& operator=(ColumnArray&& other) noexcept {
+        if (this == &other) return *this;
+        keep_ = move(other.keep_);
+        owned_ = move(other.owned_);
+        file_ = other.file_;
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        return *this;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T* data() const { return data_; }
+    const T& operator[](size_t i) const { return data_[i]; }
+    const T& back() const { return data_[size_ - 1]; }
+
+    T* mutableData() {
+        makeUnique();
+        return owned_->values.data();
+    }
+
+    // 뷰와 공유 중이어도 복사하지 않고 값을 바꾸는 포인터 (뷰가 읽는 중일 수 있으므로 원자적으로 써야 함)
+    T* sharedMutableData() {
+        materialize();
+        return owned_->values.data();
+    }
+
+    void push_back(const T& value) {
+        reserveShared(1);
+        owned_->values.push_back(value);
+        sync();
+    }
+
+    void append(const T* values, size_t count) {
+        reserveShared(count);
+        owned_->values.insert(owned_->values.end(), values, values + count);
+        sync();
+    }
+
+    void resize(size_t count) {
+        if (count < size_) {
+            makeUnique();
+        } else {
+            reserveShared(count - size_);
+        }
+        owned_->values.resize(count);
+        sync();
+    }
+
+    void assign(size_t count, const T& value) {
+        keep_.reset();
+        file_ = nullptr;
+        owned_ = make_shared<Owned>(vector<T>(count, value));
+        sync();
+    }
+
+    void clear() { assign(0, T()); }
+
+    // mmap된 파일 영역을 복사 없이 그대로 사용
+    void attach(shared_ptr<MappedFile> mapping, const T* values, size_t count) {
+        owned_.reset();
+        file_ = mapping.get();
+        keep_ = move(mapping);
+        data_ = values;
+        size_ = count;
+    }
+
+    // 지금 값을 복사 없이 가리키는 읽기 전용 뷰 (이 배열이 나중에 바뀌어도 뷰의 값은 그대로)
+    ColumnArray view() const {
+        ColumnArray result;
+        if (owned_) {
+            owned_->pins.fetch_add(1, memory_order_relaxed);
+            shared_ptr<Owned> buffer = owned_;
+            result.keep_ = shared_ptr<const void>(buffer.get(), [buffer](const void*) { buffer->pins.fetch_sub(1, memory_order_release); });
+        } else {
+            result.keep_ = keep_;
+        }
+        result.file_ = file_;
+        result.data_ = data_;
+        result.size_ = size_;
+        return result;
+    }
+
+    // 파일에 매핑된 배열이면 [first, first + count) 구간을 읽기 전에 버퍼 풀에 알림
+    void touch(size_t first, size_t count) const {
+        if (file_ != nullptr && count > 0) bufferPool.touch(*file_, data_ + first, count * sizeof(T));
+    }
+
+    // 파일에 없이 메모리에만 있는 바이트 수 (dirty)
+    size_t dirtyBytes() const { return owned_ ? owned_->values.size() * sizeof(T) : 0; }
+
+    // 파일 매핑을 (뷰이면 원본 배열을) 그대로 읽는 바이트 수
+    size_t mappedBytes() const { return owned_ ? 0 : size_ * sizeof(T); }
+
+private:
+    // 직접 소유한 값과 그 값을 가리키는 뷰의 수
+    struct Owned {
+        explicit Owned(vector<T> initial) : values(move(initial)) {}
+        vector<T> values;
+        atomic<int> pins{0};
+    };
+
+    // 소유한 버퍼를 가리키는 뷰가 없는지 (0을 보면 놓은 뷰들의 읽기가 이후의 쓰기보다 앞섬)
+    bool unpinned() const { return owned_->pins.load(memory_order_acquire) == 0; }
+
+    void materialize() {
+        if (owned_) return;
+        owned_ = make_shared<Owned>(vector<T>(data_, data_ + size_));
+        keep_.reset();
+        file_ = nullptr;
+        sync();
+    }
+
+    // 뷰가 같은 버퍼를 보고 있으면 복사본으로 옮김
+    void makeUnique() {
+        materialize();
+        if (!unpinned()) owned_ = make_shared<Owned>(owned_->values);
+        sync();
+    }
+
+    // 뷰가 같은 버퍼를 보고 있는데 extra개를 더 넣을 자리가 없으면 두 배 크기의 새 버퍼로 옮김
+    void reserveShared(size_t extra) {
+        materialize();
+        if (size_ + extra <= owned_->values.capacity() || unpinned()) return;
+        vector<T> values;
+        values.reserve(max(size_ + extra, owned_->values.capacity() * 2));
+        values.assign(owned_->values.begin(), owned_->values.end());
+        auto grown = make_shared<Owned>(move(values));
+        owned_ = move(grown);
+        sync();
+    }
+
+    void sync() {
+        data_ = owned_->values.data();
+        size_ = owned_->values.size();
+    }
+
+    shared_ptr<Owned> owned_;       // 직접 소유한 값 (뷰가 같이 가리킬 수 있음)
+    shared_ptr<const void> keep_;   // 뷰일 때 가리키는 영역을 살려 두는 참조 (mmap 파일 또는 다른 배열의 버퍼)
+    MappedFile* file_ = nullptr;    // mmap 파일을 가리키는 중이면 그 파일 (버퍼 풀 계산용)
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// 사전 인코딩 문자열 컬럼이 가질 수 있는 서로 다른 값의 최대 개수 (넘으면 일반 방식으로 바꿈)
+const size_t kMaxDictionaryEntries = 4096;
+
+// 문자열 컬럼: 모든 값을 하나의 버퍼(arena)에 이어 붙이고 오프셋으로 구분
+// 일반 방식은 offsets[i] ~ offsets[i + 1] 구간이 i번째 행의 값
+// 사전 인코딩(encoded)이면 offsets/data에는 서로 다른 값(사전)만 한 번씩 담고 codes[i]가 i번째 행의 사전 번호
+// 테이블의 문자열 컬럼은 사전 인코딩으로 시작하고, 값 종류가 kMaxDictionaryEntries를 넘으면 일반 방식으로 바꿈
+struct StringColumn {
+    ColumnArray<uint64_t> offsets;
+    ColumnArray<char> data;
+    ColumnArray<int32_t> codes;       // 행마다 사전 번호 (사전 인코딩일 때만)
+    ColumnArray<int32_t> sortedCodes; // 사전 번호를 값 순서로 정렬한 것 (값으로 번호를 이진 탐색)
+    bool encoded = false;
+
+    StringColumn() { offsets.push_back(0); }
+
+    size_t size() const { return encoded ? codes.size() : offsets.size() - 1; }
+    size_t entryCount() const { return offsets.size() - 1; }
+
+    // 사전 인코딩이면 k번째 사전 값, 아니면 k번째 행의 값
+    string_view entry(size_t k) const {
+        return string_view(data.data() + offsets[k], offsets[k + 1] - offsets[k]);
+    }
+
+    string_view get(size_t i) const {
+        return entry(encoded ? static_cast<size_t>(codes[i]) : i);
+    }
+
+    // 값의 사전 번호 (사전에 없으면 -1)
+    int32_t findCode(string_view value) const {
+        size_t position = lowerBound(value);
+        if (position < sortedCodes.size() && entry(sortedCodes[position]) == value) return sortedCodes[position];
+        return -1;
+    }
+
+    void push_back(string_view value) {
+        if (encoded) {
+            // 바로 앞 행과 같은 값이 흔하므로 먼저 확인
+            if (!codes.empty() && entry(codes.back()) == value) {
+                codes.push_back(codes.back());
+                return;
+            }
+            size_t position = lowerBound(value);
+            if (position < sortedCodes.size() && entry(sortedCodes[position]) == value) {
+                codes.push_back(sortedCodes[position]);
+                return;
+            }
+            if (entryCount() < kMaxDictionaryEntries) {
+                int32_t code = static_cast<int32_t>(entryCount());
+                data.append(value.data(), value.size());
+                offsets.push_back(data.size());
+                sortedCodes.resize(sortedCodes.size() + 1);
+                int32_t* sorted = sortedCodes.mutableData();
+                memmove(sorted + position + 1, sorted + position, (sortedCodes.size() - 1 - position) * sizeof(int32_t));
+                sorted[position] = code;
+                codes.push_back(code);
+                return;
+            }
+            decode();
+        }
+        data.append(value.data(), value.size());
+        offsets.push_back(data.size());
+    }
+
+    void clear() {
+        offsets.assign(1, 0);
+        data.clear();
+        codes.clear();
+        sortedCodes.clear();
+    }
+
+    // 값 순서로 value 이상인 첫 위치 (sortedCodes 안의 위치)
+    size_t lowerBound(string_view value) const {
+        size_t low = 0, high = sortedCodes.size();
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (entry(sortedCodes[middle]) < value) low = middle + 1;
+            else high = middle;
+        }
+        return low;
+    }
+
+private:
+    // 사전 인코딩을 풀어 일반 방식으로 바꿈 (새 버퍼를 쓰므로 뷰가 보던 값은 그대로 남음)
+    void decode() {
+        StringColumn plain;
+        for (size_t i = 0; i < codes.size(); ++i) plain.push_back(get(i));
+        *this = move(plain);
+    }
+};
+
+// 테이블을 나누는 세그먼트 크기 (행 수): 세그먼트마다 zone map을 두고 스캔 블록과 경계를 맞춤
+const size_t kSegmentRows = 4096;
+
+// 세그먼트 하나의 값 범위 (zone map)
+// int/date 컬럼은 intMin ~ intMax, float 컬럼은 floatMin ~ floatMax를 씀 (NaN이 있으면 무한대 범위)
+struct ZoneRange {
+    int64_t intMin;
+    int64_t intMax;
+    double floatMin;
+    double floatMax;
+};
+
+// 한 컬럼의 데이터를 타입별 연속 배열로 저장하는 구조체 (타입에 해당하는 배열만 사용)
+struct ColumnData {
+    ColumnType type = ColumnType::String;
+    ColumnArray<int64_t> ints;
+    ColumnArray<double> floats;
+    ColumnArray<int32_t> dates;
+    StringColumn strings;
+    ColumnArray<ZoneRange> zones; // 세그먼트별 값 범위 (int/float/date만, 비어 있으면 아직 만들지 않음)
+};
+
+// 컬럼 값 전체를 복사 없이 가리키는 읽기 전용 뷰를 만드는 함수
+ColumnData columnView(const ColumnData& column) {
+    ColumnData view;
+    view.type = column.type;
+    view.ints = column.ints.view();
+    view.floats = column.floats.view();
+    view.dates = column.dates.view();
+    view.strings.offsets = column.strings.offsets.view();
+    view.strings.data = column.strings.data.view();
+    view.strings.codes = column.strings.codes.view();
+    view.strings.sortedCodes = column.strings.sortedCodes.view();
+    view.strings.encoded = column.strings.encoded;
+    view.zones = column.zones.view();
+    return view;
+}
+
+// [first, first + count) 행의 값을 읽기 전에 파일 페이지를 버퍼 풀에 올리는 함수
+void touchColumn(const ColumnData& column, size_t first, size_t count) {
+    if (count == 0) return;
+    switch (column.type) {
+        case ColumnType::Int: column.ints.touch(first, count); break;
+        case ColumnType::Float: column.floats.touch(first, count); break;
+        case ColumnType::Date: column.dates.touch(first, count); break;
+        case ColumnType::String: {
+            const StringColumn& strings = column.strings;
+            if (strings.encoded) {
+                strings.codes.touch(first, count);
+                strings.offsets.touch(0, strings.offsets.size());
+                strings.data.touch(0, strings.data.size());
+            } else {
+                strings.offsets.touch(first, count + 1);
+                strings.data.touch(strings.offsets[first], strings.offsets[first + count] - strings.offsets[first]);
+            }
+            break;
+        }
+    }
+}
+
+// 컬럼에서 파일에 없이 메모리에만 있는 바이트 수
+size_t columnDirtyBytes(const ColumnData& column) {
+    const StringColumn& strings = column.strings;
+    return column.ints.dirtyBytes() + column.floats.dirtyBytes() + column.dates.dirtyBytes() + strings.offsets.dirtyBytes() +
+           strings.data.dirtyBytes() + strings.codes.dirtyBytes() + strings.sortedCodes.dirtyBytes() + column.zones.dirtyBytes();
+}
+
+// 컬럼에서 파일 매핑을 그대로 읽는 바이트 수
+size_t columnMappedBytes(const ColumnData& column) {
+    const StringColumn& strings = column.strings;
+    return column.ints.mappedBytes() + column.floats.mappedBytes() + column.dates.mappedBytes() + strings.offsets.mappedBytes() +
+           strings.data.mappedBytes() + strings.codes.mappedBytes() + strings.sortedCodes.mappedBytes() + column.zones.mappedBytes();
+}
+
+// WHERE 절의 비교 연산자
+enum class CompareOp { Eq, Ne, Lt, Gt, Le, Ge };
+
+// WHERE 절의 리터럴 값을 컬럼 타입으로 한 번만 변환해 둔 조건
+struct Condition {
+    int columnIndex = -1;
+    CompareOp op = CompareOp::Eq;
+    bool valid = false;  // 연산자나 리터럴이 올바르지 않으면 어떤 행도 만족하지 않음
+    int64_t intValue = 0;
+    double floatValue = 0;
+    int32_t dateValue = 0;
+    string stringValue;
+};
+
+// 보조 인덱스 종류
+enum class IndexKind : uint8_t {
+    Hash = 1,  // '=' 조회
+    BTree = 2  // '=', '<', '>', '<=', '>=' 조회
+};
+
+// 인덱스 자료구조 공통 인터페이스 (키 타입별 템플릿으로 구현)
+struct IndexStructure {
+    virtual ~IndexStructure() = default;
+    // order가 있으면 키 순서로 정렬된 행 번호이므로 정렬 없이 만듦
+    virtual void build(const ColumnData& column, size_t rowCount, const uint64_t* order) = 0;
+    virtual void insert(const ColumnData& column, uint64_t row) = 0;
+    // 조건을 만족하는 행 번호를 rows에 추가, 처리할 수 없는 연산자면 false
+    virtual bool lookup(const Condition& cond, vector<uint64_t>& rows) const = 0;
+    // 키 순서로 정렬된 행 번호 (정렬 순서가 없는 인덱스는 비워 둠)
+    virtual void sortedRows(vector<uint64_t>& rows) const = 0;
+};
+
+// 테이블에 정의된 보조 인덱스
+// 자료구조는 처음 사용할 때 만들며, 파일에서 읽은 정렬 순서가 있으면 그것으로 바로 만듦
+struct TableIndex {
+    string name;
+    string column;
+    int columnIndex = -1;
+    IndexKind kind = IndexKind::BTree;
+    unique_ptr<IndexStructure> structure;  // nullptr이면 아직 만들지 않음
+    ColumnArray<uint64_t> persistedOrder;  // 파일에 저장된 B+tree 정렬 순서
+};
+
+// 구조체 안에 넣어 쓰는 잠금
+// 구조체를 복사하거나 옮길 때 잠금은 따라가지 않고 새로 만들어짐
+template <typename Mutex>
+struct MemberLock {
+    mutable Mutex mutex;
+
+    MemberLock() = default;
+    MemberLock(const MemberLock&) {}
+    MemberLock& operator=(const MemberLock&) { return *this; }
+};
+
+// 테이블 내용이 바뀔 때마다 새로 받는 변경 번호 (SELECT 결과 캐시가 항목이 아직 맞는지 확인하는 기준)
+// 모든 테이블이 전역 시계 하나에서 받으므로, 같은 이름으로 다시 만들거나 파일에서 다시 로드한 테이블과도 겹치지 않음
+atomic<uint64_t> modificationClock{0};
+
+struct ModificationStamp {
+    atomic<uint64_t> value{++modificationClock}; // 테이블이 만들어질 때 (CREATE TABLE, 로드) 새 번호
+
+    ModificationStamp() = default;
+    ModificationStamp(const ModificationStamp& other) : value(other.load()) {}
+    ModificationStamp& operator=(const ModificationStamp& other) {
+        value.store(other.load(), memory_order_release);
+        return *this;
+    }
+
+    uint64_t load() const { return value.load(memory_order_acquire); }
+    void touch() { value.store(++modificationClock, memory_order_release); }
+};
+
+// 트랜잭션 번호로 본 한 시점 (MVCC 스냅샷)
+// next 이상이거나 active에 있는 (스냅샷을 잡을 때 진행 중이던) 트랜잭션의 변경은 보이지 않음
+struct Snapshot {
+    uint64_t next = 1;
+    uint64_t oldest = 1;     // active의 최솟값 (없으면 next): 이보다 작은 번호는 모두 보임
+    vector<uint64_t> active; // 오름차순
+
+    bool sees(uint64_t txn) const {
+        return txn < oldest || (txn < next && !binary_search(active.begin(), active.end(), txn));
+    }
+};
+
+// 행마다 붙는 버전 정보 (MVCC): 행을 추가한 트랜잭션과 지운 트랜잭션 번호
+// 배열이 비어 있으면 모든 행이 0 (파일에서 읽은 행처럼 항상 보이고 지워지지 않음), 아니면 길이가 rowCount
+// DELETE는 행을 옮기지 않고 deletedBy만 표시하며, 지운 행은 백그라운드 vacuum이 정리함
+struct RowVersions {
+    ColumnArray<uint64_t> createdBy;
+    ColumnArray<uint64_t> deletedBy;
+    size_t deletedRows = 0;     // deletedBy가 0이 아닌 행 수
+    uint64_t newestCreator = 0; // createdBy의 최댓값
+};
+
+// 테이블 데이터를 메모리에 저장할 구조체 (컬럼 단위 저장)
+// SELECT는 원본 대신 스냅샷 뷰(source가 원본인 TableData)를 읽으므로 실행 중에 추가되거나 지워진 행은 보이지 않음
 struct TableData {
     TableSchema schema;
-    vector<vector<string>> rows;
+    vector<ColumnData> columns; // schema.columns와 같은 순서
+    size_t rowCount = 0;
+    vector<TableIndex> indexes;
+    RowVersions versions;
+    TableData* source = nullptr;        // 스냅샷 뷰이면 원본 테이블 (인덱스는 원본 것을 사용)
+    const Snapshot* snapshot = nullptr; // 뷰가 읽는 시점 (없으면 가장 최근 상태: 지운 표시가 없는 행만 보임)
+    MemberLock<mutex> writeLock;         // INSERT / DELETE / COPY / COMMIT / vacuum은 테이블마다 하나씩
+    MemberLock<shared_mutex> layoutLock; // SELECT가 실행 내내 공유로 잡음 (행 번호를 바꾸는 vacuum만 배타적으로)
+    MemberLock<shared_mutex> latch;      // 뷰를 만들거나 인덱스를 찾을 때 공유, 배열이나 인덱스를 바꾸는 동안 배타적으로
+    ModificationStamp modification;      // INSERT / DELETE / UPDATE / COPY / CREATE INDEX마다 바뀜
 };
 
 // 데이터베이스를 메모리에 저장할 구조체
 struct Database {
     string dbName;
     unordered_map<string, TableData> tables; // 테이블 이름과 테이블 데이터를 저장
+    uint64_t checkpointLsn = 0; // .mydb 파일에 이미 반영된 마지막 커밋 번호
+    uint64_t lastLsn = 0;       // 마지막으로 로그에 붙인 커밋 번호
+    uint64_t durableLsn = 0;    // 로그 파일에 fsync되었거나 .mydb 파일에 반영된 마지막 커밋 번호
+    string walBuffer;           // 아직 로그 파일에 쓰지 않은 redo 레코드
+    uint64_t walSize = 0;       // 로그 파일 크기
+    uint64_t syncedWalSize = 0; // 마지막 COMMIT까지 fsync된 로그 크기
+    MemberLock<mutex> walLock;  // 여러 테이블의 writer가 같은 로그 버퍼에 쓸 때 사용
 };
 
 // 전역 데이터베이스 저장소
+// databases 맵과 각 데이터베이스의 테이블 목록은 catalogMutex로 보호 (만들거나 로드할 때만 배타적으로 잡음)
 unordered_map<string, Database> databases;
-string currentDatabase = "";
+shared_mutex catalogMutex;
+thread_local string currentDatabase = ""; // 세션마다 따로 (서버 모드에서는 워커가 세션 값으로 바꿔 끼움)
+uint64_t catalogVersion = 1; // 테이블이 만들어지거나 데이터베이스가 바뀔 때마다 증가 (준비된 계획을 다시 해석하는 기준)
+
+// 쿼리 결과와 오류 메시지를 쓸 스트림
+// REPL에서는 cout / cerr, 서버 모드에서는 세션의 응답 버퍼
+thread_local ostream* queryOut = &cout;
+thread_local ostream* queryErr = &cerr;
+
+// ---- 실행 통계 (SHOW STATS) ----
+// 여러 세션과 스캔 스레드가 함께 올리므로 원자적으로 더함
+struct IoStats {
+    atomic<uint64_t> rowsRead{0};       // 스캔이 읽은 행 수 (zone map으로 건너뛴 세그먼트 제외)
+    atomic<uint64_t> rowsReturned{0};   // SELECT 결과 행 수
+    atomic<uint64_t> rowsWritten{0};    // INSERT / COPY로 추가하거나 UPDATE / DELETE로 바꾸거나 지운 행 수
+    atomic<uint64_t> bytesCommitted{0}; // COMMIT이 fsync한 로그 바이트 수
+};
+
+IoStats ioStats;
+
+// EXPLAIN ANALYZE가 SELECT를 실행하면서 단계별로 모으는 값
+struct QueryProfile {
+    size_t rowsOut = 0;                // 결과 행 수
+    size_t groups = 0;                 // 집계 그룹 수
+    size_t joinRows = 0;               // 조인 결과 행 수
+    size_t joinCandidates[2] = {0, 0}; // 조인 양쪽의 후보 행 수 (FROM 테이블, JOIN 테이블)
+    int buildSide = -1;                // 해시 테이블을 만든 쪽
+    atomic<uint64_t> aggregateNanos{0};
+    atomic<uint64_t> sortNanos{0};
+    atomic<uint64_t> joinNanos{0};
+};
+
+// 구간 시간을 누적하는 타이머 (sink가 nullptr이면 시계를 읽지 않음)
+class StageTimer {
+public:
+    explicit StageTimer(atomic<uint64_t>* sink) : sink_(sink) {
+        if (sink_) start_ = chrono::steady_clock::now();
+    }
+
+    ~StageTimer() {
+        if (sink_) {
+            auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start_).count();
+            sink_->fetch_add(static_cast<uint64_t>(elapsed), memory_order_relaxed);
+        }
+    }
+
+private:
+    atomic<uint64_t>* sink_;
+    chrono::steady_clock::time_point start_;
+};
+
+// 트랜잭션 번호를 나눠 주고 스냅샷을 만드는 객체
+// 쓰기 문장 하나가 트랜잭션 하나 (자동 커밋): 문장이 끝나면 그 변경이 이후에 잡은 스냅샷에 보임
+class TransactionManager {
+public:
+    uint64_t begin() {
+        lock_guard<mutex> lock(mutex_);
+        active_.push_back(next_);
+        return next_++;
+    }
+
+    void finish(uint64_t txn) {
+        lock_guard<mutex> lock(mutex_);
+        active_.erase(find(active_.begin(), active_.end(), txn));
+    }
+
+    Snapshot snapshot() const {
+        lock_guard<mutex> lock(mutex_);
+        Snapshot result;
+        result.next = next_;
+        result.active = active_;
+        result.oldest = active_.empty() ? next_ : active_.front();
+        return result;
+    }
+
+private:
+    mutable mutex mutex_;
+    uint64_t next_ = 1;       // 0은 항상 보이는 행에 씀
+    vector<uint64_t> active_; // 진행 중인 트랜잭션 (오름차순)
+};
+
+TransactionManager transactions;
+
+// 쓰기 문장을 실행하는 동안 트랜잭션 하나를 열어 두는 객체 (범위를 벗어나면 커밋)
+// 커밋한 뒤에 테이블의 변경 번호를 올리므로, 새 번호를 읽은 SELECT의 스냅샷에는 이 변경이 항상 보임
+struct WriteTransaction {
+    const uint64_t id = transactions.begin();
+    TableData& table;
+
+    explicit WriteTransaction(TableData& target) : table(target) {}
+    WriteTransaction(const WriteTransaction&) = delete;
+    WriteTransaction& operator=(const WriteTransaction&) = delete;
+    ~WriteTransaction() {
+        transactions.finish(id);
+        table.modification.touch();
+    }
+};
 
 // 문자열이 숫자인지 확인하는 함수
 bool isNumeric(const string& str) {
     return all_of(str.begin(), str.end(), ::isdigit);
 }
 
-// 논리 연산자를 통한 조건 평가 함수
-bool evaluateCondition(const string& lhs, const string& op, const string& rhs) {
-    if (op == "=") return lhs == rhs;
-    if (op == "<") return isNumeric(lhs) && isNumeric(rhs) && stoi(lhs) < stoi(rhs);
-    if (op == ">") return isNumeric(lhs) && isNumeric(rhs) && stoi(lhs) > stoi(rhs);
-    if (op == "<=") return isNumeric(lhs) && isNumeric(rhs) && stoi(lhs) <= stoi(rhs);
-    if (op == ">=") return isNumeric(lhs) && isNumeric(rhs) && stoi(lhs) >= stoi(rhs);
-    if (op == "<>") return lhs != rhs;
-    return false;
+// 정수 텍스트를 int64_t로 변환하는 함수 (범위를 벗어나면 실패)
+bool parseInt(string_view text, int64_t& out) {
+    if (text.empty()) return false;
+    auto result = from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == errc() && result.ptr == text.data() + text.size();
 }
 
-// CREATE DATABASE 쿼리를 처리하는 함수
-void createDatabase(const string& query) {
-    istringstream ss(query);
-    string token;
-    ss >> token; // 'CREATE'
-    ss >> token; // 'DATABASE'
-
-    string dbName;
-    ss >> dbName; // 데이터베이스 이름
+// 실수 텍스트를 double로 변환하는 함수
+bool parseFloat(const string& text, double& out) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    out = strtod(text.c_str(), &end);
+    return errno == 0 && end == text.c_str() + text.size();
+}
 
-    if (databases.find(dbName) != databases.end()) {
-        cerr << "Database: " << dbName << "는 이미 존재하는 데이터베이스 입니다.\n";
-        return;
+// 'YYYY-MM-DD' 텍스트를 YYYYMMDD 정수로 변환하는 함수
+bool parseDate(string_view text, int32_t& out) {
+    size_t first = text.find('-');
+    size_t second = text.find('-', first + 1);
+    if (first == string::npos || second == string::npos) return false;
+    int64_t year, month, day;
+    if (!parseInt(text.substr(0, first), year) ||
+        !parseInt(text.substr(first + 1, second - first - 1), month) ||
+        !parseInt(text.substr(second + 1), day)) {
+        return false;
     }
+    if (year > 9999 || month < 1 || month > 12 || day < 1 || day > 31) return false;
+    out = static_cast<int32_t>(year * 10000 + month * 100 + day);
+    return true;
+}
 
-    // 데이터베이스 파일 생성
-    string filename = dbName + ".mydb";
-    ofstream file(filename);
-    if (!file.is_open()) {
-        cerr << "데이터베이스 파일: " << filename << "을 생성하는데 실패했습니다. \n";
-        return;
+// 값 하나를 컬럼 타입 규칙으로 검사하고 변환해 컬럼 끝에 추가하는 함수 (규칙에 맞지 않으면 추가하지 않고 false)
+// INSERT와 COPY가 모두 이 규칙을 씀
+bool appendCheckedValue(ColumnData& column, string_view value) {
+    switch (column.type) {
+        case ColumnType::Int: {
+            // 숫자가 아닌 경우 에러
+            int64_t parsed;
+            if (!all_of(value.begin(), value.end(), ::isdigit) || !parseInt(value, parsed)) return false;
+            column.ints.push_back(parsed);
+            return true;
+        }
+        case ColumnType::Float: {
+            // 실수가 아닌 경우 에러 (숫자와 소수점 하나만 허용)
+            double parsed;
+            if (value.empty() || value.find_first_not_of("0123456789.") != string_view::npos ||
+                count(value.begin(), value.end(), '.') > 1) {
+                return false;
+            }
+            auto result = from_chars(value.data(), value.data() + value.size(), parsed);
+            if (result.ec != errc() || result.ptr != value.data() + value.size()) return false;
+            column.floats.push_back(parsed);
+            return true;
+        }
+        case ColumnType::Date: {
+            // 날짜는 'YYYY-MM-DD' 형식이어야 함
+            int32_t parsed;
+            if (value.find_first_not_of("0123456789-") != string_view::npos || count(value.begin(), value.end(), '-') != 2 ||
+                !parseDate(value, parsed)) {
+                return false;
+            }
+            column.dates.push_back(parsed);
+            return true;
+        }
+        case ColumnType::String:
+            // 문자열은 따옴표로 감싸져 있어야 함
+            if (value.size() < 2 || value.front() != '"' || value.back() != '"') return false;
+            column.strings.push_back(value);
+            return true;
     }
-    file.close(); // 파일을 생성만 하고 닫음
+    return false;
+}
 
-    Database db;
-    db.dbName = dbName;
-    databases[dbName] = db;
+// 스키마 타입 이름이 검사 규칙이 있는 타입인지 확인하는 함수 (그 외 타입은 값을 그대로 받음)
+bool isCheckedType(const string& typeName) {
+    return typeName == "int" || typeName == "float" || typeName == "string" || typeName == "date";
+}
 
-    cout << "Database: " << dbName << "를 생성 완료하였습니다. " << filename << "파일 생성완료.\n";
+// INSERT 값이 컬럼 타입 규칙에 맞는지 검사하는 함수
+bool isValidValue(const string& expectedType, const string& value) {
+    if (!isCheckedType(expectedType)) return true;
+    ColumnData scratch;
+    scratch.type = toColumnType(expectedType);
+    return appendCheckedValue(scratch, value);
 }
 
-// .mydb 파일에서 데이터를 읽어와 메모리에 로드하는 함수
-void loadDatabase(const string& dbName) {
-    string filename = dbName + ".mydb";
-    ifstream file(filename); // 텍스트 모드로 파일 열기
+// 검사를 통과한 값을 컬럼 끝에 추가하는 함수
+void appendValue(ColumnData& column, const string& value) {
+    switch (column.type) {
+        case ColumnType::Int: {
+            int64_t parsed = 0;
+            parseInt(value, parsed);
+            column.ints.push_back(parsed);
+            break;
+        }
+        case ColumnType::Float: {
+            double parsed = 0;
+            parseFloat(value, parsed);
+            column.floats.push_back(parsed);
+            break;
+        }
+        case ColumnType::Date: {
+            int32_t parsed = 0;
+            parseDate(value, parsed);
+            column.dates.push_back(parsed);
+            break;
+        }
+        case ColumnType::String:
+            column.strings.push_back(value);
+            break;
+    }
+}
 
-    if (!file.is_open()) {
-        cerr << "파일: " << filename << "을 읽어오는데 실패하였습니다. \n";
-        return;
+// 한 셀의 값을 출력 스트림에 쓰는 함수
+void writeCell(ostream& out, const ColumnData& column, size_t row) {
+    char buffer[32];
+    switch (column.type) {
+        case ColumnType::Int: {
+            auto result = to_chars(buffer, buffer + sizeof(buffer), column.ints[row]);
+            out.write(buffer, result.ptr - buffer);
+            break;
+        }
+        case ColumnType::Float: {
+            auto result = to_chars(buffer, buffer + sizeof(buffer), column.floats[row]);
+            out.write(buffer, result.ptr - buffer);
+            break;
+        }
+        case ColumnType::Date: {
+            int32_t date = column.dates[row];
+            snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", date / 10000, date / 100 % 100, date % 100);
+            out << buffer;
+            break;
+        }
+        case ColumnType::String: {
+            string_view value = column.strings.get(row);
+            out.write(value.data(), value.size());
+            break;
+        }
     }
+}
 
-    stringstream ss;
-    string line;
-    while (getline(file, line)) {
-        ss << line << "\n";
+// 스키마에 맞게 비어 있는 컬럼들을 준비하는 함수 (dictionary면 문자열 컬럼을 사전 인코딩으로 시작)
+void initColumns(TableData& table, bool dictionary = true) {
+    table.columns.assign(table.schema.columns.size(), ColumnData{});
+    for (size_t i = 0; i < table.columns.size(); ++i) {
+        table.columns[i].type = toColumnType(table.schema.columnTypes[i]);
+        table.columns[i].strings.encoded = dictionary && table.columns[i].type == ColumnType::String;
     }
+    table.rowCount = 0;
+}
 
-    file.close();
+// 테이블 끝에 추가된 firstRow 이후 행들을 인덱스에 반영하는 함수
+// 아직 만들지 않은 인덱스는 파일의 정렬 순서가 더 이상 맞지 않으므로 버림
+// 한 번에 많이 추가되면 한 행씩 넣는 대신 인덱스를 버리고 다음에 쓸 때 다시 만듦 (bulk load가 더 빠름)
+void indexAppendedRows(TableData& table, size_t firstRow) {
+    const size_t kRebuildRows = 4096;
+    for (auto& index : table.indexes) {
+        if (index.structure && table.rowCount - firstRow < kRebuildRows) {
+            for (size_t row = firstRow; row < table.rowCount; ++row) {
+                index.structure->insert(table.columns[index.columnIndex], row);
+            }
+        } else {
+            index.structure.reset();
+            index.persistedOrder.clear();
+        }
+    }
+}
 
-    // 데이터를 메모리에 로드
-    string tableData;
-    Database db;
-    db.dbName = dbName;
-    string currentTableName;
-    TableSchema currentSchema;
+void indexAppendedRow(TableData& table) {
+    indexAppendedRows(table, table.rowCount - 1);
+}
 
-    while (getline(ss, tableData)) {
-        if (tableData.find("TABLE:") != string::npos) {
-            currentTableName = tableData.substr(7); // "TABLE: " 이후의 테이블 이름 추출
-            db.tables[currentTableName] = TableData{TableSchema{currentTableName, {}, {}}, {}};
-            currentSchema = db.tables[currentTableName].schema; // 현재 테이블 스키마 초기화
-        } else if (tableData.find("SCHEMA:") != string::npos) {
-            string schemaLine = tableData.substr(7); // "SCHEMA:" 이후의 스키마 정의
-            istringstream schemaStream(schemaLine);
-            string columnDef;
+// 세그먼트 [begin, end) 구간 값의 범위를 zone에 넣는 함수 (fresh면 새로 시작, 아니면 기존 범위를 넓힘)
+template <typename T>
+void widenZone(const T* values, size_t begin, size_t end, bool fresh, T& low, T& high) {
+    if (fresh) low = high = values[begin];
+    for (size_t row = begin; row < end; ++row) {
+        low = min(low, values[row]);
+        high = max(high, values[row]);
+    }
+}
 
-            while (getline(schemaStream, columnDef, ',')) {
-                size_t typeStart = columnDef.find('(');
-                size_t typeEnd = columnDef.find(')');
-                if (typeStart != string::npos && typeEnd != string::npos && typeEnd > typeStart + 1) {
-                    string columnType = columnDef.substr(typeStart + 1, typeEnd - typeStart - 1); // 데이터 타입
-                    string columnName = columnDef.substr(typeEnd + 1);  // 데이터 타입 이후의 열 이름
-                    columnName.erase(remove(columnName.begin(), columnName.end(), ' '), columnName.end());
-                    columnType.erase(remove(columnType.begin(), columnType.end(), ' '), columnType.end());
-                    currentSchema.columns.push_back(columnName);
-                    currentSchema.columnTypes.push_back(columnType);
+// firstRow 이후에 추가된 행을 반영해 컬럼의 zone map을 늘리는 함수
+// 기존 zone map이 firstRow 앞의 행을 모두 덮지 않으면 처음부터 다시 만듦
+// 값이 바뀌지 않는 한 범위는 넓어지기만 하므로, 지운 행은 vacuum이 압축할 때 다시 만들면서 빠짐
+void extendZoneMap(ColumnData& column, size_t firstRow, size_t rowCount) {
+    if (column.type == ColumnType::String) return;
+    if (column.zones.size() != (firstRow + kSegmentRows - 1) / kSegmentRows) firstRow = 0;
+    size_t segments = (rowCount + kSegmentRows - 1) / kSegmentRows;
+    if (firstRow >= rowCount && column.zones.size() == segments) return;
+    column.zones.resize(segments);
+    ZoneRange* zones = column.zones.mutableData(); // 뷰가 읽는 중이면 복사본에 씀
+    for (size_t segment = firstRow / kSegmentRows; segment < segments; ++segment) {
+        size_t begin = max(firstRow, segment * kSegmentRows);
+        size_t end = min(rowCount, (segment + 1) * kSegmentRows);
+        bool fresh = begin == segment * kSegmentRows;
+        ZoneRange& zone = zones[segment];
+        switch (column.type) {
+            case ColumnType::Int: widenZone(column.ints.data(), begin, end, fresh, zone.intMin, zone.intMax); break;
+            case ColumnType::Date: {
+                int32_t low = static_cast<int32_t>(zone.intMin), high = static_cast<int32_t>(zone.intMax);
+                widenZone(column.dates.data(), begin, end, fresh, low, high);
+                zone.intMin = low;
+                zone.intMax = high;
+                break;
+            }
+            case ColumnType::Float: {
+                const double* values = column.floats.data();
+                if (fresh) zone.floatMin = zone.floatMax = values[begin];
+                for (size_t row = begin; row < end; ++row) {
+                    if (values[row] != values[row]) {
+                        zone.floatMin = -numeric_limits<double>::infinity();
+                        zone.floatMax = numeric_limits<double>::infinity();
+                    }
+                    zone.floatMin = min(zone.floatMin, values[row]);
+                    zone.floatMax = max(zone.floatMax, values[row]);
                 }
+                break;
             }
+            case ColumnType::String: break;
+        }
+    }
+}
 
-            db.tables[currentTableName].schema = currentSchema;
-        } else if (!currentTableName.empty() && db.tables.find(currentTableName) != db.tables.end()) {
-            istringstream rowStream(tableData);
+void extendZoneMaps(TableData& table, size_t firstRow) {
+    for (auto& column : table.columns) extendZoneMap(column, firstRow, table.rowCount);
+}
+
+// 테이블 끝에 추가된 firstRow 이후 행의 버전 정보를 채우는 함수 (creator는 행을 추가한 트랜잭션, 0이면 항상 보임)
+void appendVersions(TableData& table, size_t firstRow, uint64_t creator) {
+    RowVersions& versions = table.versions;
+    if (creator != 0 || !versions.createdBy.empty()) {
+        versions.createdBy.resize(firstRow); // 처음 쓰는 거라면 앞의 행은 0
+        versions.createdBy.resize(table.rowCount);
+        // 새로 늘어난 칸은 아직 어떤 뷰에도 보이지 않으므로 버퍼를 공유 중이어도 제자리에서 채움
+        fill(versions.createdBy.sharedMutableData() + firstRow, versions.createdBy.sharedMutableData() + table.rowCount, creator);
+        versions.newestCreator = max(versions.newestCreator, creator);
+    }
+    if (!versions.deletedBy.empty()) versions.deletedBy.resize(table.rowCount);
+}
+
+// 검사를 통과한 한 행을 테이블 끝에 추가하는 함수
+void appendRow(TableData& table, const vector<string>& row) {
+    for (size_t i = 0; i < row.size(); ++i) {
+        appendValue(table.columns[i], row[i]);
+    }
+    table.rowCount++;
+    appendVersions(table, table.rowCount - 1, 0);
+    extendZoneMaps(table, table.rowCount - 1);
+    indexAppendedRow(table);
+}
+
+// 컬럼 뒤에 같은 타입 컬럼의 값을 모두 이어 붙이는 함수
+void appendColumn(ColumnData& column, const ColumnData& values) {
+    switch (column.type) {
+        case ColumnType::Int: column.ints.append(values.ints.data(), values.ints.size()); break;
+        case ColumnType::Float: column.floats.append(values.floats.data(), values.floats.size()); break;
+        case ColumnType::Date: column.dates.append(values.dates.data(), values.dates.size()); break;
+        case ColumnType::String: {
+            if (column.strings.encoded || values.strings.encoded) {
+                for (size_t i = 0; i < values.strings.size(); ++i) column.strings.push_back(values.strings.get(i));
+                break;
+            }
+            uint64_t base = column.strings.data.size();
+            size_t first = column.strings.offsets.size();
+            size_t count = values.strings.size();
+            column.strings.data.append(values.strings.data.data(), values.strings.data.size());
+            column.strings.offsets.resize(first + count);
+            uint64_t* offsets = column.strings.offsets.mutableData();
+            for (size_t i = 0; i < count; ++i) offsets[first + i] = base + values.strings.offsets[i + 1];
+            break;
+        }
+    }
+}
+
+// 검사를 마친 여러 행(컬럼별로 모아 둔 값)을 테이블 끝에 한 번에 추가하는 함수 (creator는 추가하는 트랜잭션)
+void appendRows(TableData& table, const vector<ColumnData>& rows, size_t count, uint64_t creator = 0) {
+    size_t firstRow = table.rowCount;
+    for (size_t i = 0; i < table.columns.size(); ++i) {
+        appendColumn(table.columns[i], rows[i]);
+    }
+    table.rowCount += count;
+    appendVersions(table, firstRow, creator);
+    extendZoneMaps(table, firstRow);
+    indexAppendedRows(table, firstRow);
+}
+
+// keep[i]가 true인 값만 남기고 앞으로 당겨 압축하는 함수
+template <typename T>
+void compactArray(ColumnArray<T>& values, const vector<char>& keep) {
+    T* data = values.mutableData();
+    size_t out = 0;
+    for (size_t i = 0; i < keep.size(); ++i) {
+        if (keep[i]) data[out++] = data[i];
+    }
+    values.resize(out);
+}
+
+// keep[i]가 true인 행만 남기고 각 컬럼을 앞으로 당겨 압축하는 함수
+void compactTable(TableData& table, const vector<char>& keep) {
+    for (auto& column : table.columns) {
+        switch (column.type) {
+            case ColumnType::Int: compactArray(column.ints, keep); break;
+            case ColumnType::Float: compactArray(column.floats, keep); break;
+            case ColumnType::Date: compactArray(column.dates, keep); break;
+            case ColumnType::String: {
+                // 사전 인코딩이면 번호만 압축 (사전은 그대로 두므로 번호가 바뀌지 않음)
+                if (column.strings.encoded) {
+                    compactArray(column.strings.codes, keep);
+                    break;
+                }
+                StringColumn compacted;
+                for (size_t i = 0; i < table.rowCount; ++i) if (keep[i]) compacted.push_back(column.strings.get(i));
+                column.strings = move(compacted);
+                break;
+            }
+        }
+    }
+    table.rowCount = count(keep.begin(), keep.end(), 1);
+    for (auto& column : table.columns) {
+        column.zones.clear();
+        extendZoneMap(column, 0, table.rowCount);
+    }
+
+    RowVersions& versions = table.versions;
+    if (!versions.createdBy.empty()) compactArray(versions.createdBy, keep);
+    if (!versions.deletedBy.empty()) {
+        compactArray(versions.deletedBy, keep);
+        versions.deletedRows = table.rowCount - count(versions.deletedBy.data(), versions.deletedBy.data() + table.rowCount, 0);
+    }
+
+    // 인덱스의 행 번호를 압축 후 번호로 바꿈 (B+tree는 기존 정렬 순서를 그대로 이용해 다시 만듦)
+    vector<uint64_t> newRow(keep.size());
+    uint64_t next = 0;
+    for (size_t i = 0; i < keep.size(); ++i) {
+        newRow[i] = keep[i] ? next++ : UINT64_MAX;
+    }
+    for (auto& index : table.indexes) {
+        if (!index.structure) {
+            index.persistedOrder.clear();
+            continue;
+        }
+        vector<uint64_t> order;
+        index.structure->sortedRows(order);
+        size_t out = 0;
+        for (uint64_t row : order) {
+            if (newRow[row] != UINT64_MAX) order[out++] = newRow[row];
+        }
+        order.resize(out);
+        index.structure->build(table.columns[index.columnIndex], table.rowCount, order.empty() ? nullptr : order.data());
+    }
+}
+
+// 스냅샷 뷰의 스키마와 빈 컬럼을 준비하는 함수 (조건은 이 뷰의 컬럼을 참조하도록 컴파일함)
+void initView(TableData& source, TableData& view) {
+    view.schema = source.schema;
+    view.columns.assign(source.columns.size(), ColumnData{});
+    for (size_t i = 0; i < view.columns.size(); ++i) view.columns[i].type = source.columns[i].type;
+    view.rowCount = 0;
+    view.source = &source;
+}
+
+// 원본 테이블의 지금 내용을 복사 없이 가리키도록 뷰를 채우는 함수 (snapshot 시점에 보이는 행만 읽게 됨)
+// 같은 ColumnData 객체에 새 뷰를 넣으므로 뷰의 컬럼을 참조하는 컴파일된 조건은 그대로 쓸 수 있음
+void refreshView(TableData& view, const Snapshot* snapshot) {
+    const TableData& source = *view.source;
+    shared_lock<shared_mutex> lock(source.latch.mutex);
+    for (size_t i = 0; i < view.columns.size(); ++i) view.columns[i] = columnView(source.columns[i]);
+    view.rowCount = source.rowCount;
+    view.versions.createdBy = source.versions.createdBy.view();
+    view.versions.deletedBy = source.versions.deletedBy.view();
+    view.versions.deletedRows = source.versions.deletedRows;
+    view.versions.newestCreator = source.versions.newestCreator;
+    view.snapshot = snapshot;
+}
+
+// 뷰를 비워 원본의 예전 버퍼를 놓아 주는 함수 (PREPARE된 계획이 다음 EXECUTE까지 버퍼를 잡고 있지 않도록)
+void releaseView(TableData& view) {
+    for (auto& column : view.columns) {
+        ColumnType type = column.type;
+        column = ColumnData();
+        column.type = type;
+    }
+    view.rowCount = 0;
+    view.versions = RowVersions();
+    view.snapshot = nullptr;
+}
+
+// 모든 행이 보이면 true (행마다 버전을 확인할 필요가 없음)
+bool allRowsVisible(const TableData& table) {
+    const RowVersions& versions = table.versions;
+    return versions.deletedRows == 0 && (!table.snapshot || versions.newestCreator < table.snapshot->oldest);
+}
+
+// 행 하나가 테이블이 읽는 시점에 보이는지 확인하는 함수
+// deletedBy는 DELETE가 뷰와 같은 버퍼에 바로 쓰므로 원자적으로 읽음
+bool rowVisible(const TableData& table, uint64_t row) {
+    const RowVersions& versions = table.versions;
+    if (table.snapshot && row < versions.createdBy.size() && !table.snapshot->sees(versions.createdBy[row])) return false;
+    if (row >= versions.deletedBy.size()) return true;
+    uint64_t deleter = __atomic_load_n(versions.deletedBy.data() + row, __ATOMIC_RELAXED);
+    return deleter == 0 || (table.snapshot && !table.snapshot->sees(deleter));
+}
+
+// rows[from] 이후에서 보이지 않는 행을 빼는 함수
+void keepVisibleRows(const TableData& table, vector<uint64_t>& rows, size_t from = 0) {
+    if (allRowsVisible(table)) return;
+    size_t out = from;
+    for (size_t i = from; i < rows.size(); ++i) {
+        if (rowVisible(table, rows[i])) rows[out++] = rows[i];
+    }
+    rows.resize(out);
+}
+
+// 지운 표시가 없는 행만 남긴 테이블 복사본을 만드는 함수 (인덱스는 정의만 복사하고 다음에 쓸 때 다시 만듦)
+void copyLiveRows(const TableData& table, TableData& out) {
+    out.schema = table.schema;
+    for (const auto& column : table.columns) out.columns.push_back(columnView(column));
+    out.rowCount = table.rowCount;
+    for (const auto& index : table.indexes) {
+        out.indexes.emplace_back();
+        out.indexes.back().name = index.name;
+        out.indexes.back().column = index.column;
+        out.indexes.back().columnIndex = index.columnIndex;
+        out.indexes.back().kind = index.kind;
+    }
+    vector<char> keep(table.rowCount);
+    for (size_t row = 0; row < table.rowCount; ++row) keep[row] = rowVisible(table, row);
+    compactTable(out, keep);
+}
+
+// 연산자 문자열을 CompareOp로 변환하는 함수
+bool parseCompareOp(const string& text, CompareOp& op) {
+    if (text == "=") op = CompareOp::Eq;
+    else if (text == "<>" || text == "!=") op = CompareOp::Ne;
+    else if (text == "<") op = CompareOp::Lt;
+    else if (text == ">") op = CompareOp::Gt;
+    else if (text == "<=") op = CompareOp::Le;
+    else if (text == ">=") op = CompareOp::Ge;
+    else return false;
+    return true;
+}
+
+// WHERE 절의 연산자와 리터럴을 컬럼 타입에 맞게 변환하는 함수
+Condition makeCondition(const TableData& table, int columnIndex, const string& op, const string& value) {
+    Condition cond;
+    cond.columnIndex = columnIndex;
+    if (!parseCompareOp(op, cond.op)) {
+        return cond;
+    }
+    // 작은 따옴표로 감싼 숫자/날짜 리터럴 허용
+    string literal = value;
+    if (table.columns[columnIndex].type != ColumnType::String && literal.size() >= 2 && literal.front() == '\'' &&
+        literal.back() == '\'') {
+        literal = literal.substr(1, literal.size() - 2);
+    }
+    switch (table.columns[columnIndex].type) {
+        case ColumnType::Int:
+            cond.valid = parseInt(literal, cond.intValue);
+            break;
+        case ColumnType::Float:
+            cond.valid = parseFloat(literal, cond.floatValue);
+            break;
+        case ColumnType::Date:
+            cond.valid = parseDate(literal, cond.dateValue);
+            break;
+        case ColumnType::String:
+            // 저장된 문자열은 큰따옴표를 포함하므로 리터럴도 같은 형태로 맞춤
+            cond.stringValue = value;
+            if (cond.stringValue.size() >= 2 && (cond.stringValue.front() == '\'' || cond.stringValue.front() == '"') &&
+                cond.stringValue.back() == cond.stringValue.front()) {
+                cond.stringValue = cond.stringValue.substr(1, cond.stringValue.size() - 2);
+            }
+            if (table.schema.columnTypes[columnIndex] == "string") {
+                cond.stringValue = "\"" + cond.stringValue + "\"";
+            }
+            cond.valid = true;
+            break;
+    }
+    return cond;
+}
+
+// ---- 컴파일된 WHERE 조건 ----
+// 쿼리마다 조건을 한 번 컴파일해서 컬럼 타입과 연산자로 특수화된 객체를 만들고,
+// 스캔은 블록 단위로 조건마다 비트맵을 만든 뒤 AND/OR로 합쳐 선택 벡터로 바꿈
+// int/float/date 비교는 실행 중 CPU를 확인해 AVX2 / SSE4.2 / 스칼라 커널 중 하나를 사용
+
+const size_t kScanBlockRows = kSegmentRows; // 스캔 시 한 번에 조건을 평가하는 행 수 (64의 배수, 블록 하나가 세그먼트 하나)
+
+// 비트맵 워드 수
+size_t bitmapWords(size_t rows) {
+    return (rows + 63) / 64;
+}
+
+// 앞의 rows개 비트를 모두 켬
+void fillBits(uint64_t* bits, size_t rows) {
+    size_t full = rows / 64;
+    fill(bits, bits + full, ~uint64_t(0));
+    if (rows % 64) bits[full] |= (uint64_t(1) << (rows % 64)) - 1;
+}
+
+// 연산자별 비교 (템플릿 인자로 고정되어 루프 안에서 분기가 사라짐)
+template <CompareOp Op>
+struct Compare {
+    template <typename T>
+    static bool apply(const T& lhs, const T& rhs) {
+        switch (Op) {
+            case CompareOp::Eq: return lhs == rhs;
+            case CompareOp::Ne: return lhs != rhs;
+            case CompareOp::Lt: return lhs < rhs;
+            case CompareOp::Gt: return lhs > rhs;
+            case CompareOp::Le: return lhs <= rhs;
+            case CompareOp::Ge: return lhs >= rhs;
+        }
+        return false;
+    }
+};
+
+// 사용할 SIMD 명령어 수준
+enum class SimdLevel { Scalar, Sse42, Avx2 };
+
+// CPU가 지원하는 가장 높은 수준을 고르는 함수
+// 환경 변수 DBMS_SIMD=scalar|sse42 로 더 낮은 수준을 강제할 수 있음 (비교 측정용)
+SimdLevel detectSimdLevel() {
+    SimdLevel level = SimdLevel::Scalar;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) level = SimdLevel::Avx2;
+    else if (__builtin_cpu_supports("sse4.2")) level = SimdLevel::Sse42;
+#endif
+    const char* forced = getenv("DBMS_SIMD");
+    if (forced != nullptr && string(forced) == "scalar") level = SimdLevel::Scalar;
+    if (forced != nullptr && string(forced) == "sse42" && level == SimdLevel::Avx2) level = SimdLevel::Sse42;
+    return level;
+}
+
+const SimdLevel simdLevel = detectSimdLevel();
+
+// 스칼라 커널: values[0, count)를 비교해 bits에 결과를 씀 (bits는 0으로 초기화되어 있어야 함)
+template <typename T, CompareOp Op>
+void compareKernelScalar(const T* values, size_t count, T literal, uint64_t* bits) {
+    for (size_t i = 0; i < count; ++i) {
+        bits[i / 64] |= uint64_t(Compare<Op>::apply(values[i], literal)) << (i % 64);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// SIMD 비교 결과 마스크를 뒤집어야 하는 연산자 (a <= b 는 !(a > b))
+constexpr bool invertsMask(CompareOp op) {
+    return op == CompareOp::Ne || op == CompareOp::Le || op == CompareOp::Ge;
+}
+
+// 정수 비교는 '=', '>'만 있으므로 나머지 연산자는 피연산자 순서와 마스크 반전으로 만듦
+template <CompareOp Op>
+__attribute__((target("avx2"))) inline __m256i compareInt64Avx2(__m256i v, __m256i lit) {
+    if (Op == CompareOp::Eq || Op == CompareOp::Ne) return _mm256_cmpeq_epi64(v, lit);
+    if (Op == CompareOp::Gt || Op == CompareOp::Le) return _mm256_cmpgt_epi64(v, lit);
+    return _mm256_cmpgt_epi64(lit, v);
+}
+
+template <CompareOp Op>
+__attribute__((target("avx2"))) inline __m256i compareInt32Avx2(__m256i v, __m256i lit) {
+    if (Op == CompareOp::Eq || Op == CompareOp::Ne) return _mm256_cmpeq_epi32(v, lit);
+    if (Op == CompareOp::Gt || Op == CompareOp::Le) return _mm256_cmpgt_epi32(v, lit);
+    return _mm256_cmpgt_epi32(lit, v);
+}
+
+template <CompareOp Op>
+__attribute__((target("sse4.2"))) inline __m128i compareInt64Sse42(__m128i v, __m128i lit) {
+    if (Op == CompareOp::Eq || Op == CompareOp::Ne) return _mm_cmpeq_epi64(v, lit);
+    if (Op == CompareOp::Gt || Op == CompareOp::Le) return _mm_cmpgt_epi64(v, lit);
+    return _mm_cmpgt_epi64(lit, v);
+}
+
+template <CompareOp Op>
+__attribute__((target("sse4.2"))) inline __m128i compareInt32Sse42(__m128i v, __m128i lit) {
+    if (Op == CompareOp::Eq || Op == CompareOp::Ne) return _mm_cmpeq_epi32(v, lit);
+    if (Op == CompareOp::Gt || Op == CompareOp::Le) return _mm_cmpgt_epi32(v, lit);
+    return _mm_cmpgt_epi32(lit, v);
+}
+
+// 실수 비교 술어 (NaN은 스칼라 비교와 같게 '<>'만 참)
+template <CompareOp Op>
+constexpr int floatPredicate() {
+    return Op == CompareOp::Eq ? _CMP_EQ_OQ : Op == CompareOp::Ne ? _CMP_NEQ_UQ : Op == CompareOp::Lt ? _CMP_LT_OQ :
+           Op == CompareOp::Gt ? _CMP_GT_OQ : Op == CompareOp::Le ? _CMP_LE_OQ : _CMP_GE_OQ;
+}
+
+template <CompareOp Op>
+__attribute__((target("avx2"))) void compareKernelAvx2(const int64_t* values, size_t count, int64_t literal, uint64_t* bits) {
+    const __m256i lit = _mm256_set1_epi64x(literal);
+    const uint64_t flip = invertsMask(Op) ? 0xF : 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        uint64_t mask = uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(compareInt64Avx2<Op>(v, lit)))) ^ flip;
+        bits[i / 64] |= mask << (i % 64);
+    }
+    for (; i < count; ++i) bits[i / 64] |= uint64_t(Compare<Op>::apply(values[i], literal)) << (i % 64);
+}
+
+template <CompareOp Op>
+__attribute__((target("avx2"))) void compareKernelAvx2(const int32_t* values, size_t count, int32_t literal, uint64_t* bits) {
+    const __m256i lit = _mm256_set1_epi32(literal);
+    const uint64_t flip = invertsMask(Op) ? 0xFF : 0;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        uint64_t mask = uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(compareInt32Avx2<Op>(v, lit)))) ^ flip;
+        bits[i / 64] |= mask << (i % 64);
+    }
+    for (; i < count; ++i) bits[i / 64] |= uint64_t(Compare<Op>::apply(values[i], literal)) << (i % 64);
+}
+
+template <CompareOp Op>
+__attribute__((target("avx2"))) void compareKernelAvx2(const double* values, size_t count, double literal, uint64_t* bits) {
+    const __m256d lit = _mm256_set1_pd(literal);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d v = _mm256_loadu_pd(values + i);
+        uint64_t mask = uint64_t(_mm256_movemask_pd(_mm256_cmp_pd(v, lit, floatPredicate<Op>())));
+        bits[i / 64] |= mask << (i % 64);
+    }
+    for (; i < count; ++i) bits[i / 64] |= uint64_t(Compare<Op>::apply(values[i], literal)) << (i % 64);
+}
+
+template <CompareOp Op>
+__attribute__((target("sse4.2"))) void compareKernelSse42(const int64_t* values, size_t count, int64_t literal, uint64_t* bits) {
+    const __m128i lit = _mm_set1_epi64x(literal);
+    const uint64_t flip = invertsMask(Op) ? 0x3 : 0;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        uint64_t mask = uint64_t(_mm_movemask_pd(_mm_castsi128_pd(compareInt64Sse42<Op>(v, lit)))) ^ flip;
+        bits[i / 64] |= mask << (i % 64);
+    }
+    for (; i < count; ++i) bits[i / 64] |= uint64_t(Compare<Op>::apply(values[i], literal)) << (i % 64);
+}
+
+template <CompareOp Op>
+__attribute__((target("sse4.2"))) void compareKernelSse42(const int32_t* values, size_t count, int32_t literal, uint64_t* bits) {
+    const __m128i lit = _mm_set1_epi32(literal);
+    const uint64_t flip = invertsMask(Op) ? 0xF : 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        uint64_t mask = uint64_t(_mm_movemask_ps(_mm_castsi128_ps(compareInt32Sse42<Op>(v, lit)))) ^ flip;
+        bits[i / 64] |= mask << (i % 64);
+    }
+    for (; i < count; ++i) bits[i / 64] |= uint64_t(Compare<Op>::apply(values[i], literal)) << (i % 64);
+}
+
+template <CompareOp Op>
+__attribute__((target("sse4.2"))) void compareKernelSse42(const double* values, size_t count, double literal, uint64_t* bits) {
+    const __m128d lit = _mm_set1_pd(literal);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d v = _mm_loadu_pd(values + i);
+        __m128d result;
+        switch (Op) {
+            case CompareOp::Eq: result = _mm_cmpeq_pd(v, lit); break;
+            case CompareOp::Ne: result = _mm_cmpneq_pd(v, lit); break;
+            case CompareOp::Lt: result = _mm_cmplt_pd(v, lit); break;
+            case CompareOp::Gt: result = _mm_cmpgt_pd(v, lit); break;
+            case CompareOp::Le: result = _mm_cmple_pd(v, lit); break;
+            default: result = _mm_cmpge_pd(v, lit); break;
+        }
+        bits[i / 64] |= uint64_t(_mm_movemask_pd(result)) << (i % 64);
+    }
+    for (; i < count; ++i) bits[i / 64] |= uint64_t(Compare<Op>::apply(values[i], literal)) << (i % 64);
+}
+#endif
+
+// 감지된 수준에 맞는 비교 커널을 호출하는 함수
+template <typename T, CompareOp Op>
+void compareKernel(const T* values, size_t count, T literal, uint64_t* bits) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (simdLevel == SimdLevel::Avx2) return compareKernelAvx2<Op>(values, count, literal, bits);
+    if (simdLevel == SimdLevel::Sse42) return compareKernelSse42<Op>(values, count, literal, bits);
+#endif
+    compareKernelScalar<T, Op>(values, count, literal, bits);
+}
+
+// 컴파일된 조건 공통 인터페이스
+struct Predicate {
+    virtual ~Predicate() = default;
+    // [begin, end) 구간의 결과를 bits에 씀 (bit i는 begin + i 행, bits는 0으로 초기화되어 있어야 함)
+    virtual void evaluate(size_t begin, size_t end, uint64_t* bits) const = 0;
+    // 한 행만 평가 (인덱스로 찾은 후보 행 확인용)
+    virtual bool matches(size_t row) const = 0;
+    // 세그먼트의 zone map으로 보아 만족하는 행이 있을 수 있는지 (false면 세그먼트를 건너뜀)
+    virtual bool mayMatch(size_t) const { return true; }
+};
+
+// 값 범위 [low, high] 안에 조건을 만족하는 값이 있을 수 있는지 확인하는 함수
+template <CompareOp Op, typename T>
+bool rangeMayMatch(T low, T high, T literal) {
+    switch (Op) {
+        case CompareOp::Eq: return low <= literal && literal <= high;
+        case CompareOp::Ne: return !(low == literal && high == literal);
+        case CompareOp::Lt: return low < literal;
+        case CompareOp::Gt: return high > literal;
+        case CompareOp::Le: return low <= literal;
+        case CompareOp::Ge: return high >= literal;
+    }
+    return true;
+}
+
+// int/float/date 컬럼 조건: 연속 배열과 미리 변환된 리터럴을 SIMD 커널로 비교
+// 배열 자체를 참조하므로 행이 추가되어 배열 위치가 바뀌어도 그대로 사용할 수 있음
+template <typename T, CompareOp Op>
+class NumericPredicate : public Predicate {
+public:
+    NumericPredicate(const ColumnArray<T>& values, const ColumnArray<ZoneRange>& zones, T literal)
+        : values_(values), zones_(zones), literal_(literal) {}
+
+    void evaluate(size_t begin, size_t end, uint64_t* bits) const override {
+        compareKernel<T, Op>(values_.data() + begin, end - begin, literal_, bits);
+    }
+
+    bool matches(size_t row) const override {
+        return Compare<Op>::apply(values_[row], literal_);
+    }
+
+    bool mayMatch(size_t segment) const override {
+        if (segment >= zones_.size()) return true;
+        const ZoneRange& zone = zones_[segment];
+        if constexpr (is_same<T, double>::value) {
+            return rangeMayMatch<Op>(zone.floatMin, zone.floatMax, literal_);
+        } else {
+            return rangeMayMatch<Op>(static_cast<T>(zone.intMin), static_cast<T>(zone.intMax), literal_);
+        }
+    }
+
+private:
+    const ColumnArray<T>& values_;
+    const ColumnArray<ZoneRange>& zones_;
+    T literal_;
+};
+
+// string 컬럼 조건: 오프셋과 문자 버퍼를 직접 읽어 string_view로 비교
+// 사전 인코딩된 컬럼이면 리터럴을 사전 번호로 바꿔 =/!=는 번호 배열을 정수 커널로 비교하고,
+// 범위 비교는 조건을 만족하는 사전 번호 비트맵을 만든 뒤 행마다 번호로 찾아봄
+// (사전이 커지거나 일반 방식으로 바뀔 수 있으므로 번호 변환은 evaluate 호출마다 다시 함)
+template <CompareOp Op>
+class StringPredicate : public Predicate {
+public:
+    StringPredicate(const StringColumn& column, string literal) : column_(column), literal_(move(literal)) {}
+
+    void evaluate(size_t begin, size_t end, uint64_t* bits) const override {
+        if (column_.encoded) return evaluateCodes(begin, end, bits);
+        for (size_t row = begin; row < end; ++row) {
+            size_t i = row - begin;
+            bits[i / 64] |= uint64_t(matches(row)) << (i % 64);
+        }
+    }
+
+    bool matches(size_t row) const override {
+        return Compare<Op>::apply(column_.get(row), string_view(literal_));
+    }
+
+    // 사전에 없는 값과의 = 비교는 어느 세그먼트에서도 만족할 수 없음
+    bool mayMatch(size_t) const override {
+        return !(Op == CompareOp::Eq && column_.encoded && column_.findCode(literal_) < 0);
+    }
+
+private:
+    void evaluateCodes(size_t begin, size_t end, uint64_t* bits) const {
+        size_t count = end - begin;
+        const int32_t* codes = column_.codes.data() + begin;
+        if (Op == CompareOp::Eq || Op == CompareOp::Ne) {
+            int32_t code = column_.findCode(literal_);
+            if (code >= 0) return compareKernel<int32_t, Op>(codes, count, code, bits);
+            if (Op == CompareOp::Ne) fillBits(bits, count);
+            return;
+        }
+
+        // 값 순서에서 리터럴 위치를 찾아 만족하는 사전 번호 구간을 비트맵으로 표시
+        size_t entries = column_.sortedCodes.size();
+        size_t position = column_.lowerBound(literal_);
+        bool found = position < entries && column_.entry(column_.sortedCodes[position]) == literal_;
+        size_t first = 0, last = entries;
+        switch (Op) {
+            case CompareOp::Lt: last = position; break;
+            case CompareOp::Le: last = position + (found ? 1 : 0); break;
+            case CompareOp::Gt: first = position + (found ? 1 : 0); break;
+            default: first = position; break;
+        }
+        vector<uint64_t> matching((entries + 63) / 64, 0);
+        for (size_t k = first; k < last; ++k) {
+            size_t code = column_.sortedCodes[k];
+            matching[code / 64] |= 1ull << (code % 64);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            size_t code = codes[i];
+            bits[i / 64] |= ((matching[code / 64] >> (code % 64)) & 1) << (i % 64);
+        }
+    }
+
+    const StringColumn& column_;
+    string literal_;
+};
+
+// 연산자나 리터럴이 올바르지 않은 조건: 어떤 행도 만족하지 않음
+class FalsePredicate : public Predicate {
+public:
+    void evaluate(size_t, size_t, uint64_t*) const override {}
+    bool matches(size_t) const override { return false; }
+};
+
+template <CompareOp Op>
+unique_ptr<Predicate> compilePredicateFor(const ColumnData& column, const Condition& cond) {
+    switch (column.type) {
+        case ColumnType::Int:
+            return unique_ptr<Predicate>(new NumericPredicate<int64_t, Op>(column.ints, column.zones, cond.intValue));
+        case ColumnType::Float:
+            return unique_ptr<Predicate>(new NumericPredicate<double, Op>(column.floats, column.zones, cond.floatValue));
+        case ColumnType::Date:
+            return unique_ptr<Predicate>(new NumericPredicate<int32_t, Op>(column.dates, column.zones, cond.dateValue));
+        case ColumnType::String: return unique_ptr<Predicate>(new StringPredicate<Op>(column.strings, cond.stringValue));
+    }
+    return unique_ptr<Predicate>(new FalsePredicate());
+}
+
+// 조건을 컬럼 타입과 연산자로 특수화된 객체로 컴파일하는 함수
+// 반환된 객체는 컬럼을 참조하므로 테이블이 살아 있는 동안 사용할 수 있음 (행 추가/삭제 후에도 유효)
+unique_ptr<Predicate> compilePredicate(const TableData& table, const Condition& cond) {
+    if (!cond.valid) return unique_ptr<Predicate>(new FalsePredicate());
+    const ColumnData& column = table.columns[cond.columnIndex];
+    switch (cond.op) {
+        case CompareOp::Eq: return compilePredicateFor<CompareOp::Eq>(column, cond);
+        case CompareOp::Ne: return compilePredicateFor<CompareOp::Ne>(column, cond);
+        case CompareOp::Lt: return compilePredicateFor<CompareOp::Lt>(column, cond);
+        case CompareOp::Gt: return compilePredicateFor<CompareOp::Gt>(column, cond);
+        case CompareOp::Le: return compilePredicateFor<CompareOp::Le>(column, cond);
+        case CompareOp::Ge: return compilePredicateFor<CompareOp::Ge>(column, cond);
+    }
+    return unique_ptr<Predicate>(new FalsePredicate());
+}
+
+// 비트맵에서 켜진 비트를 행 번호로 바꿔 out 뒤에 추가하는 함수
+void appendSelection(const uint64_t* bits, size_t words, size_t begin, vector<uint64_t>& out) {
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t word = bits[w];
+        while (word != 0) {
+            out.push_back(begin + w * 64 + __builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+}
+
+// WHERE 절 전체를 컴파일한 필터: OR로 연결된 AND 그룹들 (AND가 OR보다 먼저 묶임)
+// 조건 열과, 스캔한 행에서 읽을 출력 열을 알고 있어 읽기 전에 파일 페이지를 버퍼 풀에 올림
+class RowFilter {
+public:
+    RowFilter(const TableData& table, const vector<vector<Condition>>& groups) : table_(table) {
+        for (const auto& group : groups) {
+            groups_.emplace_back();
+            for (const auto& cond : group) {
+                groups_.back().push_back(compilePredicate(table, cond));
+                if (cond.columnIndex >= 0) addColumn(conditionColumns_, cond.columnIndex);
+            }
+        }
+    }
+
+    // 스캔한 행에서 값을 읽을 열 (SELECT 목록, GROUP BY, ORDER BY, UPDATE가 복사하는 열)
+    void addOutputColumn(int column) { addColumn(outputColumns_, column); }
+
+    // [begin, end) 행의 출력 열 페이지를 올림 (조건 열은 select가 평가하기 전에 올림)
+    void touchOutput(size_t begin, size_t end) const {
+        for (int column : outputColumns_) touchColumn(table_.columns[column], begin, end - begin);
+    }
+
+    // 인덱스로 찾은 행들의 조건 열과 출력 열 페이지를 올림
+    void touchRows(const uint64_t* rows, size_t count) const {
+        for (int column : conditionColumns_) {
+            for (size_t i = 0; i < count; ++i) touchColumn(table_.columns[column], rows[i], 1);
+        }
+        for (int column : outputColumns_) {
+            for (size_t i = 0; i < count; ++i) touchColumn(table_.columns[column], rows[i], 1);
+        }
+    }
+
+    // [begin, end) 구간에서 WHERE 절을 만족하는 행 번호를 out 뒤에 추가
+    // end - begin은 kScanBlockRows 이하, 구간이 한 세그먼트 안이면 zone map으로 만족할 수 없는 그룹은 평가하지 않음
+    void select(size_t begin, size_t end, vector<uint64_t>& out) const {
+        size_t words = bitmapWords(end - begin);
+        size_t segment = begin / kSegmentRows;
+        bool oneSegment = segment == (end - 1) / kSegmentRows;
+        uint64_t result[kScanBlockRows / 64] = {0};
+        uint64_t groupBits[kScanBlockRows / 64];
+        uint64_t termBits[kScanBlockRows / 64];
+        bool touched = false;
+        for (const auto& group : groups_) {
+            if (oneSegment && !groupMayMatch(group, segment)) continue;
+            if (!touched) {
+                for (int column : conditionColumns_) touchColumn(table_.columns[column], begin, end - begin);
+                countRead(end - begin, 0);
+                touched = true;
+            }
+            for (size_t k = 0; k < group.size(); ++k) {
+                uint64_t* target = k == 0 ? groupBits : termBits;
+                fill(target, target + words, 0);
+                group[k]->evaluate(begin, end, target);
+                if (k > 0) {
+                    for (size_t w = 0; w < words; ++w) groupBits[w] &= termBits[w];
+                }
+            }
+            for (size_t w = 0; w < words; ++w) result[w] |= groupBits[w];
+        }
+        if (!touched) counters_.blocksSkipped.fetch_add(1, memory_order_relaxed);
+        appendSelection(result, words, begin, out);
+    }
+
+    // 스캔 통계: 읽은 행 (조건을 평가했거나 조건 없이 넘긴 행), 조건을 만족하고 보이는 행, zone map으로 건너뛴 블록
+    // profiling이 켜져 있으면 (EXPLAIN ANALYZE) 스캔 쪽과 visit 쪽 시간도 나눠 모음 (스레드 합, ns)
+    struct Counters {
+        atomic<uint64_t> rowsRead{0};
+        atomic<uint64_t> rowsMatched{0};
+        atomic<uint64_t> blocksSkipped{0};
+        atomic<uint64_t> scanNanos{0};
+        atomic<uint64_t> visitNanos{0};
+    };
+
+    void countRead(size_t rows, size_t matched) const {
+        counters_.rowsRead.fetch_add(rows, memory_order_relaxed);
+        ioStats.rowsRead.fetch_add(rows, memory_order_relaxed);
+        countMatched(matched);
+    }
+    void countMatched(size_t rows) const { counters_.rowsMatched.fetch_add(rows, memory_order_relaxed); }
+    const Counters& counters() const { return counters_; }
+    void setProfiling(bool on) { profiling_ = on; }
+    atomic<uint64_t>* scanClock() const { return profiling_ ? &counters_.scanNanos : nullptr; }
+    atomic<uint64_t>* visitClock() const { return profiling_ ? &counters_.visitNanos : nullptr; }
+
+    // 조건 하나만 다시 컴파일 (EXECUTE 파라미터 바인딩용)
+    void setPredicate(size_t group, size_t term, unique_ptr<Predicate> predicate) {
+        groups_[group][term] = move(predicate);
+    }
+
+    // 세그먼트에 WHERE 절을 만족하는 행이 있을 수 있는지 (zone map으로 건너뛸 수 있으면 false)
+    bool mayMatch(size_t segment) const {
+        for (const auto& group : groups_) {
+            if (groupMayMatch(group, segment)) return true;
+        }
+        return groups_.empty();
+    }
+
+    bool matches(size_t row) const {
+        for (const auto& group : groups_) {
+            bool all = true;
+            for (const auto& predicate : group) {
+                if (!predicate->matches(row)) {
+                    all = false;
+                    break;
+                }
+            }
+            if (all) return true;
+        }
+        return false;
+    }
+
+private:
+    static bool groupMayMatch(const vector<unique_ptr<Predicate>>& group, size_t segment) {
+        for (const auto& predicate : group) {
+            if (!predicate->mayMatch(segment)) return false;
+        }
+        return true;
+    }
+
+    static void addColumn(vector<int>& columns, int column) {
+        if (find(columns.begin(), columns.end(), column) == columns.end()) columns.push_back(column);
+    }
+
+    const TableData& table_;
+    vector<vector<unique_ptr<Predicate>>> groups_;
+    vector<int> conditionColumns_;
+    vector<int> outputColumns_;
+    mutable Counters counters_;
+    bool profiling_ = false;
+};
+
+// 컬럼 이름으로 위치를 찾는 함수 (없으면 -1)
+int findColumn(const TableSchema& schema, const string& name) {
+    auto it = find(schema.columns.begin(), schema.columns.end(), name);
+    return it == schema.columns.end() ? -1 : static_cast<int>(it - schema.columns.begin());
+}
+
+// ---- 보조 인덱스 (해시 / B+tree) ----
+
+// 컬럼에서 인덱스 키를 꺼내는 함수 (키 타입별 특수화)
+template <typename K> K keyAt(const ColumnData& column, size_t row);
+template <> int64_t keyAt<int64_t>(const ColumnData& column, size_t row) { return column.ints[row]; }
+template <> double keyAt<double>(const ColumnData& column, size_t row) { return column.floats[row]; }
+template <> int32_t keyAt<int32_t>(const ColumnData& column, size_t row) { return column.dates[row]; }
+template <> string keyAt<string>(const ColumnData& column, size_t row) { return string(column.strings.get(row)); }
+
+// 조건의 리터럴을 인덱스 키로 꺼내는 함수
+template <typename K> const K& conditionKey(const Condition& cond);
+template <> const int64_t& conditionKey<int64_t>(const Condition& cond) { return cond.intValue; }
+template <> const double& conditionKey<double>(const Condition& cond) { return cond.floatValue; }
+template <> const int32_t& conditionKey<int32_t>(const Condition& cond) { return cond.dateValue; }
+template <> const string& conditionKey<string>(const Condition& cond) { return cond.stringValue; }
+
+// '=' 조회용 해시 인덱스
+template <typename K>
+class HashIndex : public IndexStructure {
+public:
+    void build(const ColumnData& column, size_t rowCount, const uint64_t*) override {
+        map_.clear();
+        map_.reserve(rowCount);
+        for (size_t row = 0; row < rowCount; ++row) {
+            map_.emplace(keyAt<K>(column, row), row);
+        }
+    }
+
+    void insert(const ColumnData& column, uint64_t row) override {
+        map_.emplace(keyAt<K>(column, row), row);
+    }
+
+    bool lookup(const Condition& cond, vector<uint64_t>& rows) const override {
+        if (cond.op != CompareOp::Eq) return false;
+        auto range = map_.equal_range(conditionKey<K>(cond));
+        for (auto it = range.first; it != range.second; ++it) {
+            rows.push_back(it->second);
+        }
+        return true;
+    }
+
+    void sortedRows(vector<uint64_t>&) const override {}
+
+private:
+    unordered_multimap<K, uint64_t> map_;
+};
+
+// 범위 조회용 B+tree
+// (키, 행 번호) 쌍을 하나의 키로 보고 정렬하므로 중복 키도 항목이 모두 구분됨
+// 리프 노드는 next로 연결되어 있어 범위 조회는 시작 리프부터 차례로 읽음
+template <typename K>
+class BPlusTree {
+public:
+    struct Entry {
+        K key;
+        uint64_t row;
+
+        bool operator<(const Entry& other) const {
+            return key < other.key || (!(other.key < key) && row < other.row);
+        }
+    };
+
+    BPlusTree() : root_(new Node(true)) {}
+
+    void clear() { root_.reset(new Node(true)); }
+
+    void insert(const Entry& entry) {
+        unique_ptr<Node> sibling;
+        Entry separator;
+        if (insertInto(root_.get(), entry, sibling, separator)) {
+            unique_ptr<Node> newRoot(new Node(false));
+            newRoot->entries.push_back(separator);
+            newRoot->children.push_back(move(root_));
+            newRoot->children.push_back(move(sibling));
+            root_ = move(newRoot);
+        }
+    }
+
+    // 정렬된 항목으로 리프를 채우고 위로 내부 노드를 쌓아 한 번에 만듦
+    void bulkLoad(const vector<Entry>& sorted) {
+        clear();
+        if (sorted.empty()) return;
+
+        vector<unique_ptr<Node>> level;
+        vector<Entry> firstKeys;
+        for (size_t i = 0; i < sorted.size(); i += kFill) {
+            unique_ptr<Node> leaf(new Node(true));
+            leaf->entries.assign(sorted.begin() + i, sorted.begin() + min(sorted.size(), i + kFill));
+            if (!level.empty()) level.back()->next = leaf.get();
+            firstKeys.push_back(leaf->entries.front());
+            level.push_back(move(leaf));
+        }
+        while (level.size() > 1) {
+            vector<unique_ptr<Node>> parents;
+            vector<Entry> parentKeys;
+            for (size_t i = 0; i < level.size(); i += kFill) {
+                unique_ptr<Node> inner(new Node(false));
+                size_t end = min(level.size(), i + kFill);
+                for (size_t j = i; j < end; ++j) {
+                    if (j > i) inner->entries.push_back(firstKeys[j]);
+                    inner->children.push_back(move(level[j]));
+                }
+                parentKeys.push_back(firstKeys[i]);
+                parents.push_back(move(inner));
+            }
+            level = move(parents);
+            firstKeys = move(parentKeys);
+        }
+        root_ = move(level.front());
+    }
+
+    // key 이상인 첫 항목부터 visit를 호출, visit가 false를 돌려주면 중단
+    template <typename Visit>
+    void scanFrom(const K& key, Visit visit) const {
+        const Node* node = root_.get();
+        Entry probe{key, 0};
+        while (!node->leaf) {
+            size_t child = upper_bound(node->entries.begin(), node->entries.end(), probe) - node->entries.begin();
+            node = node->children[child].get();
+        }
+        size_t pos = lower_bound(node->entries.begin(), node->entries.end(), probe) - node->entries.begin();
+        scanLeaves(node, pos, visit);
+    }
+
+    // 가장 작은 항목부터 visit를 호출
+    template <typename Visit>
+    void scanAll(Visit visit) const {
+        const Node* node = root_.get();
+        while (!node->leaf) node = node->children.front().get();
+        scanLeaves(node, 0, visit);
+    }
+
+private:
+    static const size_t kCapacity = 64;       // 노드당 최대 항목 수
+    static const size_t kFill = kCapacity - 8; // 일괄 생성 시 노드당 항목 수 (이후 삽입 여유)
+
+    struct Node {
+        explicit Node(bool isLeaf) : leaf(isLeaf) {}
+        bool leaf;
+        vector<Entry> entries;               // 리프: 항목, 내부: 구분 키 (children.size() - 1개)
+        vector<unique_ptr<Node>> children;   // 내부 노드만 사용
+        Node* next = nullptr;                // 리프 연결
+    };
+
+    template <typename Visit>
+    static void scanLeaves(const Node* node, size_t pos, Visit& visit) {
+        for (; node != nullptr; node = node->next, pos = 0) {
+            for (; pos < node->entries.size(); ++pos) {
+                if (!visit(node->entries[pos])) return;
+            }
+        }
+    }
+
+    // 노드가 넘치면 반으로 나누어 오른쪽 노드와 그 첫 키를 돌려줌
+    bool insertInto(Node* node, const Entry& entry, unique_ptr<Node>& sibling, Entry& separator) {
+        if (node->leaf) {
+            node->entries.insert(upper_bound(node->entries.begin(), node->entries.end(), entry), entry);
+        } else {
+            size_t child = upper_bound(node->entries.begin(), node->entries.end(), entry) - node->entries.begin();
+            unique_ptr<Node> childSibling;
+            Entry childSeparator;
+            if (!insertInto(node->children[child].get(), entry, childSibling, childSeparator)) return false;
+            node->entries.insert(node->entries.begin() + child, childSeparator);
+            node->children.insert(node->children.begin() + child + 1, move(childSibling));
+        }
+        if (node->entries.size() <= kCapacity) return false;
+
+        size_t half = node->entries.size() / 2;
+        sibling.reset(new Node(node->leaf));
+        if (node->leaf) {
+            sibling->entries.assign(node->entries.begin() + half, node->entries.end());
+            node->entries.resize(half);
+            sibling->next = node->next;
+            node->next = sibling.get();
+            separator = sibling->entries.front();
+        } else {
+            separator = node->entries[half];
+            sibling->entries.assign(node->entries.begin() + half + 1, node->entries.end());
+            node->entries.resize(half);
+            for (size_t i = half + 1; i < node->children.size(); ++i) {
+                sibling->children.push_back(move(node->children[i]));
+            }
+            node->children.resize(half + 1);
+        }
+        return true;
+    }
+
+    unique_ptr<Node> root_;
+};
+
+// B+tree 인덱스: '=', '<', '>', '<=', '>=' 조회
+template <typename K>
+class BTreeIndex : public IndexStructure {
+public:
+    using Entry = typename BPlusTree<K>::Entry;
+
+    void build(const ColumnData& column, size_t rowCount, const uint64_t* order) override {
+        vector<Entry> entries;
+        entries.reserve(rowCount);
+        for (size_t i = 0; i < rowCount; ++i) {
+            uint64_t row = order != nullptr ? order[i] : i;
+            entries.push_back(Entry{keyAt<K>(column, row), row});
+        }
+        if (order == nullptr) {
+            sort(entries.begin(), entries.end());
+        }
+        tree_.bulkLoad(entries);
+    }
+
+    void insert(const ColumnData& column, uint64_t row) override {
+        tree_.insert(Entry{keyAt<K>(column, row), row});
+    }
+
+    bool lookup(const Condition& cond, vector<uint64_t>& rows) const override {
+        const K& key = conditionKey<K>(cond);
+        auto collect = [&](const Entry& entry) {
+            rows.push_back(entry.row);
+            return true;
+        };
+        switch (cond.op) {
+            case CompareOp::Eq:
+                tree_.scanFrom(key, [&](const Entry& entry) { return !(key < entry.key) && collect(entry); });
+                return true;
+            case CompareOp::Ge:
+                tree_.scanFrom(key, collect);
+                return true;
+            case CompareOp::Gt:
+                tree_.scanFrom(key, [&](const Entry& entry) { return !(key < entry.key) || collect(entry); });
+                return true;
+            case CompareOp::Lt:
+                tree_.scanAll([&](const Entry& entry) { return entry.key < key && collect(entry); });
+                return true;
+            case CompareOp::Le:
+                tree_.scanAll([&](const Entry& entry) { return !(key < entry.key) && collect(entry); });
+                return true;
+            case CompareOp::Ne:
+                return false;
+        }
+        return false;
+    }
+
+    void sortedRows(vector<uint64_t>& rows) const override {
+        tree_.scanAll([&](const Entry& entry) {
+            rows.push_back(entry.row);
+            return true;
+        });
+    }
+
+private:
+    BPlusTree<K> tree_;
+};
+
+// 컬럼 타입과 인덱스 종류에 맞는 자료구조를 만드는 함수
+template <template <typename> class Index>
+unique_ptr<IndexStructure> makeIndexFor(ColumnType type) {
+    switch (type) {
+        case ColumnType::Int: return unique_ptr<IndexStructure>(new Index<int64_t>());
+        case ColumnType::Float: return unique_ptr<IndexStructure>(new Index<double>());
+        case ColumnType::Date: return unique_ptr<IndexStructure>(new Index<int32_t>());
+        case ColumnType::String: return unique_ptr<IndexStructure>(new Index<string>());
+    }
+    return nullptr;
+}
+
+// 인덱스 자료구조가 아직 없으면 만드는 함수
+void ensureIndexBuilt(const TableData& table, TableIndex& index) {
+    if (index.structure) return;
+    const ColumnData& column = table.columns[index.columnIndex];
+    index.structure = index.kind == IndexKind::Hash ? makeIndexFor<HashIndex>(column.type) : makeIndexFor<BTreeIndex>(column.type);
+    bool hasOrder = index.persistedOrder.size() == table.rowCount;
+    index.structure->build(column, table.rowCount, hasOrder ? index.persistedOrder.data() : nullptr);
+    index.persistedOrder.clear();
+}
+
+// 조건에 쓸 수 있는 인덱스를 고르는 함수 ('='는 해시 인덱스를 먼저, 범위 조건은 B+tree, 없으면 nullptr)
+TableIndex* findUsableIndex(TableData& table, const Condition& cond) {
+    TableIndex* chosen = nullptr;
+    for (auto& index : table.indexes) {
+        if (index.columnIndex != cond.columnIndex) continue;
+        if (index.kind == IndexKind::Hash && cond.op == CompareOp::Eq) return &index;
+        if (index.kind == IndexKind::BTree && cond.op != CompareOp::Ne && !chosen) chosen = &index;
+    }
+    return chosen;
+}
+
+// WHERE 조건을 인덱스로 처리할 수 있으면 만족하는 행 번호를 오름차순으로 돌려주는 함수 (읽는 시점에 보이는 행만)
+// '='는 해시 인덱스를 우선 사용하고, 범위 조건은 B+tree 인덱스만 사용
+// 스냅샷 뷰이면 원본 테이블의 인덱스를 latch를 잡고 찾은 뒤 뷰를 만든 뒤에 추가된 행은 뺌
+bool lookupIndex(TableData& table, const Condition& cond, vector<uint64_t>& rows) {
+    TableData& owner = table.source ? *table.source : table;
+    TableIndex* chosen = findUsableIndex(owner, cond);
+    if (chosen == nullptr) return false;
+
+    rows.clear();
+    if (!cond.valid) return true;
+    {
+        shared_lock<shared_mutex> lock(owner.latch.mutex);
+        while (!chosen->structure) {
+            // 처음 쓰는 인덱스는 배타적으로 잡고 만든 뒤 다시 공유로 (그 사이 writer가 버렸으면 다시 만듦)
+            lock.unlock();
+            {
+                unique_lock<shared_mutex> build(owner.latch.mutex);
+                ensureIndexBuilt(owner, *chosen);
+            }
+            lock.lock();
+        }
+        if (!chosen->structure->lookup(cond, rows)) return false;
+    }
+    if (table.source) {
+        rows.erase(remove_if(rows.begin(), rows.end(), [&](uint64_t row) { return row >= table.rowCount; }), rows.end());
+    }
+    sort(rows.begin(), rows.end()); // 출력 순서를 전체 스캔과 같게 맞춤
+    keepVisibleRows(table, rows);
+    return true;
+}
+
+// 테이블에 인덱스 정의를 추가하는 함수 (자료구조는 처음 사용할 때 생성)
+TableIndex& addIndex(TableData& table, const string& name, int columnIndex, IndexKind kind) {
+    TableIndex index;
+    index.name = name;
+    index.column = table.schema.columns[columnIndex];
+    index.columnIndex = columnIndex;
+    index.kind = kind;
+    table.indexes.push_back(move(index));
+    return table.indexes.back();
+}
+
+// ---- SQL 어휘 분석과 구문 분석 ----
+// 쿼리 문자열을 한 번 훑어 토큰으로 나누고, 토큰을 한 번 읽어 Statement(AST)를 만듦
+// 핸들러는 문자열을 다시 나누지 않고 Statement의 필드만 사용함
+
+enum class TokenKind {
+    Word,   // 키워드, 이름, 따옴표 없는 값 (숫자, 날짜, 파일 경로)
+    String, // "..." (큰따옴표 포함 그대로, 저장 형식과 같음)
+    Quoted, // '...' (작은따옴표 포함 그대로)
+    Param,  // $n 또는 ? (EXECUTE 때 채울 자리, ?는 앞선 번호 다음 번호)
+    Symbol  // ( ) , ; * = <> != < > <= >=
+};
+
+struct Token {
+    TokenKind kind;
+    string text;
+    int param = 0; // Param 토큰의 번호 (1부터)
+};
+
+// 쿼리 문자열을 토큰으로 나누는 함수 (닫히지 않은 따옴표 등은 error에 이유를 담고 false)
+bool tokenize(string_view text, vector<Token>& tokens, string& error) {
+    const string_view delimiters = "(),;*=<>!\"'";
+    tokens.clear();
+    int nextParam = 1;
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (c == '"' || c == '\'') {
+            size_t close = text.find(c, i + 1);
+            if (close == string_view::npos) {
+                error = "SQL 구문 오류: 닫히지 않은 따옴표가 있습니다.";
+                return false;
+            }
+            tokens.push_back({c == '"' ? TokenKind::String : TokenKind::Quoted, string(text.substr(i, close - i + 1))});
+            i = close + 1;
+        } else if (c == '?' || (c == '$' && i + 1 < text.size() && isdigit(static_cast<unsigned char>(text[i + 1])))) {
+            Token token{TokenKind::Param, "", 0};
+            if (c == '?') {
+                token.param = nextParam++;
+                ++i;
+            } else {
+                size_t end = i + 1;
+                while (end < text.size() && isdigit(static_cast<unsigned char>(text[end]))) ++end;
+                int64_t number = 0;
+                if (!parseInt(text.substr(i + 1, end - i - 1), number) || number < 1 || number > 1000) {
+                    error = "SQL 구문 오류: 파라미터 번호는 $1 ~ $1000 이어야 합니다.";
+                    return false;
+                }
+                token.param = static_cast<int>(number);
+                nextParam = max(nextParam, token.param + 1);
+                i = end;
+            }
+            token.text = "$" + to_string(token.param);
+            tokens.push_back(token);
+        } else if (c == '<' || c == '>' || c == '!') {
+            size_t length = i + 1 < text.size() && (text[i + 1] == '=' || (c == '<' && text[i + 1] == '>')) ? 2 : 1;
+            if (c == '!' && length == 1) {
+                error = "SQL 구문 오류: 알 수 없는 기호 '!' 입니다.";
+                return false;
+            }
+            tokens.push_back({TokenKind::Symbol, string(text.substr(i, length))});
+            i += length;
+        } else if (delimiters.find(c) != string_view::npos) {
+            tokens.push_back({TokenKind::Symbol, string(1, c)});
+            ++i;
+        } else {
+            size_t end = i;
+            while (end < text.size() && !isspace(static_cast<unsigned char>(text[end])) && delimiters.find(text[end]) == string_view::npos) {
+                ++end;
+            }
+            tokens.push_back({TokenKind::Word, string(text.substr(i, end - i))});
+            i = end;
+        }
+    }
+    return true;
+}
+
+// 쿼리에 적힌 값 하나 (param이 0이 아니면 EXECUTE 때 채울 $param 자리)
+struct SqlValue {
+    string text;
+    int param = 0;
+};
+
+// WHERE 절의 조건 하나
+struct WhereTerm {
+    string column;
+    string op;
+    SqlValue value;
+};
+
+// OR로 연결된 AND 그룹들
+using WhereTerms = vector<vector<WhereTerm>>;
+
+// SELECT 목록의 집계 함수 (None이면 일반 열)
+enum class AggregateFunc { None, Count, Sum, Avg, Min, Max };
+
+// SELECT 목록의 항목 하나
+struct SelectItem {
+    AggregateFunc func = AggregateFunc::None;
+    string column; // COUNT(*)이면 비어 있음
+};
+
+// 결과 헤더에 쓰는 항목 이름 ("id", "COUNT(*)", "SUM(amount)" ...)
+string selectItemLabel(const SelectItem& item) {
+    switch (item.func) {
+        case AggregateFunc::None: return item.column;
+        case AggregateFunc::Count: return "COUNT(" + (item.column.empty() ? string("*") : item.column) + ")";
+        case AggregateFunc::Sum: return "SUM(" + item.column + ")";
+        case AggregateFunc::Avg: return "AVG(" + item.column + ")";
+        case AggregateFunc::Min: return "MIN(" + item.column + ")";
+        case AggregateFunc::Max: return "MAX(" + item.column + ")";
+    }
+    return item.column;
+}
+
+// ORDER BY 항목 하나 (열 또는 SELECT 목록의 집계 함수)
+struct OrderItem {
+    SelectItem item;
+    bool descending = false;
+};
+
+enum class StatementKind {
+    CreateDatabase,
+    CreateTable,
+    CreateIndex,
+    Use,
+    Insert,
+    Select,
+    Delete,
+    Update,
+    Commit,
+    Checkpoint,
+    Set,
+    Copy,
+    Prepare,
+    Execute,
+    Deallocate,
+    Explain,
+    Show
+};
+
+const size_t kStatementKinds = static_cast<size_t>(StatementKind::Show) + 1;
+
+// SHOW STATS에 쓰는 문장 종류 이름
+const char* statementKindName(StatementKind kind) {
+    static const char* const names[kStatementKinds] = {
+        "CREATE DATABASE", "CREATE TABLE", "CREATE INDEX", "USE", "INSERT", "SELECT", "DELETE", "UPDATE", "COMMIT",
+        "CHECKPOINT", "SET", "COPY", "PREPARE", "EXECUTE", "DEALLOCATE", "EXPLAIN", "SHOW"};
+    return names[static_cast<size_t>(kind)];
+}
+
+// 문장 종류별 지연 시간 히스토그램 (잠금 대기 포함, ms 구간 상한; 마지막 칸은 상한을 넘은 나머지)
+const double kLatencyBoundsMs[] = {0.1, 0.5, 1, 5, 10, 50, 100, 500, 1000, 5000};
+const size_t kLatencyBuckets = sizeof(kLatencyBoundsMs) / sizeof(kLatencyBoundsMs[0]) + 1;
+
+struct LatencyHistogram {
+    atomic<uint64_t> count{0};
+    atomic<uint64_t> totalMicros{0};
+    atomic<uint64_t> maxMicros{0};
+    atomic<uint64_t> buckets[kLatencyBuckets] = {};
+
+    void record(uint64_t micros) {
+        count.fetch_add(1, memory_order_relaxed);
+        totalMicros.fetch_add(micros, memory_order_relaxed);
+        uint64_t seen = maxMicros.load(memory_order_relaxed);
+        while (micros > seen && !maxMicros.compare_exchange_weak(seen, micros, memory_order_relaxed)) {}
+        size_t bucket = 0;
+        while (bucket + 1 < kLatencyBuckets && micros > kLatencyBoundsMs[bucket] * 1000) ++bucket;
+        buckets[bucket].fetch_add(1, memory_order_relaxed);
+    }
+};
+
+LatencyHistogram statementLatency[kStatementKinds];
+
+// 파싱된 문장 하나 (종류에 해당하는 필드만 사용)
+struct Statement {
+    StatementKind kind = StatementKind::Commit;
+    string name;                   // 데이터베이스 / 인덱스 / 준비된 문장 이름, SET 옵션 이름
+    string tableName;
+    string tableAlias;             // SELECT ... FROM table [AS] alias
+    string joinTable;              // JOIN 테이블 (비어 있으면 단일 테이블 SELECT)
+    string joinAlias;
+    string joinLeft, joinRight;    // JOIN ... ON joinLeft = joinRight
+    vector<string> columns;        // CREATE TABLE 열 이름, CREATE INDEX 열, UPDATE SET 열
+    vector<SelectItem> items;      // SELECT 목록 (비어 있으면 *)
+    vector<string> groupBy;        // GROUP BY 열 목록
+    vector<OrderItem> orderBy;     // ORDER BY 항목 목록
+    int64_t limit = -1;            // LIMIT n (없으면 -1)
+    vector<string> columnTypes;    // CREATE TABLE 열 타입
+    IndexKind indexKind = IndexKind::BTree;
+    vector<vector<SqlValue>> rows; // INSERT 값, UPDATE SET 값 (쿼리에 적힌 그대로)
+    WhereTerms where;              // WHERE 절 (없으면 비어 있음)
+    string value;                  // SET 값, COPY 파일 경로, SHOW 출력 형식
+    string text;                   // 토큰 사이 공백을 맞춘 SELECT 문장 (결과 캐시를 켰을 때만, 캐시 키)
+    bool header = false;           // COPY ... HEADER
+    bool analyze = false;          // EXPLAIN ANALYZE
+    int paramCount = 0;            // 문장 안의 가장 큰 파라미터 번호
+    shared_ptr<Statement> body;    // PREPARE ... AS 뒤의 문장, EXPLAIN 뒤의 문장
+    vector<string> params;         // EXECUTE 파라미터 값
+};
+
+// 토큰 [begin, end)를 읽어 Statement를 만드는 파서
+// 키워드는 대소문자를 구분하지 않음
+class SqlParser {
+public:
+    SqlParser(const vector<Token>& tokens, size_t begin, size_t end) : tokens_(tokens), pos_(begin), end_(end) {}
+
+    // 문장 하나를 끝까지 파싱 (실패하면 error에 이유를 담고 false)
+    bool parseStatement(Statement& stmt, string& error) {
+        string command;
+        if (!readName(command)) {
+            error = "SQL 구문 오류: 명령어가 없습니다.";
+            return false;
+        }
+        for (auto& c : command) c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+
+        bool ok;
+        if (command == "CREATE") ok = parseCreate(stmt, error);
+        else if (command == "USE") ok = parseName(stmt, StatementKind::Use, stmt.name, error);
+        else if (command == "INSERT") ok = parseInsert(stmt, error);
+        else if (command == "SELECT") ok = parseSelect(stmt, error);
+        else if (command == "DELETE") ok = parseDelete(stmt, error);
+        else if (command == "UPDATE") ok = parseUpdate(stmt, error);
+        else if (command == "COMMIT") ok = parseBare(stmt, StatementKind::Commit, error);
+        else if (command == "CHECKPOINT") ok = parseBare(stmt, StatementKind::Checkpoint, error);
+        else if (command == "SET") ok = parseSet(stmt, error);
+        else if (command == "COPY") ok = parseCopy(stmt, error);
+        else if (command == "PREPARE") ok = parsePrepare(stmt, error);
+        else if (command == "EXECUTE") ok = parseExecute(stmt, error);
+        else if (command == "DEALLOCATE") ok = parseName(stmt, StatementKind::Deallocate, stmt.name, error);
+        else if (command == "EXPLAIN") ok = parseExplain(stmt, error);
+        else if (command == "SHOW") ok = parseShow(stmt, error);
+        else {
+            error = "Unsupported command: " + command;
+            return false;
+        }
+        stmt.paramCount = maxParam_;
+        return ok;
+    }
+
+    // "a > 1 AND b = 2 OR c < 3" 형태의 WHERE 조건들 (AND가 OR보다 먼저 묶임)
+    bool parseWhere(WhereTerms& terms) {
+        terms.assign(1, {});
+        while (true) {
+            WhereTerm term;
+            const Token* op;
+            if (!readName(term.column) || (op = peek()) == nullptr || op->kind != TokenKind::Symbol ||
+                op->text == "(" || op->text == ")" || op->text == "," || op->text == "*") {
+                return false;
+            }
+            term.op = op->text;
+            ++pos_;
+            if (!readValue(term.value)) return false;
+            terms.back().push_back(term);
+            if (acceptKeyword("OR")) {
+                terms.emplace_back();
+            } else if (!acceptKeyword("AND")) {
+                return true;
+            }
+        }
+    }
+
+    bool atEnd() const { return pos_ >= end_; }
+
+private:
+    const Token* peek() const { return pos_ < end_ ? &tokens_[pos_] : nullptr; }
+
+    bool acceptKeyword(const char* keyword) {
+        const Token* token = peek();
+        if (token == nullptr || token->kind != TokenKind::Word || strcasecmp(token->text.c_str(), keyword) != 0) return false;
+        ++pos_;
+        return true;
+    }
+
+    bool acceptSymbol(const char* symbol) {
+        const Token* token = peek();
+        if (token == nullptr || token->kind != TokenKind::Symbol || token->text != symbol) return false;
+        ++pos_;
+        return true;
+    }
+
+    bool readName(string& out) {
+        const Token* token = peek();
+        if (token == nullptr || token->kind != TokenKind::Word) return false;
+        out = token->text;
+        ++pos_;
+        return true;
+    }
+
+    bool readValue(SqlValue& out) {
+        const Token* token = peek();
+        if (token == nullptr || token->kind == TokenKind::Symbol) return false;
+        out.text = token->text;
+        out.param = token->param;
+        maxParam_ = max(maxParam_, token->param);
+        ++pos_;
+        return true;
+    }
+
+    // "(v, v, ...)" 한 행
+    bool readTuple(vector<SqlValue>& values) {
+        if (!acceptSymbol("(")) return false;
+        values.clear();
+        do {
+            values.emplace_back();
+            if (!readValue(values.back())) return false;
+        } while (acceptSymbol(","));
+        return acceptSymbol(")");
+    }
+
+    bool parseBare(Statement& stmt, StatementKind kind, string& error) {
+        stmt.kind = kind;
+        if (atEnd()) return true;
+        error = "SQL 구문 오류: " + peek()->text + " 근처에 알 수 없는 내용이 있습니다.";
+        return false;
+    }
+
+    bool parseName(Statement& stmt, StatementKind kind, string& out, string& error) {
+        if (!readName(out)) {
+            error = "SQL 구문 오류: 이름이 필요합니다.";
+            return false;
+        }
+        return parseBare(stmt, kind, error);
+    }
+
+    // SHOW name [format]
+    bool parseShow(Statement& stmt, string& error) {
+        if (!readName(stmt.name)) {
+            error = "SQL 구문 오류: 이름이 필요합니다.";
+            return false;
+        }
+        if (!atEnd()) readName(stmt.value);
+        return parseBare(stmt, StatementKind::Show, error);
+    }
+
+    // CREATE DATABASE name | CREATE TABLE name (type)column ... | CREATE INDEX name ON table (column) [USING HASH|BTREE]
+    bool parseCreate(Statement& stmt, string& error) {
+        if (acceptKeyword("DATABASE")) return parseName(stmt, StatementKind::CreateDatabase, stmt.name, error);
+        if (acceptKeyword("TABLE")) {
+            stmt.kind = StatementKind::CreateTable;
+            error = "ERROR: 잘못된 테이블 정의입니다. 형식은 다음과 같아야 합니다: (type)column_name";
+            if (!readName(stmt.tableName)) return false;
+            while (!atEnd()) {
+                string type, column;
+                if (!acceptSymbol("(") || !readName(type) || !acceptSymbol(")") || !readName(column)) return false;
+                stmt.columnTypes.push_back(type);
+                stmt.columns.push_back(column);
+                acceptSymbol(",");
+            }
+            return true;
+        }
+        if (acceptKeyword("INDEX")) {
+            stmt.kind = StatementKind::CreateIndex;
+            error = "Invalid CREATE INDEX query syntax. Use CREATE INDEX index_name ON table_name (column_name) [USING HASH|BTREE];";
+            stmt.columns.resize(1);
+            if (!readName(stmt.name) || !acceptKeyword("ON") || !readName(stmt.tableName) || !acceptSymbol("(") ||
+                !readName(stmt.columns[0]) || !acceptSymbol(")")) {
+                return false;
+            }
+            if (acceptKeyword("USING")) {
+                if (acceptKeyword("HASH")) {
+                    stmt.indexKind = IndexKind::Hash;
+                } else if (!acceptKeyword("BTREE")) {
+                    error = "ERROR: 지원하지 않는 인덱스 종류입니다. USING HASH 또는 USING BTREE를 사용해주세요.";
+                    return false;
+                }
+            }
+            return parseBare(stmt, StatementKind::CreateIndex, error);
+        }
+        const Token* type = peek();
+        error = "Unsupported CREATE command type: " + (type == nullptr ? string() : type->text);
+        return false;
+    }
+
+    // INSERT INTO table VALUES (v, ...), (v, ...) | INSERT INTO table v v ...
+    bool parseInsert(Statement& stmt, string& error) {
+        stmt.kind = StatementKind::Insert;
+        error = "Invalid INSERT query syntax. Use INSERT INTO table_name VALUES (value, ...), (value, ...);";
+        if (!acceptKeyword("INTO") || !readName(stmt.tableName)) return false;
+        if (acceptKeyword("VALUES")) {
+            do {
+                stmt.rows.emplace_back();
+                if (!readTuple(stmt.rows.back())) return false;
+            } while (acceptSymbol(","));
+            return atEnd();
+        }
+        stmt.rows.emplace_back();
+        while (!atEnd()) {
+            stmt.rows.back().emplace_back();
+            if (!readValue(stmt.rows.back().back())) return false;
+        }
+        return true;
+    }
+
+    // SELECT 목록 항목 하나: column | COUNT(*) | COUNT(column) | SUM/AVG/MIN/MAX(column)
+    bool readSelectItem(SelectItem& item) {
+        if (!readName(item.column)) return false;
+        const Token* open = peek();
+        if (open == nullptr || open->kind != TokenKind::Symbol || open->text != "(") return true;
+
+        static const pair<const char*, AggregateFunc> kFunctions[] = {
+            {"COUNT", AggregateFunc::Count}, {"SUM", AggregateFunc::Sum}, {"AVG", AggregateFunc::Avg},
+            {"MIN", AggregateFunc::Min},     {"MAX", AggregateFunc::Max},
+        };
+        for (const auto& function : kFunctions) {
+            if (strcasecmp(item.column.c_str(), function.first) == 0) item.func = function.second;
+        }
+        if (item.func == AggregateFunc::None || !acceptSymbol("(")) return false;
+        item.column.clear();
+        if (!(item.func == AggregateFunc::Count && acceptSymbol("*")) && !readName(item.column)) return false;
+        return acceptSymbol(")");
+    }
+
+    // 테이블 이름 뒤의 "[AS] alias" (다음 절의 키워드는 별칭이 아님)
+    bool readAlias(string& alias) {
+        static const char* const kClauseKeywords[] = {"JOIN", "INNER", "ON", "WHERE", "GROUP", "ORDER", "LIMIT"};
+        bool explicitAs = acceptKeyword("AS");
+        const Token* token = peek();
+        if (token == nullptr || token->kind != TokenKind::Word) return !explicitAs;
+        for (const char* keyword : kClauseKeywords) {
+            if (strcasecmp(token->text.c_str(), keyword) == 0) return !explicitAs;
+        }
+        return readName(alias);
+    }
+
+    // SELECT * | item[, item ...] FROM table [[INNER] JOIN table ON a.x = b.y] [WHERE ...] [GROUP BY column[, column ...]]
+    //        [ORDER BY item [ASC|DESC][, ...]] [LIMIT n]
+    bool parseSelect(Statement& stmt, string& error) {
+        stmt.kind = StatementKind::Select;
+        bool sawFrom = false;
+        if (acceptSymbol("*")) {
+            sawFrom = acceptKeyword("FROM");
+        } else {
+            SelectItem item;
+            while (!(sawFrom = acceptKeyword("FROM")) && !atEnd()) {
+                item = SelectItem();
+                if (!readSelectItem(item)) {
+                    error = "SQL 구문 오류: SELECT 목록은 column 또는 COUNT(*) / SUM(column) / AVG / MIN / MAX 형식이어야 합니다.";
+                    return false;
+                }
+                stmt.items.push_back(item);
+                acceptSymbol(",");
+            }
+        }
+        if (!sawFrom) {
+            error = "SQL 구문 오류: 'FROM' 키워드가 누락되었습니다.";
+            return false;
+        }
+        if (!readName(stmt.tableName) || !readAlias(stmt.tableAlias)) {
+            error = "SQL 구문 오류: 테이블 이름이 필요합니다.";
+            return false;
+        }
+        bool inner = acceptKeyword("INNER");
+        if (acceptKeyword("JOIN")) {
+            error = "SQL 구문 오류: JOIN 절은 JOIN table ON column = column 형식이어야 합니다.";
+            if (!readName(stmt.joinTable) || !readAlias(stmt.joinAlias) || !acceptKeyword("ON") || !readName(stmt.joinLeft) ||
+                !acceptSymbol("=") || !readName(stmt.joinRight)) {
+                return false;
+            }
+        } else if (inner) {
+            error = "SQL 구문 오류: INNER 뒤에는 JOIN이 와야 합니다.";
+            return false;
+        }
+        error = "SQL 구문 오류: WHERE 절은 column operator value [AND|OR ...] 형식이어야 합니다.";
+        if (acceptKeyword("WHERE") && !parseWhere(stmt.where)) return false;
+        if (acceptKeyword("GROUP")) {
+            error = "SQL 구문 오류: GROUP BY 절은 GROUP BY column[, column ...] 형식이어야 합니다.";
+            string column;
+            if (!acceptKeyword("BY")) return false;
+            do {
+                if (!readName(column)) return false;
+                stmt.groupBy.push_back(column);
+            } while (acceptSymbol(","));
+        }
+        if (acceptKeyword("ORDER")) {
+            error = "SQL 구문 오류: ORDER BY 절은 ORDER BY column [ASC|DESC][, ...] 형식이어야 합니다.";
+            if (!acceptKeyword("BY")) return false;
+            do {
+                OrderItem order;
+                if (!readSelectItem(order.item)) return false;
+                if (acceptKeyword("DESC")) order.descending = true;
+                else acceptKeyword("ASC");
+                stmt.orderBy.push_back(order);
+            } while (acceptSymbol(","));
+        }
+        if (acceptKeyword("LIMIT")) {
+            error = "SQL 구문 오류: LIMIT 뒤에는 0 이상의 정수가 와야 합니다.";
+            string count;
+            if (!readName(count) || !parseInt(count, stmt.limit) || stmt.limit < 0) return false;
+        }
+        return parseBare(stmt, StatementKind::Select, error);
+    }
+
+    // DELETE FROM table WHERE ...
+    bool parseDelete(Statement& stmt, string& error) {
+        stmt.kind = StatementKind::Delete;
+        error = "Invalid DELETE query syntax. Use DELETE FROM table_name WHERE column operator value [AND|OR ...];";
+        if (!acceptKeyword("FROM") || !readName(stmt.tableName)) return false;
+        if (!acceptKeyword("WHERE")) {
+            error = "Invalid DELETE query syntax. Missing WHERE clause. Use DELETE FROM table_name WHERE column operator value [AND|OR ...];";
+            return false;
+        }
+        return parseWhere(stmt.where) && atEnd();
+    }
+
+    // UPDATE table SET column = value[, column = value ...] WHERE ...
+    bool parseUpdate(Statement& stmt, string& error) {
+        stmt.kind = StatementKind::Update;
+        error = "Invalid UPDATE query syntax. Use UPDATE table_name SET column = value[, ...] WHERE column operator value [AND|OR ...];";
+        if (!readName(stmt.tableName) || !acceptKeyword("SET")) return false;
+        stmt.rows.emplace_back();
+        do {
+            stmt.columns.emplace_back();
+            stmt.rows.back().emplace_back();
+            if (!readName(stmt.columns.back()) || !acceptSymbol("=") || !readValue(stmt.rows.back().back())) return false;
+        } while (acceptSymbol(","));
+        if (!acceptKeyword("WHERE")) {
+            error = "Invalid UPDATE query syntax. Missing WHERE clause. Use UPDATE table_name SET column = value[, ...] WHERE column operator value [AND|OR ...];";
+            return false;
+        }
+        return parseWhere(stmt.where) && atEnd();
+    }
+
+    // SET name value
+    bool parseSet(Statement& stmt, string& error) {
+        error = "Invalid SET query syntax. Use SET THREADS n; (1 ~ 1024)";
+        return readName(stmt.name) && readName(stmt.value) && parseBare(stmt, StatementKind::Set, error);
+    }
+
+    // COPY table FROM 'file.csv' [HEADER]
+    bool parseCopy(Statement& stmt, string& error) {
+        error = "Invalid COPY query syntax. Use COPY table_name FROM 'file.csv' [HEADER];";
+        SqlValue path;
+        if (!readName(stmt.tableName) || !acceptKeyword("FROM") || !readValue(path) || path.param != 0) return false;
+        stmt.value = path.text;
+        if (path.text.size() >= 2 && (path.text.front() == '\'' || path.text.front() == '"')) {
+            stmt.value = path.text.substr(1, path.text.size() - 2);
+        }
+        stmt.header = acceptKeyword("HEADER");
+        return parseBare(stmt, StatementKind::Copy, error);
+    }
+
+    // PREPARE name AS SELECT ... | INSERT ... | DELETE ... | UPDATE ...
+    bool parsePrepare(Statement& stmt, string& error) {
+        stmt.kind = StatementKind::Prepare;
+        if (!readName(stmt.name) || !acceptKeyword("AS")) {
+            error = "Invalid PREPARE query syntax. Use PREPARE name AS SELECT | INSERT | DELETE | UPDATE ...;";
+            return false;
+        }
+        stmt.body = make_shared<Statement>();
+        if (!parseStatement(*stmt.body, error)) return false;
+        StatementKind kind = stmt.body->kind;
+        if (kind != StatementKind::Select && kind != StatementKind::Insert && kind != StatementKind::Delete &&
+            kind != StatementKind::Update) {
+            error = "ERROR: PREPARE는 SELECT / INSERT / DELETE / UPDATE 문장만 지원합니다.";
+            return false;
+        }
+        stmt.kind = StatementKind::Prepare;
+        return true;
+    }
+
+    // EXPLAIN [ANALYZE] SELECT ...
+    bool parseExplain(Statement& stmt, string& error) {
+        stmt.analyze = acceptKeyword("ANALYZE");
+        stmt.body = make_shared<Statement>();
+        if (!parseStatement(*stmt.body, error)) return false;
+        if (stmt.body->kind != StatementKind::Select) {
+            error = "ERROR: EXPLAIN은 SELECT 문장만 지원합니다.";
+            return false;
+        }
+        stmt.kind = StatementKind::Explain;
+        return true;
+    }
+
+    // EXECUTE name [(v, ...)]
+    bool parseExecute(Statement& stmt, string& error) {
+        stmt.kind = StatementKind::Execute;
+        error = "Invalid EXECUTE query syntax. Use EXECUTE name [(value, ...)];";
+        if (!readName(stmt.name)) return false;
+        if (!atEnd()) {
+            vector<SqlValue> values;
+            if (!readTuple(values)) return false;
+            for (const auto& value : values) {
+                if (value.param != 0) return false;
+                stmt.params.push_back(value.text);
+            }
+        }
+        return parseBare(stmt, StatementKind::Execute, error);
+    }
+
+    const vector<Token>& tokens_;
+    size_t pos_;
+    size_t end_;
+    int maxParam_ = 0;
+};
+
+// WHERE 절 문자열을 파싱하는 함수 (문법 오류면 false) - 로그에 기록된 WHERE 절을 다시 읽을 때 사용
+bool parseWhereTerms(const string& text, WhereTerms& terms) {
+    vector<Token> tokens;
+    string error;
+    if (!tokenize(text, tokens, error)) return false;
+    SqlParser parser(tokens, 0, tokens.size());
+    return parser.parseWhere(terms) && parser.atEnd();
+}
+
+// WHERE 조건들을 다시 문자열로 만드는 함수 (파라미터 자리는 params 값으로 채움)
+string whereText(const WhereTerms& terms, const vector<string>& params = {}) {
+    string text;
+    for (size_t g = 0; g < terms.size(); ++g) {
+        if (g > 0) text += " OR ";
+        for (size_t t = 0; t < terms[g].size(); ++t) {
+            const WhereTerm& term = terms[g][t];
+            if (t > 0) text += " AND ";
+            text += term.column + " " + term.op + " ";
+            text += term.value.param > 0 && term.value.param <= static_cast<int>(params.size()) ? params[term.value.param - 1] : term.value.text;
+        }
+    }
+    return text;
+}
+
+// WHERE 조건들을 테이블 컬럼 타입에 맞게 변환하는 함수 (없는 컬럼이면 missingColumn에 이름을 담고 false)
+bool resolveWhere(const TableData& table, const WhereTerms& terms, vector<vector<Condition>>& groups, string& missingColumn) {
+    groups.clear();
+    for (const auto& termGroup : terms) {
+        groups.emplace_back();
+        for (const auto& term : termGroup) {
+            int columnIndex = findColumn(table.schema, term.column);
+            if (columnIndex < 0) {
+                missingColumn = term.column;
+                return false;
+            }
+            groups.back().push_back(makeCondition(table, columnIndex, term.op, term.value.text));
+        }
+    }
+    return true;
+}
+
+// ---- 모셀 단위 병렬 스캔 ----
+// 테이블을 고정 크기 모셀로 나눠 스레드 풀이 나눠 필터링하고, 결과는 모셀 순서대로 합쳐
+// 스레드 수와 관계없이 항상 같은 순서가 나옴
+
+const size_t kMorselRows = 16 * kScanBlockRows; // 모셀 하나의 행 수
+
+// 작업 훔치기(work-stealing) 스레드 풀
+// 스레드마다 작업 큐를 두고 자기 큐 앞에서 꺼내다가 비면 다른 스레드 큐 뒤에서 훔쳐 옴
+// run()을 호출한 스레드도 0번 큐를 맡아 함께 일함
+class ScanThreadPool {
+public:
+    explicit ScanThreadPool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) queues_.emplace_back(new WorkQueue());
+        for (size_t i = 1; i < threads; ++i) workers_.emplace_back(&ScanThreadPool::workerLoop, this, i);
+    }
+
+    ~ScanThreadPool() {
+        {
+            lock_guard<mutex> guard(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    size_t threadCount() const { return queues_.size(); }
+
+    // task(0, worker) ... task(count - 1, worker)를 모든 스레드로 실행하고 전부 끝날 때까지 기다리는 함수
+    // worker는 작업을 실행한 스레드 번호 (0 ~ threadCount() - 1)
+    // 이웃한 작업끼리 같은 스레드에 가도록 구간 단위로 큐에 나눠 담음
+    void run(size_t count, const function<void(size_t, size_t)>& task) {
+        if (count == 0) return;
+        task_ = &task;
+        remaining_.store(count);
+        size_t threads = queues_.size();
+        for (size_t q = 0; q < threads; ++q) {
+            lock_guard<mutex> guard(queues_[q]->lock);
+            for (size_t i = count * q / threads; i < count * (q + 1) / threads; ++i) queues_[q]->tasks.push_back(i);
+        }
+        {
+            lock_guard<mutex> guard(mutex_);
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        drain(0);
+        unique_lock<mutex> lock(mutex_);
+        done_.wait(lock, [&] { return remaining_.load() == 0; });
+    }
+
+private:
+    struct WorkQueue {
+        mutex lock;
+        deque<size_t> tasks;
+    };
+
+    // 자기 큐 앞에서 꺼내고, 비어 있으면 다른 큐 뒤에서 훔침
+    bool popTask(size_t self, size_t& task) {
+        {
+            WorkQueue& own = *queues_[self];
+            lock_guard<mutex> guard(own.lock);
+            if (!own.tasks.empty()) {
+                task = own.tasks.front();
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues_.size(); ++k) {
+            WorkQueue& victim = *queues_[(self + k) % queues_.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void drain(size_t self) {
+        size_t task;
+        while (popTask(self, task)) {
+            (*task_)(task, self);
+            if (remaining_.fetch_sub(1) == 1) {
+                lock_guard<mutex> guard(mutex_);
+                done_.notify_all();
+            }
+        }
+    }
+
+    void workerLoop(size_t self) {
+        size_t seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+            drain(self);
+        }
+    }
+
+    vector<unique_ptr<WorkQueue>> queues_;
+    vector<thread> workers_;
+    mutex mutex_;
+    condition_variable wake_;
+    condition_variable done_;
+    const function<void(size_t, size_t)>* task_ = nullptr;
+    atomic<size_t> remaining_{0};
+    size_t generation_ = 0;
+    bool stop_ = false;
+};
+
+// 스캔에 쓸 스레드 수를 정하는 함수
+// 환경 변수 DBMS_THREADS로 지정할 수 있고, 없으면 CPU 코어 수
+size_t defaultScanThreads() {
+    const char* forced = getenv("DBMS_THREADS");
+    int64_t threads = 0;
+    if (forced != nullptr && parseInt(forced, threads) && threads > 0) return static_cast<size_t>(threads);
+    return max<size_t>(1, thread::hardware_concurrency());
+}
+
+size_t scanThreads = defaultScanThreads();   // SET THREADS n 으로 바꿀 수 있음 (1이면 단일 스레드)
+unique_ptr<ScanThreadPool> scanPool;          // 처음 병렬 스캔할 때 만듦
+mutex scanPoolMutex;                          // 스레드 풀은 한 번에 쿼리 하나만 사용
+
+// task(i, worker)를 i = 0 ... count - 1에 대해 실행하는 함수
+// worker는 0 ~ scanThreads - 1 사이의 스레드 번호 (스레드별 부분 결과를 모을 때 사용)
+// 스레드가 하나이거나 작업이 하나면 호출 스레드에서 바로 실행 (worker 0)
+// 서버 모드에서 다른 세션의 쿼리가 풀을 쓰고 있어도 기다리지 않고 호출 스레드에서 실행
+void parallelForWorkers(size_t count, const function<void(size_t, size_t)>& task) {
+    unique_lock<mutex> lock(scanPoolMutex, defer_lock);
+    if (scanThreads <= 1 || count <= 1 || !lock.try_lock()) {
+        for (size_t i = 0; i < count; ++i) task(i, 0);
+        return;
+    }
+    if (!scanPool || scanPool->threadCount() != scanThreads) {
+        scanPool.reset();
+        scanPool.reset(new ScanThreadPool(scanThreads));
+    }
+    scanPool->run(count, task);
+}
+
+// task(0) ... task(count - 1)을 실행하는 함수
+void parallelFor(size_t count, const function<void(size_t)>& task) {
+    parallelForWorkers(count, [&](size_t i, size_t) { task(i); });
+}
+
+// WHERE 절을 만족하고 읽는 시점에 보이는 행 번호를 오름차순으로 찾아 visit(rows, count)에 넘기는 함수 (앞에서부터 limit개까지)
+// groups가 비어 있으면 모든 행을 넘기고, AND로만 이루어진 WHERE에서 인덱스를 쓸 수 있는 조건이 있으면
+// 인덱스로 후보를 찾은 뒤 나머지 조건을 확인함. 그 외에는 블록 단위 비트맵 스캔
+// filter는 groups를 컴파일한 것 (groups가 비어 있으면 사용하지 않음)
+template <typename Visit>
+void scanTable(TableData& table, const vector<vector<Condition>>& groups, const RowFilter& filter, Visit visit,
+               size_t limit = SIZE_MAX) {
+    vector<uint64_t> rows;
+    rows.reserve(kScanBlockRows);
+    if (groups.empty()) {
+        for (size_t begin = 0; begin < table.rowCount && limit > 0; begin += kScanBlockRows) {
+            size_t end = min(table.rowCount, begin + kScanBlockRows);
+            size_t count;
+            {
+                StageTimer timer(filter.scanClock());
+                rows.clear();
+                for (size_t row = begin; row < end; ++row) rows.push_back(row);
+                keepVisibleRows(table, rows);
+                count = min(rows.size(), limit);
+                filter.countRead(end - begin, count);
+                if (count > 0) filter.touchOutput(begin, end);
+            }
+            StageTimer timer(filter.visitClock());
+            if (count > 0) visit(rows.data(), count);
+            limit -= count;
+        }
+        return;
+    }
+
+    if (groups.size() == 1) {
+        for (const auto& cond : groups.front()) {
+            size_t count = 0;
+            {
+                StageTimer timer(filter.scanClock());
+                if (!lookupIndex(table, cond, rows)) continue;
+                filter.touchRows(rows.data(), rows.size());
+                for (uint64_t row : rows) {
+                    if (count < limit && filter.matches(row)) rows[count++] = row;
+                }
+                filter.countRead(rows.size(), count);
+            }
+            StageTimer timer(filter.visitClock());
+            if (count > 0) visit(rows.data(), count);
+            return;
+        }
+    }
+
+    // 모셀마다 선택 벡터를 병렬로 만든 뒤 모셀 순서대로 넘김
+    // LIMIT이 있으면 스레드 수만큼씩 나눠 처리하고, limit개를 채우면 남은 모셀은 보지 않음
+    size_t morsels = (table.rowCount + kMorselRows - 1) / kMorselRows;
+    size_t wave = limit == SIZE_MAX ? max<size_t>(1, morsels) : max<size_t>(1, scanThreads);
+    for (size_t first = 0; first < morsels && limit > 0; first += wave) {
+        size_t count = min(wave, morsels - first);
+        vector<vector<uint64_t>> selected(count);
+        parallelFor(count, [&](size_t i) {
+            size_t morsel = first + i;
+            size_t morselEnd = min(table.rowCount, (morsel + 1) * kMorselRows);
+            StageTimer timer(filter.scanClock());
+            for (size_t begin = morsel * kMorselRows; begin < morselEnd; begin += kScanBlockRows) {
+                size_t from = selected[i].size();
+                size_t end = min(morselEnd, begin + kScanBlockRows);
+                filter.select(begin, end, selected[i]);
+                keepVisibleRows(table, selected[i], from);
+                filter.countMatched(selected[i].size() - from);
+                if (selected[i].size() > from) filter.touchOutput(begin, end);
+            }
+        });
+        StageTimer timer(filter.visitClock());
+        for (size_t i = 0; i < count; ++i) {
+            size_t visible = min(selected[i].size(), limit);
+            if (visible > 0) visit(selected[i].data(), visible);
+            limit -= visible;
+            vector<uint64_t>().swap(selected[i]);
+        }
+    }
+}
+
+template <typename Visit>
+void scanTable(TableData& table, const vector<vector<Condition>>& groups, Visit visit) {
+    scanTable(table, groups, RowFilter(table, groups), visit);
+}
+
+// scanTable과 같지만 모셀을 처리한 스레드에서 바로 visit(worker, rows, count)를 호출하는 함수 (모셀 간 순서 없음)
+// 집계처럼 스레드별 부분 결과를 만든 뒤 합치는 연산에 사용
+template <typename Visit>
+void scanTableParallel(TableData& table, const vector<vector<Condition>>& groups, const RowFilter& filter, Visit visit) {
+    if (groups.size() == 1) {
+        vector<uint64_t> rows;
+        for (const auto& cond : groups.front()) {
+            size_t count = 0;
+            {
+                StageTimer timer(filter.scanClock());
+                if (!lookupIndex(table, cond, rows)) continue;
+                filter.touchRows(rows.data(), rows.size());
+                for (uint64_t row : rows) {
+                    if (filter.matches(row)) rows[count++] = row;
+                }
+                filter.countRead(rows.size(), count);
+            }
+            StageTimer timer(filter.visitClock());
+            visit(size_t(0), rows.data(), count);
+            return;
+        }
+    }
+
+    size_t morsels = (table.rowCount + kMorselRows - 1) / kMorselRows;
+    parallelForWorkers(morsels, [&](size_t morsel, size_t worker) {
+        vector<uint64_t> rows;
+        rows.reserve(kScanBlockRows);
+        size_t morselEnd = min(table.rowCount, (morsel + 1) * kMorselRows);
+        for (size_t begin = morsel * kMorselRows; begin < morselEnd; begin += kScanBlockRows) {
+            size_t end = min(morselEnd, begin + kScanBlockRows);
+            {
+                StageTimer timer(filter.scanClock());
+                rows.clear();
+                if (groups.empty()) {
+                    for (size_t row = begin; row < end; ++row) rows.push_back(row);
+                    filter.countRead(end - begin, 0);
+                } else {
+                    filter.select(begin, end, rows);
+                }
+                keepVisibleRows(table, rows);
+                filter.countMatched(rows.size());
+            }
+            if (rows.empty()) continue;
+            filter.touchOutput(begin, end);
+            StageTimer timer(filter.visitClock());
+            visit(worker, rows.data(), rows.size());
+        }
+    });
+}
+
+// ---- 해시 집계 (GROUP BY) ----
+// 스레드마다 열린 주소법 해시 테이블에 부분 집계를 만들고 마지막에 하나로 합침
+// 그룹 키는 그 그룹에서 처음 본 행 번호로 기억하고, 키 열의 타입별 값을 직접 해시/비교함
+
+// 해석된 SELECT 항목: 일반 열이면 func가 None, COUNT(*)이면 columnIndex가 -1
+struct AggregateSpec {
+    AggregateFunc func = AggregateFunc::None;
+    int columnIndex = -1;
+};
+
+// 집계 하나의 그룹별 상태 (SUM/AVG는 열 타입에 따라 intSum 또는 floatSum 중 하나만 사용)
+struct AggregateState {
+    int64_t count = 0;
+    union {
+        int64_t intSum = 0;
+        double floatSum;
+    };
+    uint64_t row = UINT64_MAX; // MIN/MAX 값을 가진 행
+};
+
+// 64비트 값 섞기 (splitmix64 마무리 단계)
+uint64_t mixHash(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+// 실수 값을 해시하는 함수 (-0.0과 0.0은 같은 값)
+uint64_t hashDouble(double value) {
+    if (value == 0) value = 0.0;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return mixHash(bits);
+}
+
+// 한 셀의 값을 타입에 맞게 해시하는 함수
+uint64_t hashCell(const ColumnData& column, size_t row) {
+    switch (column.type) {
+        case ColumnType::Int: return mixHash(static_cast<uint64_t>(column.ints[row]));
+        case ColumnType::Float: return hashDouble(column.floats[row]);
+        case ColumnType::Date: return mixHash(static_cast<uint32_t>(column.dates[row]));
+        case ColumnType::String: return hash<string_view>()(column.strings.get(row));
+    }
+    return 0;
+}
+
+// 같은 열의 두 셀을 비교하는 함수 (a < b이면 음수, 같으면 0)
+int compareCells(const ColumnData& column, size_t a, size_t b) {
+    switch (column.type) {
+        case ColumnType::Int: return column.ints[a] < column.ints[b] ? -1 : column.ints[b] < column.ints[a];
+        case ColumnType::Float: return column.floats[a] < column.floats[b] ? -1 : column.floats[b] < column.floats[a];
+        case ColumnType::Date: return column.dates[a] < column.dates[b] ? -1 : column.dates[b] < column.dates[a];
+        case ColumnType::String: return column.strings.get(a).compare(column.strings.get(b));
+    }
+    return 0;
+}
+
+// 열린 주소법(선형 탐사) 해시 집계 테이블
+// 슬롯에는 (해시, 그룹 번호 + 1)만 두고 그룹 키/상태는 그룹 번호 순서의 연속 배열에 둠
+class AggregateHashTable {
+public:
+    AggregateHashTable(const TableData& table, const vector<int>& keyColumns, const vector<AggregateSpec>& specs)
+        : table_(table), keyColumns_(keyColumns), specs_(specs) {
+        slots_.assign(64, Slot());
+        // int/date 열 하나가 키이면 해시가 키와 일대일이므로 해시만 비교하면 됨
+        exactHash_ = keyColumns.size() == 1 && (table.columns[keyColumns[0]].type == ColumnType::Int ||
+                                                table.columns[keyColumns[0]].type == ColumnType::Date);
+    }
+
+    size_t groupCount() const { return groupRows_.size(); }
+    uint64_t groupRow(size_t group) const { return groupRows_[group]; }
+    const AggregateState& state(size_t group, size_t item) const { return states_[group * specs_.size() + item]; }
+
+    // 선택 벡터의 행들을 그룹별로 누적
+    // 블록 단위로 해시를 모두 구하고, 그룹을 찾은 뒤, 집계마다 열 타입으로 특수화된 루프를 돔
+    void add(const uint64_t* rows, size_t count) {
+        hashes_.resize(count);
+        groupIds_.resize(count);
+        hashRows(rows, count, hashes_.data());
+        for (size_t i = 0; i < count; ++i) {
+            size_t group = findOrInsert(hashes_[i], rows[i]);
+            if (rows[i] < groupRows_[group]) groupRows_[group] = rows[i];
+            groupIds_[i] = group;
+        }
+
+        size_t width = specs_.size();
+        for (size_t s = 0; s < width; ++s) {
+            const AggregateSpec& spec = specs_[s];
+            if (spec.func == AggregateFunc::None) continue;
+            AggregateState* states = states_.data() + s;
+            auto forEachRow = [&](auto update) {
+                for (size_t i = 0; i < count; ++i) update(states[groupIds_[i] * width], rows[i]);
+            };
+            if (spec.func == AggregateFunc::Count) {
+                forEachRow([](AggregateState& st, uint64_t) { st.count++; });
+                continue;
+            }
+
+            const ColumnData& column = table_.columns[spec.columnIndex];
+            if (spec.func == AggregateFunc::Sum || spec.func == AggregateFunc::Avg) {
+                if (column.type == ColumnType::Int) {
+                    const int64_t* values = column.ints.data();
+                    forEachRow([values](AggregateState& st, uint64_t row) { st.count++; st.intSum += values[row]; });
+                } else {
+                    const double* values = column.floats.data();
+                    forEachRow([values](AggregateState& st, uint64_t row) { st.count++; st.floatSum += values[row]; });
+                }
+                continue;
+            }
+
+            // MIN / MAX: 값을 가진 행 번호를 기억
+            bool isMin = spec.func == AggregateFunc::Min;
+            auto extremes = [&](const auto* values) {
+                forEachRow([values, isMin](AggregateState& st, uint64_t row) {
+                    st.count++;
+                    if (st.row == UINT64_MAX || (isMin ? values[row] < values[st.row] : values[st.row] < values[row])) st.row = row;
+                });
+            };
+            switch (column.type) {
+                case ColumnType::Int: extremes(column.ints.data()); break;
+                case ColumnType::Float: extremes(column.floats.data()); break;
+                case ColumnType::Date: extremes(column.dates.data()); break;
+                case ColumnType::String:
+                    forEachRow([&](AggregateState& st, uint64_t row) {
+                        st.count++;
+                        if (st.row == UINT64_MAX || better(spec, row, st.row)) st.row = row;
+                    });
+                    break;
+            }
+        }
+    }
+
+    // 다른 스레드의 부분 집계를 합침
+    void merge(const AggregateHashTable& other) {
+        for (size_t g = 0; g < other.groupCount(); ++g) {
+            uint64_t row = other.groupRows_[g];
+            size_t group = findOrInsert(other.groupHashes_[g], row);
+            if (row < groupRows_[group]) groupRows_[group] = row;
+            for (size_t i = 0; i < specs_.size(); ++i) {
+                AggregateState& into = states_[group * specs_.size() + i];
+                const AggregateState& from = other.state(g, i);
+                into.count += from.count;
+                if (specs_[i].func == AggregateFunc::Sum || specs_[i].func == AggregateFunc::Avg) {
+                    if (table_.columns[specs_[i].columnIndex].type == ColumnType::Int) into.intSum += from.intSum;
+                    else into.floatSum += from.floatSum;
+                }
+                if (from.row != UINT64_MAX && (into.row == UINT64_MAX || better(specs_[i], from.row, into.row))) {
+                    into.row = from.row;
+                }
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t group = 0; // 그룹 번호 + 1 (0이면 빈 슬롯)
+    };
+
+    // 행들의 키 해시를 out에 씀 (키 열마다 타입별 루프)
+    void hashRows(const uint64_t* rows, size_t count, uint64_t* out) const {
+        fill(out, out + count, 0x9e3779b97f4a7c15ull);
+        for (int columnIndex : keyColumns_) {
+            const ColumnData& column = table_.columns[columnIndex];
+            switch (column.type) {
+                case ColumnType::Int: {
+                    const int64_t* values = column.ints.data();
+                    for (size_t i = 0; i < count; ++i) out[i] = mixHash(out[i] ^ mixHash(static_cast<uint64_t>(values[rows[i]])));
+                    break;
+                }
+                case ColumnType::Date: {
+                    const int32_t* values = column.dates.data();
+                    for (size_t i = 0; i < count; ++i) out[i] = mixHash(out[i] ^ mixHash(static_cast<uint32_t>(values[rows[i]])));
+                    break;
+                }
+                default:
+                    for (size_t i = 0; i < count; ++i) out[i] = mixHash(out[i] ^ hashCell(column, rows[i]));
+                    break;
+            }
+        }
+    }
+
+    bool sameKey(size_t a, size_t b) const {
+        for (int columnIndex : keyColumns_) {
+            if (compareCells(table_.columns[columnIndex], a, b) != 0) return false;
+        }
+        return true;
+    }
+
+    // MIN이면 a가 더 작을 때, MAX면 더 클 때 true
+    bool better(const AggregateSpec& spec, size_t a, size_t b) const {
+        int order = compareCells(table_.columns[spec.columnIndex], a, b);
+        return spec.func == AggregateFunc::Min ? order < 0 : order > 0;
+    }
+
+    size_t findOrInsert(uint64_t hash, size_t row) {
+        size_t mask = slots_.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots_[i];
+            if (slot.group == 0) {
+                slot.hash = hash;
+                slot.group = static_cast<uint32_t>(groupRows_.size() + 1);
+                groupRows_.push_back(row);
+                groupHashes_.push_back(hash);
+                states_.resize(states_.size() + specs_.size());
+                size_t group = slot.group - 1;
+                if (groupRows_.size() * 2 > slots_.size()) grow();
+                return group;
+            }
+            if (slot.hash == hash && (exactHash_ || sameKey(groupRows_[slot.group - 1], row))) return slot.group - 1;
+        }
+    }
+
+    // 채움 비율이 1/2을 넘으면 두 배로 늘려 다시 배치
+    void grow() {
+        vector<Slot> slots(slots_.size() * 2);
+        size_t mask = slots.size() - 1;
+        for (const Slot& slot : slots_) {
+            if (slot.group == 0) continue;
+            size_t i = slot.hash & mask;
+            while (slots[i].group != 0) i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+        slots_.swap(slots);
+    }
+
+    const TableData& table_;
+    const vector<int>& keyColumns_;
+    const vector<AggregateSpec>& specs_;
+    bool exactHash_ = false;
+    vector<Slot> slots_;
+    vector<uint64_t> groupRows_;   // 그룹의 대표 행 (그룹에서 가장 앞선 행)
+    vector<uint64_t> groupHashes_;
+    vector<AggregateState> states_; // 그룹 번호 * 항목 수 + 항목
+    vector<uint64_t> hashes_;       // add()에서 쓰는 블록별 임시 배열
+    vector<size_t> groupIds_;
+};
+
+// WHERE를 만족하는 행을 스레드별 해시 테이블에 집계한 뒤 result에 합치는 함수
+void aggregateTable(TableData& table, const vector<vector<Condition>>& groups, const RowFilter& filter, AggregateHashTable& result,
+                    const vector<int>& keyColumns, const vector<AggregateSpec>& specs) {
+    vector<unique_ptr<AggregateHashTable>> partials(max<size_t>(1, scanThreads));
+    scanTableParallel(table, groups, filter, [&](size_t worker, const uint64_t* rows, size_t count) {
+        if (!partials[worker]) partials[worker].reset(new AggregateHashTable(table, keyColumns, specs));
+        partials[worker]->add(rows, count);
+    });
+    for (const auto& partial : partials) {
+        if (partial) result.merge(*partial);
+    }
+}
+
+// ---- 바이너리 .mydb 파일 형식 ----
+// [FileHeader][카탈로그][8바이트 정렬된 컬럼 데이터 블록들]
+// 카탈로그: 테이블마다 (이름, 행 수, 컬럼 수), 컬럼마다 (이름, 타입 이름, 블록 위치),
+//          version 3부터 인덱스마다 (이름, 컬럼 이름, 종류, B+tree 정렬 순서 블록 위치)
+//          version 4부터 컬럼마다 zone map 블록 위치 (세그먼트별 ZoneRange 배열, 없으면 크기 0)
+//          version 5부터 string 컬럼마다 사전 인코딩 여부(u8)와 행별 사전 번호, 정렬된 사전 번호 블록 위치
+// int/float/date 컬럼은 원시 배열 블록 하나, string 컬럼은 오프셋 블록과 문자 블록 두 개를 가짐
+// (사전 인코딩된 string 컬럼의 오프셋/문자 블록은 행이 아니라 사전 값을 담음)
+// 값은 호스트(리틀 엔디언) 표현 그대로 저장하므로 mmap 후 파싱 없이 바로 사용할 수 있음
+const char kFileMagic[8] = {'M', 'Y', 'D', 'B', 'B', 'I', 'N', '\0'};
+const uint32_t kFileVersion = 5;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t tableCount;
+    uint64_t catalogSize;   // 헤더 바로 뒤에 오는 카탈로그 바이트 수
+    uint64_t fileSize;      // 쓰는 도중 잘린 파일을 검출하기 위한 전체 크기
+    uint64_t checkpointLsn; // 이 파일에 반영된 마지막 커밋 번호 (version 2부터)
+};
+
+// 버전별 헤더 크기 (version 1 헤더에는 checkpointLsn이 없음)
+size_t headerSize(uint32_t version) {
+    return version == 1 ? offsetof(FileHeader, checkpointLsn) : sizeof(FileHeader);
+}
+
+// 파일 안의 데이터 블록 위치
+struct BlockRef {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+// 카탈로그에 기록되는 컬럼 하나의 정보
+struct ColumnEntry {
+    string name;
+    string typeName;
+    BlockRef values;  // int/float/date 값 또는 string 오프셋 배열
+    BlockRef strings; // string 컬럼의 문자 데이터
+    BlockRef zones;   // 세그먼트별 zone map (version 4부터)
+    bool encoded = false; // string 컬럼의 사전 인코딩 여부 (version 5부터)
+    BlockRef codes;       // 행별 사전 번호
+    BlockRef sortedCodes; // 값 순서로 정렬한 사전 번호
+};
+
+uint64_t alignTo8(uint64_t value) {
+    return (value + 7) & ~uint64_t(7);
+}
+
+void putU32(string& out, uint32_t value) { out.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+void putU64(string& out, uint64_t value) { out.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+void putString(string& out, const string& value) {
+    putU32(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+// 카탈로그를 앞에서부터 읽는 커서 (범위를 벗어나면 ok가 false가 됨)
+struct ByteReader {
+    const char* pos;
+    const char* end;
+    bool ok = true;
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (end - pos < static_cast<ptrdiff_t>(sizeof(T))) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    string getString() {
+        uint32_t length = get<uint32_t>();
+        if (!ok || end - pos < static_cast<ptrdiff_t>(length)) {
+            ok = false;
+            return "";
+        }
+        string value(pos, length);
+        pos += length;
+        return value;
+    }
+};
+
+// 컬럼의 원시 배열 블록 (포인터, 바이트 수)
+pair<const char*, uint64_t> columnBlock(const ColumnData& column) {
+    switch (column.type) {
+        case ColumnType::Int: return {reinterpret_cast<const char*>(column.ints.data()), column.ints.size() * sizeof(int64_t)};
+        case ColumnType::Float: return {reinterpret_cast<const char*>(column.floats.data()), column.floats.size() * sizeof(double)};
+        case ColumnType::Date: return {reinterpret_cast<const char*>(column.dates.data()), column.dates.size() * sizeof(int32_t)};
+        case ColumnType::String:
+            return {reinterpret_cast<const char*>(column.strings.offsets.data()), column.strings.offsets.size() * sizeof(uint64_t)};
+    }
+    return {nullptr, 0};
+}
+
+// 파일에 쓸 데이터 블록 (포인터, 바이트 수)
+using DataBlock = pair<const char*, uint64_t>;
+
+// 카탈로그를 직렬화하는 함수
+// 데이터 블록을 카탈로그에 기록한 순서대로 blocks에 모으며 dataStart부터 차례로 배치
+// indexOrders는 모든 테이블의 인덱스 정렬 순서 블록을 같은 순서로 나열한 것
+string buildCatalog(const vector<const TableData*>& tables, const vector<DataBlock>& indexOrders, uint64_t dataStart,
+                    vector<DataBlock>& blocks) {
+    string catalog;
+    uint64_t offset = dataStart;
+    auto place = [&](const DataBlock& block) {
+        putU64(catalog, offset);
+        putU64(catalog, block.second);
+        blocks.push_back(block);
+        offset = alignTo8(offset + block.second);
+    };
+
+    size_t nextOrder = 0;
+    blocks.clear();
+    for (const TableData* table : tables) {
+        putString(catalog, table->schema.tableName);
+        putU64(catalog, table->rowCount);
+        putU32(catalog, static_cast<uint32_t>(table->columns.size()));
+        for (size_t i = 0; i < table->columns.size(); ++i) {
+            const ColumnData& column = table->columns[i];
+            putString(catalog, table->schema.columns[i]);
+            putString(catalog, table->schema.columnTypes[i]);
+            place(columnBlock(column));
+            if (column.type == ColumnType::String) {
+                place({column.strings.data.data(), column.strings.data.size()});
+            } else {
+                place({nullptr, 0});
+            }
+            // version 4: zone map (모든 세그먼트를 덮을 때만, 아니면 로드할 때 다시 만듦)
+            if (column.zones.size() == (table->rowCount + kSegmentRows - 1) / kSegmentRows) {
+                place({reinterpret_cast<const char*>(column.zones.data()), column.zones.size() * sizeof(ZoneRange)});
+            } else {
+                place({nullptr, 0});
+            }
+            // version 5: 문자열 사전
+            if (column.type == ColumnType::String) {
+                const StringColumn& strings = column.strings;
+                catalog.push_back(static_cast<char>(strings.encoded));
+                place({reinterpret_cast<const char*>(strings.codes.data()), strings.codes.size() * sizeof(int32_t)});
+                place({reinterpret_cast<const char*>(strings.sortedCodes.data()), strings.sortedCodes.size() * sizeof(int32_t)});
+            }
+        }
+        // version 3: 인덱스 정의와 B+tree 정렬 순서
+        putU32(catalog, static_cast<uint32_t>(table->indexes.size()));
+        for (const auto& index : table->indexes) {
+            putString(catalog, index.name);
+            putString(catalog, index.column);
+            catalog.push_back(static_cast<char>(index.kind));
+            place(indexOrders[nextOrder++]);
+        }
+    }
+    return catalog;
+}
+
+// fd에 버퍼 전체를 쓰는 함수
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+// 데이터베이스 전체를 바이너리 형식으로 파일에 쓰는 함수
+// 임시 파일에 쓰고 fsync한 뒤 rename 하므로, 이전 파일을 mmap 중이어도 안전하고 중간에 실패해도 원본이 남음
+bool writeDatabaseFile(const Database& db, const string& filename) {
+    // 지운 표시가 있는 테이블은 살아 있는 행만 모은 복사본을 씀
+    vector<const TableData*> tables;
+    deque<TableData> compacted;
+    for (const auto& tablePair : db.tables) {
+        if (tablePair.second.versions.deletedRows == 0) {
+            tables.push_back(&tablePair.second);
+        } else {
+            compacted.emplace_back();
+            copyLiveRows(tablePair.second, compacted.back());
+            tables.push_back(&compacted.back());
+        }
+    }
+    sort(tables.begin(), tables.end(), [](const TableData* a, const TableData* b) {
+        return a->schema.tableName < b->schema.tableName;
+    });
+
+    // B+tree 인덱스는 키 순서의 행 번호를 저장해서 다음 로드 때 정렬 없이 만들 수 있게 함
+    deque<vector<uint64_t>> orderStorage;
+    vector<DataBlock> indexOrders;
+    for (const TableData* table : tables) {
+        shared_lock<shared_mutex> latch(table->latch.mutex); // SELECT가 인덱스를 처음 만드는 중일 수 있음
+        for (const auto& index : table->indexes) {
+            if (index.kind != IndexKind::BTree) {
+                indexOrders.push_back({nullptr, 0});
+            } else if (!index.structure) {
+                indexOrders.push_back({reinterpret_cast<const char*>(index.persistedOrder.data()),
+                                       index.persistedOrder.size() * sizeof(uint64_t)});
+            } else {
+                orderStorage.emplace_back();
+                index.structure->sortedRows(orderStorage.back());
+                indexOrders.push_back({reinterpret_cast<const char*>(orderStorage.back().data()),
+                                       orderStorage.back().size() * sizeof(uint64_t)});
+            }
+        }
+    }
+
+    // 오프셋 필드는 고정 길이이므로 크기를 먼저 구한 뒤 실제 위치로 다시 만듦
+    vector<DataBlock> blocks;
+    uint64_t catalogSize = buildCatalog(tables, indexOrders, 0, blocks).size();
+    uint64_t dataStart = alignTo8(sizeof(FileHeader) + catalogSize);
+    string catalog = buildCatalog(tables, indexOrders, dataStart, blocks);
+
+    uint64_t fileSize = dataStart;
+    for (const auto& block : blocks) {
+        fileSize = alignTo8(fileSize + block.second);
+    }
+
+    FileHeader header{};
+    memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+    header.version = kFileVersion;
+    header.tableCount = static_cast<uint32_t>(tables.size());
+    header.catalogSize = catalogSize;
+    header.fileSize = fileSize;
+    header.checkpointLsn = db.checkpointLsn;
+
+    string tempName = filename + ".tmp";
+    int fd = open(tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    // 블록 뒤에 0을 채워 다음 블록이 8바이트 경계에서 시작하도록 함
+    const char padding[8] = {0};
+    auto put = [&](const char* data, uint64_t size) {
+        return writeAll(fd, data, size) && writeAll(fd, padding, alignTo8(size) - size);
+    };
+
+    bool ok = writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header)) &&
+              put(catalog.data(), catalog.size());
+    for (const auto& block : blocks) {
+        ok = ok && put(block.first, block.second);
+    }
+
+    ok = ok && fsync(fd) == 0;
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(tempName.c_str(), filename.c_str()) != 0) {
+        unlink(tempName.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 바이너리 파일 로드 결과
+enum class LoadResult {
+    Ok,
+    NotBinary, // 매직이 없음 (예전 텍스트 형식 또는 빈 파일)
+    Corrupt
+};
+
+// 블록이 매핑 범위 안에 있는지 확인하고 시작 포인터를 돌려주는 함수
+const char* blockPointer(const MappedFile& mapping, const BlockRef& block, size_t alignment) {
+    if (block.offset > mapping.size || block.size > mapping.size - block.offset || block.offset % alignment != 0) {
+        return nullptr;
+    }
+    return static_cast<const char*>(mapping.base) + block.offset;
+}
+
+// 바이너리 .mydb 파일을 mmap 하고 컬럼 배열이 파일 영역을 직접 가리키도록 연결하는 함수
+LoadResult loadBinaryDatabase(const string& filename, Database& db) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return LoadResult::Corrupt;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return LoadResult::Corrupt;
+    }
+    FileHeader header{};
+    size_t minHeader = headerSize(1);
+    if (static_cast<size_t>(st.st_size) < minHeader || pread(fd, &header, minHeader, 0) != static_cast<ssize_t>(minHeader) ||
+        memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0) {
+        close(fd);
+        return LoadResult::NotBinary;
+    }
+    size_t fullHeader = headerSize(header.version);
+    if (header.version < 1 || header.version > kFileVersion || header.fileSize != static_cast<uint64_t>(st.st_size) ||
+        header.fileSize < fullHeader || header.catalogSize > header.fileSize - fullHeader ||
+        pread(fd, &header, fullHeader, 0) != static_cast<ssize_t>(fullHeader)) {
+        close(fd);
+        return LoadResult::Corrupt;
+    }
+    db.checkpointLsn = header.checkpointLsn;
+    db.lastLsn = header.checkpointLsn;
+    db.durableLsn = header.checkpointLsn;
+
+    auto mapping = make_shared<MappedFile>();
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return LoadResult::Corrupt;
+    mapping->base = base;
+    mapping->size = st.st_size;
+    mapping->frames.assign((mapping->size + kPageBytes - 1) / kPageBytes, kNoFrame);
+    madvise(base, st.st_size, MADV_RANDOM); // 페이지는 버퍼 풀이 올림
+
+    const char* catalogStart = static_cast<const char*>(base) + fullHeader;
+    ByteReader reader{catalogStart, catalogStart + header.catalogSize};
+    for (uint32_t t = 0; t < header.tableCount && reader.ok; ++t) {
+        TableData table;
+        table.schema.tableName = reader.getString();
+        uint64_t rowCount = reader.get<uint64_t>();
+        uint32_t columnCount = reader.get<uint32_t>();
+        vector<ColumnEntry> entries(reader.ok ? columnCount : 0);
+        for (auto& entry : entries) {
+            entry.name = reader.getString();
+            entry.typeName = reader.getString();
+            entry.values.offset = reader.get<uint64_t>();
+            entry.values.size = reader.get<uint64_t>();
+            entry.strings.offset = reader.get<uint64_t>();
+            entry.strings.size = reader.get<uint64_t>();
+            if (header.version >= 4) {
+                entry.zones.offset = reader.get<uint64_t>();
+                entry.zones.size = reader.get<uint64_t>();
+            }
+            // 사전 필드는 buildCatalog와 같은 기준(물리 타입이 String인 열, 알 수 없는 타입 포함)으로 읽음
+            if (header.version >= 5 && toColumnType(entry.typeName) == ColumnType::String) {
+                entry.encoded = reader.get<uint8_t>() != 0;
+                entry.codes.offset = reader.get<uint64_t>();
+                entry.codes.size = reader.get<uint64_t>();
+                entry.sortedCodes.offset = reader.get<uint64_t>();
+                entry.sortedCodes.size = reader.get<uint64_t>();
+            }
+            table.schema.columns.push_back(entry.name);
+            table.schema.columnTypes.push_back(entry.typeName);
+        }
+        if (!reader.ok) break;
+
+        initColumns(table);
+        table.rowCount = rowCount;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            ColumnData& column = table.columns[i];
+            const ColumnEntry& entry = entries[i];
+            bool ok = false;
+            switch (column.type) {
+                case ColumnType::Int: {
+                    const char* values = blockPointer(*mapping, entry.values, alignof(int64_t));
+                    ok = values != nullptr && entry.values.size == rowCount * sizeof(int64_t);
+                    if (ok) column.ints.attach(mapping, reinterpret_cast<const int64_t*>(values), rowCount);
+                    break;
+                }
+                case ColumnType::Float: {
+                    const char* values = blockPointer(*mapping, entry.values, alignof(double));
+                    ok = values != nullptr && entry.values.size == rowCount * sizeof(double);
+                    if (ok) column.floats.attach(mapping, reinterpret_cast<const double*>(values), rowCount);
+                    break;
+                }
+                case ColumnType::Date: {
+                    const char* values = blockPointer(*mapping, entry.values, alignof(int32_t));
+                    ok = values != nullptr && entry.values.size == rowCount * sizeof(int32_t);
+                    if (ok) column.dates.attach(mapping, reinterpret_cast<const int32_t*>(values), rowCount);
+                    break;
+                }
+                case ColumnType::String: {
+                    // 사전 인코딩이면 오프셋 배열은 사전 값 수 + 1개, 아니면 행 수 + 1개
+                    const char* offsets = blockPointer(*mapping, entry.values, alignof(uint64_t));
+                    const char* chars = blockPointer(*mapping, entry.strings, 1);
+                    uint64_t entryCount = entry.values.size / sizeof(uint64_t);
+                    ok = offsets != nullptr && chars != nullptr && entryCount > 0 && entry.values.size % sizeof(uint64_t) == 0 &&
+                         (entry.encoded ? entryCount - 1 <= kMaxDictionaryEntries : entryCount == rowCount + 1);
+                    if (ok) {
+                        const uint64_t* offsetArray = reinterpret_cast<const uint64_t*>(offsets);
+                        ok = offsetArray[0] == 0 && offsetArray[entryCount - 1] == entry.strings.size;
+                    }
+                    const char* codes = blockPointer(*mapping, entry.codes, alignof(int32_t));
+                    const char* sortedCodes = blockPointer(*mapping, entry.sortedCodes, alignof(int32_t));
+                    if (ok && entry.encoded) {
+                        ok = codes != nullptr && sortedCodes != nullptr && entry.codes.size == rowCount * sizeof(int32_t) &&
+                             entry.sortedCodes.size == (entryCount - 1) * sizeof(int32_t);
+                    }
+                    if (ok) {
+                        column.strings.encoded = entry.encoded;
+                        column.strings.offsets.attach(mapping, reinterpret_cast<const uint64_t*>(offsets), entryCount);
+                        column.strings.data.attach(mapping, chars, entry.strings.size);
+                        if (entry.encoded) {
+                            column.strings.codes.attach(mapping, reinterpret_cast<const int32_t*>(codes), rowCount);
+                            column.strings.sortedCodes.attach(mapping, reinterpret_cast<const int32_t*>(sortedCodes), entryCount - 1);
+                        }
+                    }
+                    break;
+                }
+            }
+            if (!ok) return LoadResult::Corrupt;
+
+            // version 4 이하 파일의 string 컬럼은 값 종류가 적으면 사전 인코딩으로 바꿔 둠 (많으면 mmap 그대로 사용)
+            if (column.type == ColumnType::String && header.version < 5) {
+                StringColumn encoded;
+                encoded.encoded = true;
+                for (size_t row = 0; row < rowCount && encoded.encoded; ++row) encoded.push_back(column.strings.get(row));
+                if (encoded.encoded) column.strings = move(encoded);
+            }
+
+            // zone map이 없거나 (version 3 이하) 온전하지 않으면 값을 한 번 읽어 만듦
+            size_t segments = (rowCount + kSegmentRows - 1) / kSegmentRows;
+            const char* zones = blockPointer(*mapping, entry.zones, alignof(ZoneRange));
+            if (column.type != ColumnType::String && zones != nullptr && entry.zones.size == segments * sizeof(ZoneRange)) {
+                column.zones.attach(mapping, reinterpret_cast<const ZoneRange*>(zones), segments);
+            } else {
+                extendZoneMap(column, 0, rowCount);
+            }
+        }
+
+        if (header.version >= 3) {
+            uint32_t indexCount = reader.get<uint32_t>();
+            for (uint32_t k = 0; k < indexCount && reader.ok; ++k) {
+                TableIndex index;
+                index.name = reader.getString();
+                index.column = reader.getString();
+                index.kind = static_cast<IndexKind>(reader.get<uint8_t>());
+                BlockRef order;
+                order.offset = reader.get<uint64_t>();
+                order.size = reader.get<uint64_t>();
+                index.columnIndex = findColumn(table.schema, index.column);
+                if (!reader.ok || index.columnIndex < 0 || (index.kind != IndexKind::Hash && index.kind != IndexKind::BTree)) {
+                    return LoadResult::Corrupt;
+                }
+                // 정렬 순서가 온전하지 않으면 무시하고 처음 사용할 때 정렬해서 만듦
+                const char* orderData = blockPointer(*mapping, order, alignof(uint64_t));
+                if (orderData != nullptr && order.size == rowCount * sizeof(uint64_t)) {
+                    index.persistedOrder.attach(mapping, reinterpret_cast<const uint64_t*>(orderData), rowCount);
+                }
+                table.indexes.push_back(move(index));
+            }
+        }
+        db.tables[table.schema.tableName] = move(table);
+    }
+    return reader.ok ? LoadResult::Ok : LoadResult::Corrupt;
+}
+
+// ---- Write-ahead log (<db>.wal) ----
+// INSERT/DELETE/CREATE TABLE은 메모리에 반영한 뒤 redo 레코드를 로그 버퍼에 추가하고,
+// COMMIT은 커밋 레코드를 붙인 뒤 그룹 커밋 스레드가 버퍼를 로그 파일 끝에 쓰고 fsync할 때까지 기다림 (변경량에 비례하는 비용)
+// 레코드: [u32 payload 크기][u32 체크섬][u8 타입][payload]
+// 로그 버퍼는 데이터베이스마다 하나이고 모든 세션이 공유함: COMMIT은 세션이 아니라 데이터베이스 단위로,
+// 어느 세션의 COMMIT이든 그때까지 모든 세션이 붙인 레코드를 영구 저장함 (각 문장은 이미 메모리에서 모두에게 보임)
+// 로그가 kCheckpointThreshold를 넘으면 체크포인트에서 .mydb 파일에 합치고 로그를 비움
+const size_t kWalBufferLimit = 1 << 20;            // 커밋 전이라도 버퍼가 이만큼 차면 파일에 씀 (fsync 없음)
+const uint64_t kCheckpointThreshold = 64ull << 20; // 로그 파일이 이 크기를 넘으면 체크포인트
+
+enum class WalRecordType : uint8_t {
+    CreateTable = 1,
+    Insert = 2,
+    Delete = 3,
+    Commit = 4,
+    CreateIndex = 5,
+    DeleteWhere = 6, // Delete(조건 하나)를 대신하는 WHERE 절 전체 기록
+    InsertRows = 7   // 여러 행 INSERT / COPY: 테이블 이름을 한 번만 쓰고 행들을 이어 붙임
+};
+
+// 로그 레코드 손상 확인용 체크섬 (FNV-1a)
+uint32_t walChecksum(const char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+string walFilename(const string& dbName) {
+    return dbName + ".wal";
+}
+
+// 로그 버퍼의 내용을 로그 파일 끝에 쓰는 함수 (fsync는 그룹 커밋 스레드가 따로 함)
+bool flushWal(Database& db) {
+    if (db.walBuffer.empty()) return true;
+    int fd = open(walFilename(db.dbName).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, db.walBuffer.data(), db.walBuffer.size());
+    ok = (close(fd) == 0) && ok;
+    if (ok) {
+        db.walSize += db.walBuffer.size();
+        db.walBuffer.clear();
+    }
+    return ok;
+}
+
+// 레코드 하나를 로그 버퍼에 추가하는 함수 (db.walLock을 잡은 상태에서 호출)
+void appendWalRecord(Database& db, WalRecordType type, const string& payload) {
+    string body;
+    body.reserve(payload.size() + 1);
+    body.push_back(static_cast<char>(type));
+    body.append(payload);
+    putU32(db.walBuffer, static_cast<uint32_t>(payload.size()));
+    putU32(db.walBuffer, walChecksum(body.data(), body.size()));
+    db.walBuffer.append(body);
+    if (db.walBuffer.size() >= kWalBufferLimit && !flushWal(db)) {
+        *queryErr << "Error: " << walFilename(db.dbName) << " 로그 파일에 쓰는데 실패했습니다.\n";
+    }
+}
+
+void walAppend(Database& db, WalRecordType type, const string& payload) {
+    lock_guard<mutex> lock(db.walLock.mutex);
+    appendWalRecord(db, type, payload);
+}
+
+// ---- 그룹 커밋 ----
+// COMMIT은 커밋 레코드를 버퍼에 붙이고 요청을 큐에 넣은 뒤 future로 기다림
+// 플러셔 스레드는 요청이 오면 최대 지연 시간까지 (또는 배치가 찰 때까지) 더 모은 뒤, 데이터베이스마다
+// 버퍼를 한 번에 쓰고 fsync 한 번으로 배치 전체를 끝냄. fsync 중에는 walLock을 놓으므로 다른 writer가 계속 로그를 붙이고,
+// 그동안 들어온 COMMIT은 다음 배치가 됨. 비동기 모드에서는 COMMIT이 큐에 넣자마자 완료를 알림 (fsync 전에 멈추면 잃을 수 있음)
+
+const size_t kDefaultCommitBatch = 64;
+
+atomic<uint64_t> commitDelayMicros{0};             // SET COMMIT_DELAY us: 첫 요청 뒤 더 모으며 기다리는 최대 시간
+atomic<size_t> commitBatchLimit{kDefaultCommitBatch}; // SET COMMIT_BATCH n: 배치 하나의 최대 COMMIT 수
+atomic<bool> asyncCommit{false};                    // SET COMMIT_MODE ASYNC | SYNC
+
+// db의 로그를 lsn 커밋까지 fsync하는 함수 (이미 되어 있으면 바로 true)
+// 버퍼는 walLock 안에서 쓰고, fsync는 잠금 없이 함
+bool syncWal(Database& db, uint64_t lsn) {
+    uint64_t written;
+    uint64_t size;
+    {
+        lock_guard<mutex> lock(db.walLock.mutex);
+        if (db.durableLsn >= lsn) return true;
+        if (!flushWal(db)) return false;
+        written = db.lastLsn;
+        size = db.walSize;
+    }
+    int fd = open(walFilename(db.dbName).c_str(), O_WRONLY | O_CREAT, 0644);
+    bool ok = fd >= 0 && fdatasync(fd) == 0;
+    if (fd >= 0) ok = close(fd) == 0 && ok;
+    if (!ok) return false;
+
+    // 그사이 체크포인트가 로그를 비웠으면 durableLsn이 이미 더 큼
+    lock_guard<mutex> lock(db.walLock.mutex);
+    if (written > db.durableLsn) {
+        db.durableLsn = written;
+        ioStats.bytesCommitted.fetch_add(size - db.syncedWalSize, memory_order_relaxed);
+        db.syncedWalSize = size;
+    }
+    return true;
+}
+
+class CommitFlusher {
+public:
+    ~CommitFlusher() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    // 커밋 레코드를 붙인 뒤 호출: lsn까지 로그가 fsync되면 true, 쓰기에 실패하면 false가 되는 future
+    future<bool> enqueue(Database& db, uint64_t lsn) {
+        Request request{&db, lsn, promise<bool>()};
+        future<bool> done = request.done.get_future();
+        {
+            lock_guard<mutex> lock(mutex_);
+            if (!thread_.joinable()) thread_ = thread([this] { run(); });
+            queue_.push_back(move(request));
+        }
+        wake_.notify_one();
+        return done;
+    }
+
+    // db에 대한 요청이 모두 끝날 때까지 기다림 (데이터베이스를 메모리에서 내리기 전에 호출)
+    void drain(const Database& db) {
+        unique_lock<mutex> lock(mutex_);
+        idle_.wait(lock, [&] {
+            if (flushing_ == &db) return false;
+            for (const auto& request : queue_) {
+                if (request.db == &db) return false;
+            }
+            return true;
+        });
+    }
+
+    uint64_t batches() const { return batches_.load(memory_order_relaxed); }
+    uint64_t commits() const { return commits_.load(memory_order_relaxed); }
+
+private:
+    struct Request {
+        Database* db;
+        uint64_t lsn;
+        promise<bool> done;
+    };
+
+    void run() {
+        unique_lock<mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) return; // 멈출 때도 남은 요청은 모두 처리
+            auto delay = chrono::microseconds(commitDelayMicros.load());
+            if (delay.count() > 0 && !stop_) {
+                wake_.wait_for(lock, delay, [&] { return stop_ || queue_.size() >= commitBatchLimit.load(); });
+            }
+
+            // 가장 오래된 요청의 데이터베이스에 대한 요청을 배치 크기만큼 꺼냄
+            Database* db = queue_.front().db;
+            vector<Request> batch;
+            uint64_t lsn = 0;
+            for (auto it = queue_.begin(); it != queue_.end() && batch.size() < max<size_t>(1, commitBatchLimit.load());) {
+                if (it->db != db) {
+                    ++it;
+                    continue;
+                }
+                lsn = max(lsn, it->lsn);
+                batch.push_back(move(*it));
+                it = queue_.erase(it);
+            }
+            flushing_ = db;
+            lock.unlock();
+
+            bool ok = syncWal(*db, lsn);
+            if (!ok && asyncCommit.load()) cerr << "Error: " << walFilename(db->dbName) << " 로그 파일에 쓰는데 실패했습니다 (비동기 커밋).\n";
+            batches_.fetch_add(1, memory_order_relaxed);
+            commits_.fetch_add(batch.size(), memory_order_relaxed);
+            for (auto& request : batch) request.done.set_value(ok);
+
+            lock.lock();
+            flushing_ = nullptr;
+            idle_.notify_all();
+        }
+    }
+
+    thread thread_;
+    mutex mutex_;
+    condition_variable wake_;
+    condition_variable idle_;
+    deque<Request> queue_;
+    const Database* flushing_ = nullptr;
+    bool stop_ = false;
+    atomic<uint64_t> batches_{0}; // fsync한 배치 수
+    atomic<uint64_t> commits_{0}; // 그 배치들에 들어 있던 COMMIT 수
+};
+
+CommitFlusher commitFlusher;
+
+// CREATE TABLE redo 레코드
+void logCreateTable(Database& db, const TableSchema& schema) {
+    string payload;
+    putString(payload, schema.tableName);
+    putU32(payload, static_cast<uint32_t>(schema.columns.size()));
+    for (size_t i = 0; i < schema.columns.size(); ++i) {
+        putString(payload, schema.columns[i]);
+        putString(payload, schema.columnTypes[i]);
+    }
+    walAppend(db, WalRecordType::CreateTable, payload);
+}
+
+// INSERT redo 레코드: 테이블 이름 뒤에 각 컬럼 값을 타입별 이진 표현으로 기록
+// 한 행의 값들을 타입별 바이너리로 payload 뒤에 붙이는 함수
+void putRowValues(string& payload, const TableData& table, size_t row) {
+    for (const auto& column : table.columns) {
+        switch (column.type) {
+            case ColumnType::Int: putU64(payload, static_cast<uint64_t>(column.ints[row])); break;
+            case ColumnType::Float: payload.append(reinterpret_cast<const char*>(&column.floats[row]), sizeof(double)); break;
+            case ColumnType::Date: putU32(payload, static_cast<uint32_t>(column.dates[row])); break;
+            case ColumnType::String: putString(payload, string(column.strings.get(row))); break;
+        }
+    }
+}
+
+void logInsert(Database& db, const TableData& table, size_t row) {
+    string payload;
+    putString(payload, table.schema.tableName);
+    putRowValues(payload, table, row);
+    walAppend(db, WalRecordType::Insert, payload);
+}
+
+// 여러 행 INSERT redo 레코드: [테이블 이름][행 수][행 값들...], 레코드 하나가 너무 커지지 않게 나눠 씀
+void logInsertRows(Database& db, const TableData& table, size_t firstRow, size_t count) {
+    const size_t kRowsPerRecord = 65536;
+    for (size_t begin = firstRow; begin < firstRow + count; begin += kRowsPerRecord) {
+        size_t end = min(firstRow + count, begin + kRowsPerRecord);
+        string payload;
+        putString(payload, table.schema.tableName);
+        putU32(payload, static_cast<uint32_t>(end - begin));
+        for (size_t row = begin; row < end; ++row) putRowValues(payload, table, row);
+        walAppend(db, WalRecordType::InsertRows, payload);
+    }
+}
+
+// DELETE redo 레코드: WHERE 절 자체를 기록하고 재실행 시 같은 순서로 다시 평가함
+void logDelete(Database& db, const string& tableName, const string& whereClause) {
+    string payload;
+    putString(payload, tableName);
+    putString(payload, whereClause);
+    walAppend(db, WalRecordType::DeleteWhere, payload);
+}
+
+// CREATE INDEX redo 레코드
+void logCreateIndex(Database& db, const string& tableName, const TableIndex& index) {
+    string payload;
+    putString(payload, tableName);
+    putString(payload, index.name);
+    putString(payload, index.column);
+    payload.push_back(static_cast<char>(index.kind));
+    walAppend(db, WalRecordType::CreateIndex, payload);
+}
+
+// WHERE 절을 만족하는 행을 삭제하고 삭제된 행 수를 돌려주는 함수 (filter는 groups를 컴파일한 것)
+size_t deleteRows(TableData& table, const vector<vector<Condition>>& groups, const RowFilter& filter) {
+    vector<char> keep(table.rowCount, 1);
+    size_t deleted = 0;
+    scanTable(table, groups, filter, [&](const uint64_t* rows, size_t count) {
+        for (size_t i = 0; i < count; ++i) keep[rows[i]] = 0;
+        deleted += count;
+    });
+    if (deleted > 0) {
+        compactTable(table, keep);
+    }
+    return deleted;
+}
+
+size_t deleteRows(TableData& table, const vector<vector<Condition>>& groups) {
+    return deleteRows(table, groups, RowFilter(table, groups));
+}
+
+// 지운 트랜잭션을 표시할 배열을 돌려주는 함수 (처음 지울 때 만듦)
+uint64_t* deletionMarks(TableData& table) {
+    unique_lock<shared_mutex> latch(table.latch.mutex);
+    if (table.versions.deletedBy.empty()) table.versions.deletedBy.resize(table.rowCount);
+    return table.versions.deletedBy.sharedMutableData();
+}
+
+// WHERE 절을 만족하는 보이는 행에 지운 트랜잭션 txn을 표시하고 표시한 행 수를 돌려주는 함수
+// 행은 그대로 두므로 이미 실행 중인 SELECT의 뷰는 계속 같은 행을 보고, 정리는 vacuum이 함
+size_t markDeleted(TableData& table, const vector<vector<Condition>>& groups, const RowFilter& filter, uint64_t txn) {
+    uint64_t* deletedBy = deletionMarks(table);
+    size_t deleted = 0;
+    scanTable(table, groups, filter, [&](const uint64_t* rows, size_t count) {
+        for (size_t i = 0; i < count; ++i) __atomic_store_n(deletedBy + rows[i], txn, __ATOMIC_RELAXED);
+        deleted += count;
+    });
+    unique_lock<shared_mutex> latch(table.latch.mutex);
+    table.versions.deletedRows += deleted;
+    return deleted;
+}
+
+// 이미 찾아 둔 rows 위치의 행에 지운 트랜잭션 txn을 표시하는 함수 (UPDATE가 옛 버전을 지울 때 사용)
+void markDeleted(TableData& table, const vector<uint64_t>& rows, uint64_t txn) {
+    uint64_t* deletedBy = deletionMarks(table);
+    for (uint64_t row : rows) __atomic_store_n(deletedBy + row, txn, __ATOMIC_RELAXED);
+    unique_lock<shared_mutex> latch(table.latch.mutex);
+    table.versions.deletedRows += rows.size();
+}
+
+// ---- 백그라운드 vacuum ----
+
+const chrono::milliseconds kVacuumInterval(1000); // 정리하지 못한 테이블을 다시 확인하는 간격
+
+// 지운 행이 이 비율 이상인 테이블을 정리
+// 환경 변수 DBMS_VACUUM_RATIO로 지정할 수 있고, 없으면 0.1
+double defaultVacuumRatio() {
+    const char* forced = getenv("DBMS_VACUUM_RATIO");
+    double ratio = 0;
+    if (forced != nullptr && parseFloat(forced, ratio) && ratio > 0 && ratio <= 1) return ratio;
+    return 0.1;
+}
+
+double vacuumRatio = defaultVacuumRatio(); // SET VACUUM_RATIO r (0 < r <= 1) 으로 바꿀 수 있음
+
+// 지운 표시가 있는 행을 실제로 빼고 압축하는 함수
+// writeLock과 layoutLock을 배타적으로 잡은 상태에서 호출하므로 진행 중인 writer와 SELECT가 없음:
+// 표시된 행은 모두 정리할 수 있고, 남는 행을 추가한 트랜잭션도 모두 끝났으므로 버전 정보를 비움
+void vacuumTable(TableData& table) {
+    vector<char> keep(table.rowCount);
+    for (size_t row = 0; row < table.rowCount; ++row) keep[row] = rowVisible(table, row);
+    unique_lock<shared_mutex> latch(table.latch.mutex);
+    table.versions = RowVersions();
+    compactTable(table, keep);
+}
+
+// 지운 행이 많은 테이블을 백그라운드에서 정리하는 스레드
+// 테이블을 쓰거나 읽는 문장이 있으면 기다리지 않고 다음 차례에 다시 시도함
+class VacuumWorker {
+public:
+    ~VacuumWorker() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    // DELETE 뒤에 호출: 정리할 테이블이 생겼을 수 있으므로 깨움 (처음 호출할 때 스레드를 시작)
+    void notify() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            if (!thread_.joinable()) thread_ = thread([this] { run(); });
+            pending_ = true;
+        }
+        wake_.notify_one();
+    }
+
+private:
+    void run() {
+        unique_lock<mutex> lock(mutex_);
+        while (true) {
+            wake_.wait_for(lock, kVacuumInterval, [&] { return stop_ || pending_; });
+            if (stop_) return;
+            pending_ = false;
+            lock.unlock();
+            vacuumDatabases();
+            lock.lock();
+        }
+    }
+
+    static void vacuumDatabases() {
+        shared_lock<shared_mutex> catalog(catalogMutex, try_to_lock);
+        if (!catalog.owns_lock()) return;
+        for (auto& dbPair : databases) {
+            for (auto& tablePair : dbPair.second.tables) {
+                TableData& table = tablePair.second;
+                unique_lock<mutex> writer(table.writeLock.mutex, try_to_lock);
+                if (!writer.owns_lock() || table.versions.deletedRows == 0 ||
+                    table.versions.deletedRows < table.rowCount * vacuumRatio) {
+                    continue;
+                }
+                unique_lock<shared_mutex> layout(table.layoutLock.mutex, try_to_lock);
+                if (layout.owns_lock()) vacuumTable(table);
+            }
+        }
+    }
+
+    thread thread_;
+    mutex mutex_;
+    condition_variable wake_;
+    bool pending_ = false;
+    bool stop_ = false;
+};
+
+VacuumWorker vacuumWorker;
+
+// redo 레코드 하나를 메모리의 데이터베이스에 적용하는 함수
+bool applyWalRecord(Database& db, WalRecordType type, ByteReader reader) {
+    switch (type) {
+        case WalRecordType::CreateTable: {
+            TableData table;
+            table.schema.tableName = reader.getString();
+            uint32_t columnCount = reader.get<uint32_t>();
+            for (uint32_t i = 0; i < columnCount && reader.ok; ++i) {
+                table.schema.columns.push_back(reader.getString());
+                table.schema.columnTypes.push_back(reader.getString());
+            }
+            if (!reader.ok) return false;
+            initColumns(table);
+            db.tables[table.schema.tableName] = move(table);
+            return true;
+        }
+        case WalRecordType::Insert:
+        case WalRecordType::InsertRows: {
+            auto it = db.tables.find(reader.getString());
+            uint32_t rowCount = type == WalRecordType::InsertRows ? reader.get<uint32_t>() : 1;
+            if (!reader.ok || it == db.tables.end()) return false;
+            TableData& table = it->second;
+            size_t firstRow = table.rowCount;
+            for (uint32_t row = 0; row < rowCount; ++row) {
+                for (auto& column : table.columns) {
+                    switch (column.type) {
+                        case ColumnType::Int: column.ints.push_back(static_cast<int64_t>(reader.get<uint64_t>())); break;
+                        case ColumnType::Float: column.floats.push_back(reader.get<double>()); break;
+                        case ColumnType::Date: column.dates.push_back(static_cast<int32_t>(reader.get<uint32_t>())); break;
+                        case ColumnType::String: column.strings.push_back(reader.getString()); break;
+                    }
+                }
+                table.rowCount++;
+            }
+            appendVersions(table, firstRow, 0);
+            extendZoneMaps(table, firstRow);
+            indexAppendedRows(table, firstRow);
+            return reader.ok;
+        }
+        case WalRecordType::Delete: {
+            auto it = db.tables.find(reader.getString());
+            string column = reader.getString();
+            string op = reader.getString();
+            string value = reader.getString();
+            if (!reader.ok || it == db.tables.end()) return false;
+            int columnIndex = findColumn(it->second.schema, column);
+            if (columnIndex < 0) return false;
+            deleteRows(it->second, {{makeCondition(it->second, columnIndex, op, value)}});
+            return true;
+        }
+        case WalRecordType::DeleteWhere: {
+            auto it = db.tables.find(reader.getString());
+            string whereClause = reader.getString();
+            WhereTerms terms;
+            vector<vector<Condition>> groups;
+            string missingColumn;
+            if (!reader.ok || it == db.tables.end() || !parseWhereTerms(whereClause, terms) ||
+                !resolveWhere(it->second, terms, groups, missingColumn)) {
+                return false;
+            }
+            deleteRows(it->second, groups);
+            return true;
+        }
+        case WalRecordType::CreateIndex: {
+            auto it = db.tables.find(reader.getString());
+            string name = reader.getString();
+            string column = reader.getString();
+            IndexKind kind = static_cast<IndexKind>(reader.get<uint8_t>());
+            if (!reader.ok || it == db.tables.end()) return false;
+            int columnIndex = findColumn(it->second.schema, column);
+            if (columnIndex < 0) return false;
+            addIndex(it->second, name, columnIndex, kind);
+            return true;
+        }
+        case WalRecordType::Commit:
+            return true;
+    }
+    return false;
+}
+
+// 로그 파일을 읽어 체크포인트 이후에 커밋된 트랜잭션을 다시 적용하는 함수
+// 마지막 COMMIT 레코드 뒤의 커밋되지 않은 레코드나 잘린 레코드는 버리고 파일도 그 지점으로 자름
+bool replayWal(Database& db) {
+    string filename = walFilename(db.dbName);
+    int fd = open(filename.c_str(), O_RDWR);
+    if (fd < 0) return errno == ENOENT;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    string log(st.st_size, '\0');
+    if (st.st_size > 0 && pread(fd, &log[0], log.size(), 0) != st.st_size) {
+        close(fd);
+        return false;
+    }
+
+    // 커밋 레코드를 만날 때까지 레코드 위치만 모아 두었다가 한 번에 적용
+    vector<pair<WalRecordType, ByteReader>> pending;
+    size_t pos = 0;
+    size_t committedEnd = 0;
+    bool ok = true;
+    while (ok && log.size() - pos >= 2 * sizeof(uint32_t) + 1) {
+        ByteReader header{log.data() + pos, log.data() + log.size()};
+        uint32_t payloadSize = header.get<uint32_t>();
+        uint32_t checksum = header.get<uint32_t>();
+        size_t bodySize = size_t(payloadSize) + 1;
+        if (static_cast<size_t>(header.end - header.pos) < bodySize || walChecksum(header.pos, bodySize) != checksum) {
+            break; // 잘리거나 손상된 꼬리
+        }
+        WalRecordType type = static_cast<WalRecordType>(header.pos[0]);
+        ByteReader payload{header.pos + 1, header.pos + bodySize};
+        pos = header.pos + bodySize - log.data();
+
+        if (type != WalRecordType::Commit) {
+            pending.push_back({type, payload});
+            continue;
+        }
+        uint64_t lsn = payload.get<uint64_t>();
+        if (lsn > db.checkpointLsn) {
+            for (auto& record : pending) {
+                if (!applyWalRecord(db, record.first, record.second)) {
+                    ok = false;
+                    break;
+                }
+            }
+            db.lastLsn = max(db.lastLsn, lsn);
+            db.durableLsn = db.lastLsn;
+        }
+        pending.clear();
+        committedEnd = pos;
+    }
+
+    if (ok && committedEnd < log.size()) {
+        ok = ftruncate(fd, committedEnd) == 0;
+    }
+    close(fd);
+    db.walSize = committedEnd;
+    db.syncedWalSize = committedEnd;
+    return ok;
+}
+
+// 방금 쓴 파일을 다시 매핑해서 테이블이 메모리에 들고 있던 배열 대신 파일 영역을 가리키게 하는 함수
+// dirty 페이지가 파일에 쓰였으므로 버퍼 풀이 내릴 수 있는 페이지가 됨
+// 지운 표시가 있는 테이블은 파일에 살아 있는 행만 썼으므로 (행 번호가 다름) 그대로 둠
+// 실행 중인 SELECT의 뷰는 예전 배열을 계속 가리키므로 latch만 배타적으로 잡으면 됨
+// 파일을 읽지 못하거나 테이블 / 열 / 행 수가 메모리와 다르면 아무것도 바꾸지 않고 false (파일을 믿을 수 없음)
+bool reattachTables(Database& db, const string& filename) {
+    Database written;
+    if (loadBinaryDatabase(filename, written) != LoadResult::Ok || written.tables.size() != db.tables.size()) return false;
+    for (auto& tablePair : db.tables) {
+        const TableData& table = tablePair.second;
+        auto it = written.tables.find(tablePair.first);
+        if (it == written.tables.end() || it->second.columns.size() != table.columns.size() ||
+            (table.versions.deletedRows == 0 && it->second.rowCount != table.rowCount)) {
+            return false;
+        }
+    }
+    for (auto& tablePair : db.tables) {
+        TableData& table = tablePair.second;
+        if (table.versions.deletedRows != 0) continue;
+        TableData& loaded = written.tables.find(tablePair.first)->second;
+        unique_lock<shared_mutex> latch(table.latch.mutex);
+        for (size_t i = 0; i < table.columns.size(); ++i) table.columns[i] = move(loaded.columns[i]);
+    }
+    return true;
+}
+
+// 로그를 .mydb 파일에 합치고 로그를 비우는 함수 (db.walLock을 잡은 상태에서 호출)
+// 새 파일 헤더에 checkpointLsn을 기록하므로, 로그를 비우기 전에 중단되어도 같은 트랜잭션이 두 번 적용되지 않음
+// 새 파일은 옆 이름으로 쓰고 다시 로드해 확인한 뒤에만 .mydb를 바꾸고 로그를 비움 (확인에 실패하면 예전 파일과 로그가 그대로)
+// 버퍼에 남은 레코드의 변경도 파일에 들어가므로 버퍼를 함께 비우고, 기다리던 COMMIT은 모두 반영된 것으로 봄
+bool checkpointDatabase(Database& db) {
+    string filename = db.dbName + ".mydb";
+    string newName = filename + ".new";
+    uint64_t previousLsn = db.checkpointLsn;
+    db.checkpointLsn = db.lastLsn;
+    if (!writeDatabaseFile(db, newName) || !reattachTables(db, newName) ||
+        rename(newName.c_str(), filename.c_str()) != 0) {
+        unlink(newName.c_str());
+        db.checkpointLsn = previousLsn;
+        return false;
+    }
+    if (truncate(walFilename(db.dbName).c_str(), 0) != 0 && errno != ENOENT) {
+        return false;
+    }
+    db.walBuffer.clear();
+    db.walSize = 0;
+    db.syncedWalSize = 0;
+    db.durableLsn = db.lastLsn;
+    return true;
+}
+
+// CREATE DATABASE 쿼리를 처리하는 함수
+void createDatabase(const Statement& stmt) {
+    const string& dbName = stmt.name;
+
+    if (databases.find(dbName) != databases.end()) {
+        *queryErr << "Database: " << dbName << "는 이미 존재하는 데이터베이스 입니다.\n";
+        return;
+    }
+
+    // 데이터베이스 파일 생성 (테이블이 없는 바이너리 파일), 같은 이름의 예전 로그는 삭제
+    string filename = dbName + ".mydb";
+    Database db;
+    db.dbName = dbName;
+    if (!writeDatabaseFile(db, filename) || (unlink(walFilename(dbName).c_str()) != 0 && errno != ENOENT)) {
+        *queryErr << "데이터베이스 파일: " << filename << "을 생성하는데 실패했습니다. \n";
+        return;
+    }
+
+    databases[dbName] = move(db);
+
+    *queryOut << "Database: " << dbName << "를 생성 완료하였습니다. " << filename << "파일 생성완료.\n";
+}
+
+// 예전 텍스트 형식의 .mydb 파일을 읽어 메모리에 로드하는 함수
+bool loadTextDatabase(const string& filename, Database& db) {
+    ifstream file(filename); // 텍스트 모드로 파일 열기
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // 데이터를 메모리에 로드
+    string tableData;
+    string currentTableName;
+    TableSchema currentSchema;
+
+    while (getline(file, tableData)) {
+        if (tableData.find("TABLE:") != string::npos) {
+            currentTableName = tableData.substr(7); // "TABLE: " 이후의 테이블 이름 추출
+            TableData& table = db.tables[currentTableName];
+            table.schema = TableSchema{currentTableName, {}, {}};
+            initColumns(table);
+            currentSchema = table.schema; // 현재 테이블 스키마 초기화
+        } else if (tableData.find("SCHEMA:") != string::npos) {
+            string schemaLine = tableData.substr(7); // "SCHEMA:" 이후의 스키마 정의
+            replace(schemaLine.begin(), schemaLine.end(), ',', ' ');
+            istringstream schemaStream(schemaLine);
+            string columnDef;
+
+            while (schemaStream >> columnDef) {
+                size_t typeStart = columnDef.find('(');
+                size_t typeEnd = columnDef.find(')');
+                if (typeStart != string::npos && typeEnd != string::npos && typeEnd > typeStart + 1) {
+                    string columnType = columnDef.substr(typeStart + 1, typeEnd - typeStart - 1); // 데이터 타입
+                    string columnName = columnDef.substr(typeEnd + 1);  // 데이터 타입 이후의 열 이름
+                    currentSchema.columns.push_back(columnName);
+                    currentSchema.columnTypes.push_back(columnType);
+                }
+            }
+
+            db.tables[currentTableName].schema = currentSchema;
+            initColumns(db.tables[currentTableName]);
+        } else if (!currentTableName.empty() && db.tables.find(currentTableName) != db.tables.end()) {
+            istringstream rowStream(tableData);
             vector<string> row;
             string value;
 
-            while (rowStream >> value) {
-                row.push_back(value);
+            while (rowStream >> value) {
+                row.push_back(value);
+            }
+
+            if (row.empty() || row.size() != currentSchema.columns.size()) {
+                continue;
+            }
+
+            // 타입 규칙에 맞지 않는 행은 건너뜀
+            bool validRow = true;
+            for (size_t i = 0; i < row.size() && validRow; ++i) {
+                validRow = isValidValue(currentSchema.columnTypes[i], row[i]);
+            }
+            if (validRow) {
+                appendRow(db.tables[currentTableName], row);
+            }
+        }
+    }
+    return true;
+}
+
+// .mydb 파일에서 데이터를 읽어와 메모리에 로드하는 함수
+// 바이너리 형식은 mmap으로 바로 사용하고, 예전 텍스트 형식이면 파싱해서 로드
+void loadDatabase(const string& dbName) {
+    string filename = dbName + ".mydb";
+    Database db;
+    db.dbName = dbName;
+
+    LoadResult result = loadBinaryDatabase(filename, db);
+    if (result == LoadResult::NotBinary && !loadTextDatabase(filename, db)) {
+        result = LoadResult::Corrupt;
+    }
+    if (result == LoadResult::Corrupt) {
+        *queryErr << "파일: " << filename << "을 읽어오는데 실패하였습니다. \n";
+        return;
+    }
+    if (!replayWal(db)) {
+        *queryErr << "로그 파일: " << walFilename(dbName) << "을 재실행하는데 실패하였습니다. \n";
+        return;
+    }
+
+    databases[dbName] = move(db);
+    currentDatabase = dbName;
+    catalogVersion++;
+    *queryOut << "Database " << dbName << "로드 완료. \n";
+}
+
+// 예전 텍스트 형식의 .mydb 파일을 바이너리 형식으로 한 번에 변환하는 함수
+// 원본 텍스트 파일은 <db>.mydb.txt 로 남겨 둠
+bool convertDatabase(const string& dbName) {
+    string filename = dbName + ".mydb";
+    Database db;
+    db.dbName = dbName;
+
+    LoadResult result = loadBinaryDatabase(filename, db);
+    if (result == LoadResult::Ok) {
+        *queryOut << "Database " << dbName << "는 이미 바이너리 형식입니다.\n";
+        return true;
+    }
+    if (result == LoadResult::Corrupt || !loadTextDatabase(filename, db)) {
+        *queryErr << "파일: " << filename << "을 읽어오는데 실패하였습니다. \n";
+        return false;
+    }
+
+    string backupName = filename + ".txt";
+    if (rename(filename.c_str(), backupName.c_str()) != 0 || !writeDatabaseFile(db, filename)) {
+        *queryErr << "Error: " << filename << "파일을 변환하는데 실패했습니다. \n";
+        return false;
+    }
+    *queryOut << "Database " << dbName << " 변환 완료, 원본 텍스트 파일은 " << backupName << "에 보관되었습니다.\n";
+    return true;
+}
+
+// USE DATABASE 쿼리를 처리하는 함수
+void useDatabase(const Statement& stmt) {
+    const string& dbName = stmt.name;
+
+    if (databases.find(dbName) != databases.end()) {
+        // 이미 메모리에 로드된 데이터베이스 사용
+        currentDatabase = dbName;
+        catalogVersion++;
+        *queryOut << "Database: " << dbName << "를 사용합니다. \n";
+    } else {
+        // 파일에서 데이터베이스 로드 시도
+        loadDatabase(dbName);
+    }
+}
+
+// 메모리에 로드된 데이터베이스를 내리는 함수 (벤치마크가 LOAD 시간을 잴 때 사용)
+// 카탈로그를 배타적으로 잡으므로 진행 중인 쿼리와 vacuum이 모두 끝난 뒤 지움
+bool unloadDatabase(const string& dbName) {
+    unique_lock<shared_mutex> catalog(catalogMutex);
+    auto it = databases.find(dbName);
+    if (it == databases.end()) return false;
+    commitFlusher.drain(it->second);
+    databases.erase(it);
+    if (currentDatabase == dbName) currentDatabase.clear();
+    catalogVersion++;
+    return true;
+}
+
+// CREATE TABLE 쿼리를 처리하는 함수: CREATE TABLE table_name (type)column_name ...
+void createTable(const Statement& stmt) {
+    if (currentDatabase.empty()) {
+        *queryErr << "데이터베이스 선택 후 진행해주세요. \n";
+        return;
+    }
+
+    TableSchema schema;
+    schema.tableName = stmt.tableName;
+    schema.columns = stmt.columns;
+    schema.columnTypes = stmt.columnTypes;
+
+    // 테이블을 데이터베이스에 추가
+    TableData table;
+    table.schema = schema;
+    initColumns(table);
+    databases[currentDatabase].tables[schema.tableName] = move(table);
+    logCreateTable(databases[currentDatabase], schema);
+    catalogVersion++;
+
+    *queryOut << "Table: " << schema.tableName << " 테이블 생성이 완료되었습니다. 현재 데이터베이스: " << currentDatabase << ".\n";
+}
+
+// CREATE INDEX 쿼리를 처리하는 함수
+// CREATE INDEX index_name ON table_name (column_name) [USING HASH | USING BTREE]
+void createIndex(const Statement& stmt) {
+    if (currentDatabase.empty()) {
+        *queryErr << "데이터베이스 선택 후 진행해주세요. \n";
+        return;
+    }
+
+    const string& indexName = stmt.name;
+    const string& tableName = stmt.tableName;
+    const string& columnName = stmt.columns[0];
+    IndexKind kind = stmt.indexKind;
+
+    auto it = databases[currentDatabase].tables.find(tableName);
+    if (it == databases[currentDatabase].tables.end()) {
+        *queryErr << "ERROR: " << tableName << " 테이블이 존재하지 않습니다. 현재데이터베이스: " << currentDatabase << ".\n";
+        return;
+    }
+
+    TableData& table = it->second;
+    int columnIndex = findColumn(table.schema, columnName);
+    if (columnIndex < 0) {
+        *queryErr << "ERROR: 테이블에 " << columnName << " 컬럼이 존재하지 않습니다. " << tableName << ".\n";
+        return;
+    }
+    for (const auto& index : table.indexes) {
+        if (index.name == indexName) {
+            *queryErr << "ERROR: " << indexName << " 인덱스가 이미 존재합니다. 테이블: " << tableName << ".\n";
+            return;
+        }
+    }
+
+    TableIndex& index = addIndex(table, indexName, columnIndex, kind);
+    ensureIndexBuilt(table, index);
+    table.modification.touch(); // 인덱스로 읽으면 ORDER BY 없는 결과의 행 순서가 달라질 수 있음
+    logCreateIndex(databases[currentDatabase], tableName, index);
+
+    *queryOut << "Index: " << indexName << " (" << (kind == IndexKind::Hash ? "HASH" : "BTREE") << ") 인덱스 생성이 완료되었습니다. 테이블: "
+         << tableName << "(" << columnName << ").\n";
+}
+
+// ---- 대량 입력 (여러 행 INSERT / COPY) ----
+
+// 테이블에 붙이기 전에 검사를 통과한 행들을 컬럼별로 모아 두는 배치
+struct RowBatch {
+    vector<ColumnData> columns;
+    vector<char> checked; // 타입 규칙 검사 대상인 컬럼인지 (int/float/string/date)
+    size_t rowCount = 0;
+
+    explicit RowBatch(const TableSchema& schema) : columns(schema.columns.size()), checked(schema.columns.size()) {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            columns[i].type = toColumnType(schema.columnTypes[i]);
+            checked[i] = isCheckedType(schema.columnTypes[i]);
+        }
+    }
+};
+
+// 앞뒤 공백을 뺀 구간을 돌려주는 함수
+string_view trimSpaces(string_view text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == string_view::npos) return string_view();
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+// 큰따옴표 밖의 쉼표로 나눠 fields에 담는 함수 (값은 따옴표를 포함한 그대로)
+void splitFields(string_view text, vector<string_view>& fields) {
+    fields.clear();
+    bool quoted = false;
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"') {
+            quoted = !quoted;
+        } else if (text[i] == ',' && !quoted) {
+            fields.push_back(trimSpaces(text.substr(start, i - start)));
+            start = i + 1;
+        }
+    }
+    fields.push_back(trimSpaces(text.substr(start)));
+}
+
+// 한 행의 값들을 INSERT와 같은 규칙으로 검사해 배치에 추가하는 함수
+// 실패하면 error에 이유를 담고 false (배치는 일부만 추가된 상태이므로 버려야 함)
+bool appendBatchRow(RowBatch& batch, const TableSchema& schema, const vector<string_view>& values, string& error) {
+    if (values.size() != batch.columns.size()) {
+        error = "입력 값 (" + to_string(values.size()) + ")개, 컬럼 갯수가 일치 하지 않습니다. 컬럼 (" +
+                to_string(batch.columns.size()) + ")개";
+        return false;
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (!batch.checked[i]) {
+            batch.columns[i].strings.push_back(values[i]);
+        } else if (!appendCheckedValue(batch.columns[i], values[i])) {
+            error = "데이터 타입이 일치하지 않습니다. 열: " + schema.columns[i] + ", 예상 타입: " + schema.columnTypes[i] +
+                    ", 제공된 값: " + string(values[i]);
+            return false;
+        }
+    }
+    batch.rowCount++;
+    return true;
+}
+
+// COPY가 한 번에 맡기는 파일 조각 크기
+const size_t kCopyChunkBytes = 4 << 20;
+
+// COPY 쿼리를 처리하는 함수: COPY table_name FROM 'file.csv' [HEADER]
+// 파일을 줄 경계에서 조각으로 나눠 병렬로 파싱/검사하고, 모두 통과하면 조각 순서대로 테이블에 추가
+// 한 줄이라도 틀리면 아무 행도 추가하지 않음
+void copyFromFile(const Statement& stmt) {
+    if (currentDatabase.empty()) {
+        *queryErr << "데이터베이스 선택 후 진행해주세요. \n";
+        return;
+    }
+
+    const string& tableName = stmt.tableName;
+    const string& path = stmt.value;
+    auto it = databases[currentDatabase].tables.find(tableName);
+    if (it == databases[currentDatabase].tables.end()) {
+        *queryErr << "ERROR: " << tableName << " 존재하지 않습니다. 현재 데이터베이스: " << currentDatabase << ".\n";
+        return;
+    }
+    TableData& table = it->second;
+
+    auto start = chrono::steady_clock::now();
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        *queryErr << "Error: " << path << " 파일을 열 수 없습니다.\n";
+        return;
+    }
+    auto mapping = make_shared<MappedFile>();
+    if (st.st_size > 0) {
+        void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) {
+            close(fd);
+            *queryErr << "Error: " << path << " 파일을 읽을 수 없습니다.\n";
+            return;
+        }
+        mapping->base = base;
+        mapping->size = st.st_size;
+    }
+    close(fd);
+    string_view text(static_cast<const char*>(mapping->base), mapping->size);
+
+    // 헤더 줄 건너뛰기
+    size_t dataStart = 0;
+    if (stmt.header) {
+        size_t newline = text.find('\n');
+        dataStart = newline == string_view::npos ? text.size() : newline + 1;
+    }
+
+    // 줄 경계에 맞춰 조각 나누기
+    vector<size_t> bounds = {dataStart};
+    while (bounds.back() < text.size()) {
+        size_t next = bounds.back() + kCopyChunkBytes;
+        if (next >= text.size()) {
+            bounds.push_back(text.size());
+        } else {
+            size_t newline = text.find('\n', next);
+            bounds.push_back(newline == string_view::npos ? text.size() : newline + 1);
+        }
+    }
+
+    struct CopyChunk {
+        RowBatch batch;
+        size_t lines = 0;  // 조각 안의 줄 수
+        string error;      // 첫 오류 (없으면 비어 있음)
+        explicit CopyChunk(const TableSchema& schema) : batch(schema) {}
+    };
+    size_t chunkCount = bounds.size() - 1;
+    vector<CopyChunk> chunks(chunkCount, CopyChunk(table.schema));
+    parallelFor(chunkCount, [&](size_t c) {
+        CopyChunk& chunk = chunks[c];
+        vector<string_view> fields;
+        string_view part = text.substr(bounds[c], bounds[c + 1] - bounds[c]);
+        size_t pos = 0;
+        while (pos < part.size()) {
+            size_t newline = part.find('\n', pos);
+            size_t lineEnd = newline == string_view::npos ? part.size() : newline;
+            string_view line = part.substr(pos, lineEnd - pos);
+            pos = lineEnd + 1;
+            chunk.lines++;
+            if (trimSpaces(line).empty()) continue;
+            splitFields(line, fields);
+            if (!appendBatchRow(chunk.batch, table.schema, fields, chunk.error)) return;
+        }
+    });
+
+    // 가장 앞 조각의 오류를 파일 줄 번호와 함께 알림
+    size_t lineBase = stmt.header ? 1 : 0;
+    for (const auto& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            *queryErr << "Error: COPY 실패 (" << path << " " << lineBase + chunk.lines << "번째 줄): " << chunk.error
+                 << ". 테이블: " << tableName << ", 추가된 행 없음.\n";
+            return;
+        }
+        lineBase += chunk.lines;
+    }
+
+    size_t firstRow = table.rowCount;
+    WriteTransaction txn(table);
+    {
+        unique_lock<shared_mutex> latch(table.latch.mutex);
+        for (auto& chunk : chunks) {
+            appendRows(table, chunk.batch.columns, chunk.batch.rowCount, txn.id);
+            chunk.batch.columns.clear();
+        }
+    }
+    size_t copied = table.rowCount - firstRow;
+    ioStats.rowsWritten.fetch_add(copied, memory_order_relaxed);
+    logInsertRows(databases[currentDatabase], table, firstRow, copied);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    *queryOut << "COPY 완료: " << copied << "행을 " << tableName << " 테이블에 추가했습니다. " << fixed << setprecision(3) << seconds
+         << "초, " << setprecision(0) << (seconds > 0 ? copied / seconds : 0) << " rows/sec. 현재 데이터베이스: " << currentDatabase
+         << ".\n";
+    queryOut->unsetf(ios::fixed);
+    *queryOut << setprecision(6);
+}
+
+// ---- 해시 조인 (JOIN) ----
+// WHERE를 통과하는 행이 적은 쪽을 빌드 쪽으로 정해 키 해시의 상위 비트로 파티션에 나눠 담고,
+// 파티션마다 체인 해시 테이블을 만들어 다른 쪽(프로브) 행과 맞춰 봄
+// 빌드 쪽이 메모리 한도(SET JOIN_MEMORY) 안에 들어가면 프로브 쪽은 모셀 단위로 병렬로 흘려보내고,
+// 넘치면 양쪽 파티션을 임시 파일로 내보낸 뒤 한도 안에 들어가는 만큼씩 파티션을 읽어 와 병렬로 조인함
+
+// 조인 키 비교 방식 (ON 양쪽 열 타입으로 정함)
+enum class JoinKeyMode {
+    Exact,  // int-int, date-date: 해시가 키와 일대일이므로 해시만 비교
+    Double, // float이 섞인 숫자 키: double 값으로 해시 (역시 해시만 비교)
+    String  // string-string: 해시가 같으면 문자열까지 비교
+};
+
+// 파티션에 담는 조인 후보 행 하나
+struct JoinEntry {
+    uint64_t hash;
+    uint64_t row;
+    uint64_t mask; // 이 행이 만족한 WHERE 그룹 비트 (양쪽 비트가 겹쳐야 결과 행)
+};
+
+const size_t kJoinBuildRowBytes = sizeof(JoinEntry) + 12; // 빌드 행 하나가 쓰는 메모리 (항목 + 체인 + 버킷)
+const size_t kJoinMinPartitions = 64;
+const size_t kJoinMaxPartitions = 4096;
+
+// JOIN에 쓸 메모리 한도 (바이트)
+// 환경 변수 DBMS_JOIN_MEMORY_MB로 지정할 수 있고, 없으면 256MB
+size_t defaultJoinMemory() {
+    const char* forced = getenv("DBMS_JOIN_MEMORY_MB");
+    int64_t megabytes = 0;
+    if (forced != nullptr && parseInt(forced, megabytes) && megabytes > 0) return static_cast<size_t>(megabytes) << 20;
+    return size_t(256) << 20;
+}
+
+// 한 셀의 값을 문자열 끝에 붙이는 함수 (결과 블록을 모아 한 번에 쓸 때, 형식은 writeCell과 같음)
+void appendCell(string& out, const ColumnData& column, size_t row) {
+    char buffer[32];
+    switch (column.type) {
+        case ColumnType::Int: {
+            auto result = to_chars(buffer, buffer + sizeof(buffer), column.ints[row]);
+            out.append(buffer, result.ptr - buffer);
+            break;
+        }
+        case ColumnType::Float: {
+            auto result = to_chars(buffer, buffer + sizeof(buffer), column.floats[row]);
+            out.append(buffer, result.ptr - buffer);
+            break;
+        }
+        case ColumnType::Date: {
+            int32_t date = column.dates[row];
+            int length = snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", date / 10000, date / 100 % 100, date % 100);
+            out.append(buffer, length);
+            break;
+        }
+        case ColumnType::String: {
+            string_view value = column.strings.get(row);
+            out.append(value.data(), value.size());
+            break;
+        }
+    }
+}
+
+size_t joinMemoryBudget = defaultJoinMemory(); // SET JOIN_MEMORY n (MB) 으로 바꿀 수 있음
+
+// 결과에 쓰는 열 하나 (side 0: FROM 테이블, 1: JOIN 테이블)
+struct JoinColumnRef {
+    int side = 0;
+    int columnIndex = -1;
+};
+
+// 조인하는 테이블 한쪽
+struct JoinSide {
+    TableData* table = nullptr;
+    int keyColumn = -1;
+    vector<vector<Condition>> groups;      // WHERE 그룹마다 이 테이블 열에 대한 조건만
+    vector<unique_ptr<RowFilter>> filters; // 그룹별로 컴파일한 조건 (조건이 없는 그룹은 nullptr = 모든 행)
+};
+
+// 해석된 JOIN
+struct JoinPlan {
+    JoinSide sides[2];
+    JoinKeyMode keyMode = JoinKeyMode::Exact;
+    vector<vector<pair<int, int>>> termSlots; // WHERE 조건 [g][t]가 들어간 (테이블, 그룹 안 위치)
+    vector<JoinColumnRef> columns;            // 결과에 쓰는 열 (QueryPlan의 열 위치가 이 순서를 가리킴)
+    TableData joined;                         // 집계할 때 결과 행을 모으는 임시 테이블 (columns 순서)
+    TableData views[2];                       // 양쪽 테이블의 스냅샷 뷰 (sides[i].table이 가리킴)
+};
+
+// [begin, end) 구간에서 WHERE 그룹 중 하나라도 이 테이블 쪽 조건을 만족하는 행과 그 그룹 비트를 구하는 함수
+// end - begin은 kScanBlockRows 이하
+void selectJoinRows(const JoinSide& side, size_t begin, size_t end, vector<uint64_t>& rows, vector<uint64_t>& masks) {
+    rows.clear();
+    masks.clear();
+    if (side.filters.size() == 1) {
+        if (side.filters[0]) {
+            side.filters[0]->select(begin, end, rows);
+        } else {
+            for (size_t row = begin; row < end; ++row) rows.push_back(row);
+        }
+        keepVisibleRows(*side.table, rows);
+        masks.assign(rows.size(), 1);
+        return;
+    }
+
+    uint64_t bits[kScanBlockRows] = {0};
+    vector<uint64_t> selected;
+    for (size_t g = 0; g < side.filters.size(); ++g) {
+        uint64_t bit = uint64_t(1) << g;
+        if (!side.filters[g]) {
+            for (size_t row = begin; row < end; ++row) bits[row - begin] |= bit;
+            continue;
+        }
+        selected.clear();
+        side.filters[g]->select(begin, end, selected);
+        for (uint64_t row : selected) bits[row - begin] |= bit;
+    }
+    bool checkVersions = !allRowsVisible(*side.table);
+    for (size_t row = begin; row < end; ++row) {
+        if (bits[row - begin] == 0 || (checkVersions && !rowVisible(*side.table, row))) continue;
+        rows.push_back(row);
+        masks.push_back(bits[row - begin]);
+    }
+}
+
+// 한쪽 테이블에서 조인 후보가 되는 행 수를 세는 함수 (WHERE 조건이 없으면 전체 행 수)
+size_t countJoinRows(const JoinSide& side) {
+    const TableData& table = *side.table;
+    if (side.filters.size() == 1 && !side.filters[0] && allRowsVisible(table)) return table.rowCount;
+    size_t morsels = (table.rowCount + kMorselRows - 1) / kMorselRows;
+    vector<size_t> counts(morsels, 0);
+    parallelFor(morsels, [&](size_t morsel) {
+        vector<uint64_t> rows, masks;
+        size_t morselEnd = min(table.rowCount, (morsel + 1) * kMorselRows);
+        for (size_t begin = morsel * kMorselRows; begin < morselEnd; begin += kScanBlockRows) {
+            selectJoinRows(side, begin, min(morselEnd, begin + kScanBlockRows), rows, masks);
+            counts[morsel] += rows.size();
+        }
+    });
+    size_t total = 0;
+    for (size_t count : counts) total += count;
+    return total;
+}
+
+// 조인 키를 키 비교 방식에 맞게 해시해 out에 쓰는 함수 (열 타입별 루프)
+void hashJoinKeys(const ColumnData& column, JoinKeyMode mode, const uint64_t* rows, size_t count, uint64_t* out) {
+    switch (column.type) {
+        case ColumnType::Int:
+            if (mode == JoinKeyMode::Double) {
+                for (size_t i = 0; i < count; ++i) out[i] = hashDouble(static_cast<double>(column.ints[rows[i]]));
+            } else {
+                for (size_t i = 0; i < count; ++i) out[i] = mixHash(static_cast<uint64_t>(column.ints[rows[i]]));
+            }
+            break;
+        case ColumnType::Float:
+            for (size_t i = 0; i < count; ++i) out[i] = hashDouble(column.floats[rows[i]]);
+            break;
+        case ColumnType::Date:
+            for (size_t i = 0; i < count; ++i) out[i] = mixHash(static_cast<uint32_t>(column.dates[rows[i]]));
+            break;
+        case ColumnType::String:
+            for (size_t i = 0; i < count; ++i) out[i] = mixHash(hash<string_view>()(column.strings.get(rows[i])));
+            break;
+    }
+}
+
+// 파티션 하나의 빌드 행으로 만든 체인 해시 테이블
+// 버킷은 해시의 하위 비트로 고르고 (파티션은 상위 비트), 같은 버킷 안에서는 행 번호 오름차순
+class JoinHashTable {
+public:
+    void build(vector<JoinEntry>&& entries) {
+        entries_ = move(entries);
+        size_t buckets = 16;
+        while (buckets < entries_.size() * 2) buckets *= 2;
+        mask_ = buckets - 1;
+        heads_.assign(buckets, UINT32_MAX);
+        next_.resize(entries_.size());
+        for (size_t i = entries_.size(); i-- > 0;) {
+            size_t bucket = entries_[i].hash & mask_;
+            next_[i] = heads_[bucket];
+            heads_[bucket] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // 해시가 같은 빌드 행마다 match(entry)를 호출
+    template <typename Match>
+    void probe(uint64_t hash, Match match) const {
+        probeFrom(head(hash), hash, match);
+    }
+
+    // 버킷의 첫 항목 번호 (없으면 UINT32_MAX)부터 체인을 따라감
+    template <typename Match>
+    void probeFrom(uint32_t first, uint64_t hash, Match match) const {
+        for (uint32_t i = first; i != UINT32_MAX; i = next_[i]) {
+            if (entries_[i].hash == hash) match(entries_[i]);
+        }
+    }
+
+    uint32_t head(uint64_t hash) const { return heads_[hash & mask_]; }
+    void prefetchBucket(uint64_t hash) const { __builtin_prefetch(&heads_[hash & mask_]); }
+    void prefetchEntry(uint32_t i) const {
+        if (i != UINT32_MAX) __builtin_prefetch(&entries_[i]);
+    }
+
+private:
+    vector<JoinEntry> entries_;
+    vector<uint32_t> heads_;
+    vector<uint32_t> next_;
+    uint64_t mask_ = 0;
+};
+
+// 조인 결과 행 번호 쌍 (rows[0]: FROM 테이블, rows[1]: JOIN 테이블)
+struct JoinOutput {
+    vector<uint64_t> rows[2];
+};
+
+// 프로브 행 하나와 키가 같고 WHERE 그룹이 겹치는 빌드 행들을 결과에 추가
+class JoinProber {
+public:
+    JoinProber(const JoinPlan& join, int probeSide) : probeSide_(probeSide), buildSide_(1 - probeSide) {
+        if (join.keyMode == JoinKeyMode::String) {
+            probeKeys_ = &join.sides[probeSide_].table->columns[join.sides[probeSide_].keyColumn].strings;
+            buildKeys_ = &join.sides[buildSide_].table->columns[join.sides[buildSide_].keyColumn].strings;
+        }
+    }
+
+    void probe(const JoinHashTable& table, uint64_t hash, uint64_t row, uint64_t mask, JoinOutput& out) const {
+        probeFrom(table, table.head(hash), hash, row, mask, out);
+    }
+
+    // 블록 단위 프로브: 묶음마다 버킷과 첫 항목을 먼저 prefetch해 캐시 미스를 겹친 뒤 체인을 따라감
+    // tableFor(hash)는 그 해시가 속한 파티션의 해시 테이블
+    template <typename TableFor>
+    void probeBlock(TableFor tableFor, const uint64_t* hashes, const uint64_t* rows, const uint64_t* masks, size_t count,
+                    JoinOutput& out) const {
+        const size_t kBatch = 64;
+        uint32_t heads[kBatch];
+        for (size_t base = 0; base < count; base += kBatch) {
+            size_t n = min(kBatch, count - base);
+            for (size_t i = 0; i < n; ++i) tableFor(hashes[base + i]).prefetchBucket(hashes[base + i]);
+            for (size_t i = 0; i < n; ++i) {
+                const JoinHashTable& table = tableFor(hashes[base + i]);
+                heads[i] = table.head(hashes[base + i]);
+                table.prefetchEntry(heads[i]);
+            }
+            for (size_t i = 0; i < n; ++i) {
+                probeFrom(tableFor(hashes[base + i]), heads[i], hashes[base + i], rows[base + i], masks[base + i], out);
+            }
+        }
+    }
+
+private:
+    void probeFrom(const JoinHashTable& table, uint32_t first, uint64_t hash, uint64_t row, uint64_t mask, JoinOutput& out) const {
+        table.probeFrom(first, hash, [&](const JoinEntry& entry) {
+            if ((entry.mask & mask) == 0) return;
+            if (probeKeys_ != nullptr && buildKeys_->get(entry.row) != probeKeys_->get(row)) return;
+            out.rows[probeSide_].push_back(row);
+            out.rows[buildSide_].push_back(entry.row);
+        });
+    }
+
+    int probeSide_;
+    int buildSide_;
+    const StringColumn* probeKeys_ = nullptr; // 문자열 키일 때만 사용
+    const StringColumn* buildKeys_ = nullptr;
+};
+
+// 메모리 한도를 넘은 중간 결과(조인 파티션, 정렬 런)를 내보낼 임시 파일을 여는 함수
+// 이름은 바로 지우므로 닫으면 사라짐
+int openSpillFile() {
+    const char* dir = getenv("TMPDIR");
+    string path = string(dir != nullptr && *dir != '\0' ? dir : "/tmp") + "/mydb_spill_XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd >= 0) unlink(path.c_str());
+    return fd;
+}
+
+// 파티션별 조인 후보를 모아 두는 곳
+// 메모리에 둔 양이 한도를 넘으면 그때까지 모은 것과 이후에 들어오는 것을 모두 임시 파일로 내보냄
+// 파티션을 꺼낼 때는 모셀 순서(= 행 번호 순서)로 이어 붙여 돌려줌
+class JoinPartitionStore {
+public:
+    JoinPartitionStore(size_t partitions, size_t budget) : chunks_(partitions), counts_(partitions, 0), budget_(budget) {}
+    ~JoinPartitionStore() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    // 모셀 하나에서 나온 파티션별 항목을 넘김 (여러 스레드에서 호출)
+    void add(size_t morsel, vector<vector<JoinEntry>>& parts) {
+        lock_guard<mutex> lock(mutex_);
+        for (size_t p = 0; p < parts.size(); ++p) {
+            if (parts[p].empty()) continue;
+            size_t bytes = parts[p].size() * sizeof(JoinEntry);
+            if (fd_ < 0 && !spillFailed_ && memoryBytes_ + bytes > budget_) spillAll();
+
+            Chunk chunk;
+            chunk.morsel = morsel;
+            chunk.count = parts[p].size();
+            counts_[p] += chunk.count;
+            if (fd_ < 0 || !writeChunk(parts[p].data(), chunk)) {
+                memoryBytes_ += bytes;
+                chunk.entries = move(parts[p]);
+            }
+            chunks_[p].push_back(move(chunk));
+            parts[p] = vector<JoinEntry>();
+        }
+    }
+
+    // 파티션 하나의 항목을 꺼냄 (꺼낸 뒤에는 비워짐, 파일을 읽지 못하면 false)
+    bool take(size_t partition, vector<JoinEntry>& out) {
+        vector<Chunk>& chunks = chunks_[partition];
+        sort(chunks.begin(), chunks.end(), [](const Chunk& a, const Chunk& b) { return a.morsel < b.morsel; });
+        out.clear();
+        if (chunks.size() == 1 && !chunks[0].entries.empty()) {
+            out = move(chunks[0].entries);
+        } else {
+            out.reserve(counts_[partition]);
+            for (const auto& chunk : chunks) {
+                if (!chunk.entries.empty()) {
+                    out.insert(out.end(), chunk.entries.begin(), chunk.entries.end());
+                    continue;
+                }
+                size_t first = out.size();
+                out.resize(first + chunk.count);
+                if (!readChunk(out.data() + first, chunk)) return false;
+            }
+        }
+        vector<Chunk>().swap(chunks);
+        return true;
+    }
+
+    size_t count(size_t partition) const { return counts_[partition]; }
+    bool spilled() const { return fd_ >= 0; }
+    uint64_t spilledBytes() const { return fileSize_; }
+
+private:
+    // 모셀 하나가 한 파티션에 넣은 항목 (메모리에 있거나 파일의 offset 위치에 있음)
+    struct Chunk {
+        size_t morsel = 0;
+        size_t count = 0;
+        vector<JoinEntry> entries;
+        uint64_t offset = 0;
+    };
+
+    // 지금까지 메모리에 모은 항목을 모두 파일로 내보냄 (파일을 못 만들면 계속 메모리에 둠)
+    void spillAll() {
+        fd_ = openSpillFile();
+        if (fd_ < 0) {
+            spillFailed_ = true;
+            return;
+        }
+        for (auto& chunks : chunks_) {
+            for (auto& chunk : chunks) {
+                if (chunk.entries.empty() || !writeChunk(chunk.entries.data(), chunk)) continue;
+                memoryBytes_ -= chunk.count * sizeof(JoinEntry);
+                vector<JoinEntry>().swap(chunk.entries);
+            }
+        }
+    }
+
+    bool writeChunk(const JoinEntry* entries, Chunk& chunk) {
+        size_t bytes = chunk.count * sizeof(JoinEntry);
+        if (!writeAll(fd_, reinterpret_cast<const char*>(entries), bytes)) {
+            // 일부만 쓰였을 수 있으므로 다음 쓰기 위치를 파일 끝으로 맞춤
+            lseek(fd_, static_cast<off_t>(fileSize_), SEEK_SET);
+            return false;
+        }
+        chunk.offset = fileSize_;
+        fileSize_ += bytes;
+        return true;
+    }
+
+    bool readChunk(JoinEntry* out, const Chunk& chunk) const {
+        char* data = reinterpret_cast<char*>(out);
+        size_t size = chunk.count * sizeof(JoinEntry);
+        uint64_t offset = chunk.offset;
+        while (size > 0) {
+            ssize_t got = pread(fd_, data, size, static_cast<off_t>(offset));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            data += got;
+            size -= got;
+            offset += got;
+        }
+        return true;
+    }
+
+    vector<vector<Chunk>> chunks_;
+    vector<size_t> counts_;
+    size_t budget_;
+    size_t memoryBytes_ = 0;
+    mutex mutex_;
+    int fd_ = -1;
+    bool spillFailed_ = false;
+    uint64_t fileSize_ = 0;
+};
+
+// 한쪽 테이블의 조인 후보를 모셀 단위로 병렬로 골라 키 해시의 상위 비트로 파티션을 나눠 store에 넣는 함수
+void partitionJoinSide(const JoinPlan& join, int side, unsigned shift, size_t partitions, JoinPartitionStore& store) {
+    const JoinSide& source = join.sides[side];
+    const TableData& table = *source.table;
+    const ColumnData& key = table.columns[source.keyColumn];
+    size_t morsels = (table.rowCount + kMorselRows - 1) / kMorselRows;
+    parallelFor(morsels, [&](size_t morsel) {
+        vector<vector<JoinEntry>> parts(partitions);
+        vector<uint64_t> rows, masks, hashes(kScanBlockRows);
+        size_t morselEnd = min(table.rowCount, (morsel + 1) * kMorselRows);
+        for (size_t begin = morsel * kMorselRows; begin < morselEnd; begin += kScanBlockRows) {
+            size_t end = min(morselEnd, begin + kScanBlockRows);
+            selectJoinRows(source, begin, end, rows, masks);
+            if (!rows.empty()) touchColumn(key, begin, end - begin);
+            hashJoinKeys(key, join.keyMode, rows.data(), rows.size(), hashes.data());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                parts[hashes[i] >> shift].push_back({hashes[i], rows[i], masks[i]});
+            }
+        }
+        store.add(morsel, parts);
+    });
+}
+
+// 조인 결과를 블록 단위로 emit(FROM 테이블 행들, JOIN 테이블 행들, 개수)에 넘기는 함수 (호출 스레드에서 차례로 호출)
+// emit이 false를 돌려주면 (LIMIT을 채움) 남은 부분은 조인하지 않음
+// 결과 순서는 메모리 안에서 끝나면 프로브 쪽 테이블의 행 순서, 파티션을 내보냈으면 파티션 순서
+// 임시 파일을 읽지 못하면 오류를 출력하고 false
+using JoinEmit = function<bool(const uint64_t*, const uint64_t*, size_t)>;
+
+bool hashJoin(const JoinPlan& join, const JoinEmit& emit, QueryProfile* profile = nullptr) {
+    // 후보가 적은 쪽을 빌드 쪽으로 (같으면 JOIN 테이블)
+    size_t counts[2] = {countJoinRows(join.sides[0]), countJoinRows(join.sides[1])};
+    int buildSide = counts[1] <= counts[0] ? 1 : 0;
+    int probeSide = 1 - buildSide;
+    if (profile) {
+        profile->joinCandidates[0] = counts[0];
+        profile->joinCandidates[1] = counts[1];
+        profile->buildSide = buildSide;
+    }
+    if (counts[buildSide] == 0) return true;
+
+    // 파티션 하나가 메모리 한도의 1/4 이하가 되도록 파티션 수를 정함
+    size_t partitions = kJoinMinPartitions;
+    while (partitions < kJoinMaxPartitions && counts[buildSide] * kJoinBuildRowBytes / partitions > joinMemoryBudget / 4) {
+        partitions *= 2;
+    }
+    unsigned shift = 64 - __builtin_ctzll(partitions);
+
+    JoinPartitionStore build(partitions, joinMemoryBudget / kJoinBuildRowBytes * sizeof(JoinEntry));
+    partitionJoinSide(join, buildSide, shift, partitions, build);
+    JoinProber prober(join, probeSide);
+    bool more = true;
+    auto emitOutputs = [&](vector<JoinOutput>& outputs) {
+        for (auto& output : outputs) {
+            if (more && !output.rows[0].empty()) more = emit(output.rows[0].data(), output.rows[1].data(), output.rows[0].size());
+            output = JoinOutput();
+        }
+    };
+
+    if (!build.spilled()) {
+        // 모든 파티션의 해시 테이블을 병렬로 만든 뒤, 프로브 쪽을 모셀 묶음 단위로 병렬로 찾고 모셀 순서대로 넘김
+        vector<JoinHashTable> tables(partitions);
+        parallelFor(partitions, [&](size_t p) {
+            vector<JoinEntry> entries;
+            build.take(p, entries);
+            tables[p].build(move(entries));
+        });
+
+        const JoinSide& probe = join.sides[probeSide];
+        const TableData& table = *probe.table;
+        const ColumnData& key = table.columns[probe.keyColumn];
+        size_t morsels = (table.rowCount + kMorselRows - 1) / kMorselRows;
+        size_t wave = max<size_t>(1, scanThreads) * 4;
+        for (size_t first = 0; first < morsels && more; first += wave) {
+            vector<JoinOutput> outputs(min(wave, morsels - first));
+            parallelFor(outputs.size(), [&](size_t i) {
+                vector<uint64_t> rows, masks, hashes(kScanBlockRows);
+                size_t morsel = first + i;
+                size_t morselEnd = min(table.rowCount, (morsel + 1) * kMorselRows);
+                for (size_t begin = morsel * kMorselRows; begin < morselEnd; begin += kScanBlockRows) {
+                    size_t end = min(morselEnd, begin + kScanBlockRows);
+                    selectJoinRows(probe, begin, end, rows, masks);
+                    if (!rows.empty()) touchColumn(key, begin, end - begin);
+                    hashJoinKeys(key, join.keyMode, rows.data(), rows.size(), hashes.data());
+                    prober.probeBlock([&](uint64_t hash) -> const JoinHashTable& { return tables[hash >> shift]; }, hashes.data(),
+                                      rows.data(), masks.data(), rows.size(), outputs[i]);
+                }
+            });
+            emitOutputs(outputs);
+        }
+        return true;
+    }
+
+    // 빌드 쪽이 한도를 넘었으므로 프로브 쪽도 같은 파티션으로 나눠 내보낸 뒤
+    // 한도 안에 들어가는 수만큼씩 파티션을 읽어 와 병렬로 조인하고 파티션 순서대로 넘김
+    JoinPartitionStore probe(partitions, joinMemoryBudget / 2);
+    partitionJoinSide(join, probeSide, shift, partitions, probe);
+    *queryErr << "JOIN: 빌드 쪽(" << counts[buildSide] << "행)이 메모리 한도를 넘어 파티션 " << partitions << "개를 임시 파일로 내보냈습니다 ("
+         << (build.spilledBytes() + probe.spilledBytes()) / (1 << 20) << "MB).\n";
+
+    size_t largest = 1;
+    for (size_t p = 0; p < partitions; ++p) largest = max(largest, build.count(p) * kJoinBuildRowBytes);
+    size_t wave = max<size_t>(1, min(max<size_t>(1, scanThreads), joinMemoryBudget / 2 / largest));
+    atomic<bool> failed(false);
+    for (size_t first = 0; first < partitions && more && !failed; first += wave) {
+        vector<JoinOutput> outputs(min(wave, partitions - first));
+        parallelFor(outputs.size(), [&](size_t i) {
+            size_t p = first + i;
+            vector<JoinEntry> buildEntries, probeEntries;
+            if (!build.take(p, buildEntries) || !probe.take(p, probeEntries)) {
+                failed = true;
+                return;
+            }
+            JoinHashTable table;
+            table.build(move(buildEntries));
+            for (const auto& entry : probeEntries) prober.probe(table, entry.hash, entry.row, entry.mask, outputs[i]);
+        });
+        if (!failed) emitOutputs(outputs);
+    }
+    if (failed) {
+        *queryErr << "ERROR: JOIN 임시 파일을 읽지 못했습니다.\n";
+        return false;
+    }
+    return true;
+}
+
+// rows 위치의 값들을 같은 타입 컬럼 끝에 이어 붙이는 함수
+void gatherColumn(ColumnData& out, const ColumnData& in, const uint64_t* rows, size_t count) {
+    switch (in.type) {
+        case ColumnType::Int: {
+            size_t first = out.ints.size();
+            out.ints.resize(first + count);
+            int64_t* values = out.ints.mutableData() + first;
+            for (size_t i = 0; i < count; ++i) values[i] = in.ints[rows[i]];
+            break;
+        }
+        case ColumnType::Float: {
+            size_t first = out.floats.size();
+            out.floats.resize(first + count);
+            double* values = out.floats.mutableData() + first;
+            for (size_t i = 0; i < count; ++i) values[i] = in.floats[rows[i]];
+            break;
+        }
+        case ColumnType::Date: {
+            size_t first = out.dates.size();
+            out.dates.resize(first + count);
+            int32_t* values = out.dates.mutableData() + first;
+            for (size_t i = 0; i < count; ++i) values[i] = in.dates[rows[i]];
+            break;
+        }
+        case ColumnType::String:
+            for (size_t i = 0; i < count; ++i) out.strings.push_back(in.strings.get(rows[i]));
+            break;
+    }
+}
+
+// ---- 정렬 (ORDER BY / LIMIT) ----
+// 정렬할 행은 (첫 정렬 키를 순서가 같은 부호 없는 정수로 바꾼 값, 행 번호) 16바이트 항목으로 다룸
+// 첫 키가 숫자/날짜면 그 정수만으로 순서가 정해지고, 같을 때만 나머지 키를 열에서 직접 비교함
+// LIMIT k가 작으면 스레드마다 크기 k의 힙에 앞선 k개만 남기고, 그 외에는 정렬된 런들을 k-way 병합함
+// 모은 항목이 메모리 한도(SET SORT_MEMORY)를 넘으면 정렬한 런을 임시 파일에 쓰고 병합할 때 조금씩 읽어 옴
+
+// 해석된 ORDER BY 키 하나
+struct OrderKey {
+    int index = -1; // 일반 SELECT는 열 위치, 집계 SELECT는 SELECT 항목 위치
+    bool descending = false;
+};
+
+struct SortEntry {
+    uint64_t key; // 첫 정렬 키 (DESC면 비트 반전)
+    uint64_t row;
+};
+
+// 정렬에 쓸 메모리 한도 (바이트)
+// 환경 변수 DBMS_SORT_MEMORY_MB로 지정할 수 있고, 없으면 256MB
+size_t defaultSortMemory() {
+    const char* forced = getenv("DBMS_SORT_MEMORY_MB");
+    int64_t megabytes = 0;
+    if (forced != nullptr && parseInt(forced, megabytes) && megabytes > 0) return static_cast<size_t>(megabytes) << 20;
+    return size_t(256) << 20;
+}
+
+size_t sortMemoryBudget = defaultSortMemory(); // SET SORT_MEMORY n (MB) 으로 바꿀 수 있음
+
+// 실수를 크기 순서가 같은 부호 없는 정수로 바꾸는 함수 (-0.0과 0.0은 같은 값)
+uint64_t floatSortKey(double value) {
+    if (value == 0) value = 0.0;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) != 0 ? ~bits : bits | (uint64_t(1) << 63);
+}
+
+// 문자열의 앞 8바이트를 빅 엔디언 정수로 만드는 함수 (같으면 전체를 비교해야 함)
+uint64_t stringSortKey(string_view value) {
+    uint64_t key = 0;
+    size_t length = min<size_t>(8, value.size());
+    for (size_t i = 0; i < length; ++i) key |= static_cast<uint64_t>(static_cast<unsigned char>(value[i])) << (56 - 8 * i);
+    return key;
+}
+
+// ORDER BY 키들로 정한 행 순서 (키가 모두 같으면 행 번호 순서)
+class RowOrder {
+public:
+    RowOrder(const TableData& table, const vector<OrderKey>& keys) {
+        for (const auto& key : keys) keys_.push_back({&table.columns[key.index], key.descending});
+        // 숫자/날짜 키는 정수가 값과 일대일이므로 같으면 바로 다음 키로 넘어감
+        exactFirst_ = keys_[0].column->type != ColumnType::String;
+    }
+
+    // 행들의 정렬 항목을 out에 씀 (첫 키 열의 타입별 루프)
+    void makeEntries(const uint64_t* rows, size_t count, SortEntry* out) const {
+        const ColumnData& column = *keys_[0].column;
+        uint64_t flip = keys_[0].descending ? UINT64_MAX : 0;
+        switch (column.type) {
+            case ColumnType::Int:
+                for (size_t i = 0; i < count; ++i) {
+                    out[i] = {(static_cast<uint64_t>(column.ints[rows[i]]) ^ (uint64_t(1) << 63)) ^ flip, rows[i]};
+                }
+                break;
+            case ColumnType::Float:
+                for (size_t i = 0; i < count; ++i) out[i] = {floatSortKey(column.floats[rows[i]]) ^ flip, rows[i]};
+                break;
+            case ColumnType::Date:
+                for (size_t i = 0; i < count; ++i) {
+                    out[i] = {(static_cast<uint32_t>(column.dates[rows[i]]) ^ uint64_t(0x80000000)) ^ flip, rows[i]};
+                }
+                break;
+            case ColumnType::String:
+                for (size_t i = 0; i < count; ++i) out[i] = {stringSortKey(column.strings.get(rows[i])) ^ flip, rows[i]};
+                break;
+        }
+    }
+
+    bool less(const SortEntry& a, const SortEntry& b) const {
+        if (a.key != b.key) return a.key < b.key;
+        for (size_t k = exactFirst_ ? 1 : 0; k < keys_.size(); ++k) {
+            int c = compareCells(*keys_[k].column, a.row, b.row);
+            if (c != 0) return keys_[k].descending ? c > 0 : c < 0;
+        }
+        return a.row < b.row;
+    }
+
+private:
+    struct Key {
+        const ColumnData* column;
+        bool descending;
+    };
+
+    vector<Key> keys_;
+    bool exactFirst_ = true;
+};
+
+// 정렬 순서상 앞선 limit개만 남기는 힙 (맨 위가 남긴 것 중 가장 뒤)
+class TopKHeap {
+public:
+    TopKHeap(const RowOrder& order, size_t limit) : order_(order), limit_(limit) {}
+
+    void add(const SortEntry& entry) {
+        auto less = [this](const SortEntry& a, const SortEntry& b) { return order_.less(a, b); };
+        if (heap_.size() < limit_) {
+            heap_.push_back(entry);
+            push_heap(heap_.begin(), heap_.end(), less);
+        } else if (order_.less(entry, heap_.front())) {
+            pop_heap(heap_.begin(), heap_.end(), less);
+            heap_.back() = entry;
+            push_heap(heap_.begin(), heap_.end(), less);
+        }
+    }
+
+    const vector<SortEntry>& entries() const { return heap_; }
+
+private:
+    const RowOrder& order_;
+    size_t limit_;
+    vector<SortEntry> heap_;
+};
+
+// 외부 병합 정렬기: add()로 항목을 모으다가 한도를 채우면 스레드 수만큼 나눠 병렬로 정렬한 런들을 임시 파일에 씀
+// finish()에서 메모리에 남은 런과 파일의 런들을 k-way 병합해 순서대로 넘김
+class RowSorter {
+public:
+    RowSorter(const RowOrder& order, size_t budget)
+        : order_(order), capacity_(max<size_t>(kScanBlockRows, budget / sizeof(SortEntry))), budget_(budget) {}
+    ~RowSorter() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    void add(const SortEntry* entries, size_t count) {
+        while (count > 0) {
+            size_t n = min(count, capacity_ - pending_.size());
+            pending_.insert(pending_.end(), entries, entries + n);
+            entries += n;
+            count -= n;
+            if (pending_.size() == capacity_) spill();
+        }
+    }
+
+    // 정렬 순서대로 limit개까지 visit(rows, count)에 넘김 (임시 파일을 읽지 못하면 false)
+    template <typename Visit>
+    bool finish(size_t limit, Visit visit) {
+        sortPending();
+        vector<Cursor> cursors(runs_.size());
+        size_t bufferEntries = max<size_t>(1024, budget_ / sizeof(SortEntry) / max<size_t>(1, runs_.size()));
+        for (size_t i = 0; i < runs_.size(); ++i) {
+            cursors[i].run = &runs_[i];
+            cursors[i].remaining = runs_[i].count;
+            cursors[i].offset = runs_[i].offset;
+            if (!refill(cursors[i], bufferEntries)) return false;
+        }
+
+        // 각 런의 현재 항목 중 가장 앞선 것을 꺼냄 (최소 힙)
+        auto later = [&](size_t a, size_t b) { return order_.less(*cursors[b].cur, *cursors[a].cur); };
+        vector<size_t> heap;
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            if (cursors[i].cur != cursors[i].end) heap.push_back(i);
+        }
+        make_heap(heap.begin(), heap.end(), later);
+        vector<uint64_t> rows;
+        rows.reserve(kScanBlockRows);
+        while (!heap.empty() && limit > 0) {
+            pop_heap(heap.begin(), heap.end(), later);
+            Cursor& cursor = cursors[heap.back()];
+            rows.push_back(cursor.cur->row);
+            --limit;
+            if (rows.size() == kScanBlockRows) {
+                visit(rows.data(), rows.size());
+                rows.clear();
+            }
+            if (++cursor.cur == cursor.end && !refill(cursor, bufferEntries)) return false;
+            if (cursor.cur != cursor.end) {
+                push_heap(heap.begin(), heap.end(), later);
+            } else {
+                heap.pop_back();
+            }
+        }
+        if (!rows.empty()) visit(rows.data(), rows.size());
+        return true;
+    }
+
+    bool spilled() const { return fd_ >= 0; }
+    uint64_t spilledBytes() const { return fileSize_; }
+
+private:
+    // 정렬된 항목 묶음: 메모리(data)에 있거나 임시 파일의 offset 위치에 있음
+    struct Run {
+        const SortEntry* data = nullptr;
+        size_t count = 0;
+        uint64_t offset = 0;
+    };
+
+    // 병합 중인 런 하나의 읽기 위치 (파일 런은 buffer에 조금씩 읽어 옴)
+    struct Cursor {
+        const Run* run = nullptr;
+        const SortEntry* cur = nullptr;
+        const SortEntry* end = nullptr;
+        size_t remaining = 0;
+        uint64_t offset = 0;
+        vector<SortEntry> buffer;
+    };
+
+    // 아직 정렬하지 않은 항목을 스레드 수만큼 나눠 병렬로 정렬하고 메모리 런으로 등록
+    void sortPending() {
+        size_t pieces = max<size_t>(1, min(max<size_t>(1, scanThreads), pending_.size() / kMorselRows));
+        size_t first = runs_.size();
+        for (size_t i = 0; i < pieces; ++i) {
+            size_t begin = pending_.size() * i / pieces;
+            size_t end = pending_.size() * (i + 1) / pieces;
+            if (end > begin) runs_.push_back({pending_.data() + begin, end - begin, 0});
+        }
+        parallelFor(runs_.size() - first, [&](size_t i) {
+            Run& run = runs_[first + i];
+            SortEntry* data = const_cast<SortEntry*>(run.data);
+            sort(data, data + run.count, [this](const SortEntry& a, const SortEntry& b) { return order_.less(a, b); });
+        });
+    }
+
+    // 모은 항목을 정렬해 파일 런으로 쓰고 비움 (파일을 만들거나 쓰지 못하면 메모리에 계속 모음)
+    void spill() {
+        if (fd_ < 0 && !spillFailed_) {
+            fd_ = openSpillFile();
+            spillFailed_ = fd_ < 0;
+        }
+        if (spillFailed_) {
+            capacity_ = SIZE_MAX;
+            return;
+        }
+        size_t first = runs_.size();
+        sortPending();
+        for (size_t i = first; i < runs_.size(); ++i) {
+            Run& run = runs_[i];
+            size_t bytes = run.count * sizeof(SortEntry);
+            if (!writeAll(fd_, reinterpret_cast<const char*>(run.data), bytes)) {
+                // 이미 쓴 런은 그대로 두고 나머지는 메모리에 모음
+                spillFailed_ = true;
+                capacity_ = SIZE_MAX;
+                runs_.resize(first);
+                return;
+            }
+            run.data = nullptr;
+            run.offset = fileSize_;
+            fileSize_ += bytes;
+        }
+        pending_.clear();
+    }
+
+    bool refill(Cursor& cursor, size_t bufferEntries) {
+        if (cursor.run->data != nullptr) {
+            cursor.cur = cursor.run->data + (cursor.run->count - cursor.remaining);
+            cursor.end = cursor.cur + cursor.remaining;
+            cursor.remaining = 0;
+            return true;
+        }
+        size_t count = min(bufferEntries, cursor.remaining);
+        cursor.buffer.resize(count);
+        char* data = reinterpret_cast<char*>(cursor.buffer.data());
+        size_t size = count * sizeof(SortEntry);
+        while (size > 0) {
+            ssize_t got = pread(fd_, data, size, static_cast<off_t>(cursor.offset));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                *queryErr << "ERROR: 정렬 임시 파일을 읽지 못했습니다.\n";
+                return false;
+            }
+            data += got;
+            size -= got;
+            cursor.offset += got;
+        }
+        cursor.cur = cursor.buffer.data();
+        cursor.end = cursor.cur + count;
+        cursor.remaining -= count;
+        return true;
+    }
+
+    const RowOrder& order_;
+    size_t capacity_;
+    size_t budget_;
+    vector<SortEntry> pending_;
+    vector<Run> runs_;
+    int fd_ = -1;
+    bool spillFailed_ = false;
+    uint64_t fileSize_ = 0;
+};
+
+// WHERE를 만족하는 행을 ORDER BY 순서대로 limit개까지 visit(rows, count)에 넘기는 함수 (임시 파일 오류면 false)
+// limit이 메모리 한도 안에 들어가면 스레드별 top-k 힙, 아니면 외부 병합 정렬
+template <typename Visit>
+bool sortTable(TableData& table, const vector<vector<Condition>>& groups, const RowFilter& filter, const vector<OrderKey>& keys,
+               size_t limit, Visit visit) {
+    if (limit == 0) return true;
+    RowOrder order(table, keys);
+    size_t threads = max<size_t>(1, scanThreads);
+    if (limit <= sortMemoryBudget / sizeof(SortEntry) / threads) {
+        vector<unique_ptr<TopKHeap>> heaps(threads);
+        scanTableParallel(table, groups, filter, [&](size_t worker, const uint64_t* rows, size_t count) {
+            if (!heaps[worker]) heaps[worker].reset(new TopKHeap(order, limit));
+            SortEntry entries[kScanBlockRows];
+            for (size_t done = 0; done < count; done += kScanBlockRows) {
+                size_t n = min(kScanBlockRows, count - done);
+                order.makeEntries(rows + done, n, entries);
+                for (size_t i = 0; i < n; ++i) heaps[worker]->add(entries[i]);
+            }
+        });
+
+        vector<SortEntry> top;
+        for (const auto& heap : heaps) {
+            if (heap) top.insert(top.end(), heap->entries().begin(), heap->entries().end());
+        }
+        size_t count = min(limit, top.size());
+        partial_sort(top.begin(), top.begin() + count, top.end(),
+                     [&](const SortEntry& a, const SortEntry& b) { return order.less(a, b); });
+        vector<uint64_t> rows;
+        for (size_t i = 0; i < count; ++i) rows.push_back(top[i].row);
+        if (!rows.empty()) visit(rows.data(), rows.size());
+        return true;
+    }
+
+    RowSorter sorter(order, sortMemoryBudget);
+    mutex sorterMutex;
+    scanTableParallel(table, groups, filter, [&](size_t, const uint64_t* rows, size_t count) {
+        SortEntry entries[kScanBlockRows];
+        for (size_t done = 0; done < count; done += kScanBlockRows) {
+            size_t n = min(kScanBlockRows, count - done);
+            order.makeEntries(rows + done, n, entries);
+            lock_guard<mutex> lock(sorterMutex);
+            sorter.add(entries, n);
+        }
+    });
+    if (sorter.spilled()) {
+        *queryErr << "ORDER BY: 정렬할 행이 메모리 한도를 넘어 정렬된 런을 임시 파일로 내보냈습니다 (" << sorter.spilledBytes() / (1 << 20)
+             << "MB).\n";
+    }
+    return sorter.finish(limit, visit);
+}
+
+// ---- 실행 계획과 PREPARE / EXECUTE ----
+
+// SELECT / INSERT / DELETE 문장을 테이블에 맞게 해석한 결과
+// PREPARE된 문장은 계획을 보관해 두고 EXECUTE 때 파싱, 카탈로그 조회, 조건 컴파일을 건너뜀
+struct QueryPlan;
+
+// SELECT 결과 행을 받는 쪽
+// 실행 함수 (runRows / runJoin / runAggregate)는 결과를 블록 단위로 넘기고, 텍스트로 쓸지 (TextResultSink)
+// API 커서가 행 번호를 모을지 (CursorSink)는 받는 쪽이 정함
+class ResultSink {
+public:
+    virtual ~ResultSink() = default;
+
+    // table의 rows[0..count) 행 (열은 plan.projection)
+    virtual void tableRows(const QueryPlan& plan, const TableData& table, const uint64_t* rows, size_t count) = 0;
+
+    // 조인 결과 행: 양쪽 테이블의 행 번호 rows[side][0..count) (열은 plan.join->columns로 찾음)
+    virtual void joinRows(const QueryPlan& plan, const uint64_t* const* rows, size_t count) = 0;
+
+    // 집계 결과 한 행: GROUP BY 열 값은 table의 groupRow 행, states[i]는 plan.items[i]의 집계 값
+    virtual void aggregateRow(const QueryPlan& plan, const TableData& table, size_t groupRow, const AggregateState* const* states) = 0;
+
+    // 결과를 다 받은 뒤에도 조인 결과를 모은 임시 테이블 (JoinPlan::joined)을 읽는지
+    virtual bool keepsJoinedRows() const { return false; }
+};
+
+struct QueryPlan {
+    uint64_t catalogVersion = 0;      // 해석할 때의 카탈로그 버전 (바뀌면 다시 해석)
+    TableData* table = nullptr;       // INSERT / DELETE / UPDATE는 원본 테이블, SELECT는 view
+    unique_ptr<TableData> view;       // SELECT가 읽는 스냅샷 뷰 (실행할 때마다 원본의 지금 내용으로 채움)
+    vector<int> projection;           // SELECT 출력 열 위치, UPDATE SET 열 위치
+    vector<vector<Condition>> groups; // WHERE 조건 (파라미터 자리는 바인딩 때 채움)
+    unique_ptr<RowFilter> filter;     // 컴파일된 WHERE
+    bool aggregate = false;           // 집계 함수나 GROUP BY가 있는 SELECT인지
+    vector<int> groupColumns;         // GROUP BY 열 위치
+    vector<AggregateSpec> items;      // SELECT 항목별 집계 (일반 열이면 None)
+    vector<string> labels;            // 결과 헤더
+    unique_ptr<JoinPlan> join;        // JOIN이 있으면 열 위치는 join->columns를 가리키고 table은 join->joined
+    vector<OrderKey> order;           // ORDER BY (비어 있으면 행 순서)
+    size_t limit = SIZE_MAX;          // LIMIT (없으면 SIZE_MAX)
+    QueryProfile* profile = nullptr;  // EXPLAIN ANALYZE로 실행할 때만
+    size_t rowsReturned = 0;          // 이번 실행의 결과 행 수 (결과 캐시 항목에 저장)
+    ResultSink* sink = nullptr;       // 결과를 받는 쪽 (없으면 queryOut에 텍스트로 씀)
+};
+
+// 결과 행 수를 통계에 더하는 함수 (EXPLAIN ANALYZE가 버리는 결과는 돌려준 행에 넣지 않음)
+void countReturned(QueryPlan& plan, size_t rows) {
+    if (plan.profile) {
+        plan.profile->rowsOut += rows;
+    } else {
+        plan.rowsReturned += rows;
+        ioStats.rowsReturned.fetch_add(rows, memory_order_relaxed);
+    }
+}
+
+// SELECT 목록과 GROUP BY를 해석하는 함수 (items가 비어 있지 않은 SELECT 목록)
+// lookup(name)은 table에서의 열 위치를 돌려주고, 없으면 오류를 출력한 뒤 -1
+bool resolveSelectList(const Statement& stmt, const vector<SelectItem>& items, const TableData& table,
+                       const function<int(const string&)>& lookup, QueryPlan& plan) {
+    plan.aggregate = !stmt.groupBy.empty();
+    for (const auto& column : stmt.groupBy) {
+        int columnIndex = lookup(column);
+        if (columnIndex < 0) return false;
+        plan.groupColumns.push_back(columnIndex);
+    }
+    for (const auto& item : items) {
+        int columnIndex = item.column.empty() ? -1 : lookup(item.column);
+        if (!item.column.empty() && columnIndex < 0) return false;
+        ColumnType type = columnIndex < 0 ? ColumnType::Int : table.columns[columnIndex].type;
+        if ((item.func == AggregateFunc::Sum || item.func == AggregateFunc::Avg) && type != ColumnType::Int &&
+            type != ColumnType::Float) {
+            *queryErr << "ERROR: " << selectItemLabel(item) << " 는 int 또는 float 컬럼에만 사용할 수 있습니다.\n";
+            return false;
+        }
+        if (item.func != AggregateFunc::None) plan.aggregate = true;
+        plan.projection.push_back(columnIndex);
+        plan.items.push_back({item.func, columnIndex});
+        plan.labels.push_back(selectItemLabel(item));
+    }
+    // 집계 쿼리의 일반 열은 GROUP BY에 있어야 함
+    for (size_t i = 0; plan.aggregate && i < items.size(); ++i) {
+        if (items[i].func == AggregateFunc::None &&
+            find(plan.groupColumns.begin(), plan.groupColumns.end(), plan.projection[i]) == plan.groupColumns.end()) {
+            *queryErr << "ERROR: " << items[i].column << " 컬럼은 GROUP BY 절에 있거나 집계 함수 안에 있어야 합니다.\n";
+            return false;
+        }
+    }
+
+    // ORDER BY: 일반 SELECT는 아무 열로나, 집계 SELECT는 SELECT 목록의 항목으로 정렬
+    plan.limit = stmt.limit < 0 ? SIZE_MAX : static_cast<size_t>(stmt.limit);
+    for (const auto& order : stmt.orderBy) {
+        int columnIndex = order.item.column.empty() ? -1 : lookup(order.item.column);
+        if (!order.item.column.empty() && columnIndex < 0) return false;
+        if (!plan.aggregate) {
+            if (order.item.func != AggregateFunc::None) {
+                *queryErr << "ERROR: " << selectItemLabel(order.item) << " 로 정렬하려면 SELECT 목록에 집계 함수가 있어야 합니다.\n";
+                return false;
+            }
+            plan.order.push_back({columnIndex, order.descending});
+            continue;
+        }
+        size_t item = 0;
+        while (item < plan.items.size() &&
+               !(plan.items[item].func == order.item.func && plan.items[item].columnIndex == columnIndex)) {
+            ++item;
+        }
+        if (item == plan.items.size()) {
+            *queryErr << "ERROR: ORDER BY " << selectItemLabel(order.item) << " 항목이 SELECT 목록에 없습니다.\n";
+            return false;
+        }
+        plan.order.push_back({static_cast<int>(item), order.descending});
+    }
+    return true;
+}
+
+// JOIN 쿼리의 열 이름("table.column", "alias.column", "column")을 찾는 함수 (없거나 모호하면 오류를 출력하고 false)
+// names는 양쪽 테이블을 가리키는 이름 (별칭이 있으면 별칭)
+bool findJoinColumn(const JoinPlan& join, const string names[2], const string& name, JoinColumnRef& ref) {
+    size_t dot = name.find('.');
+    if (dot != string::npos) {
+        string qualifier = name.substr(0, dot);
+        string column = name.substr(dot + 1);
+        for (int side = 0; side < 2; ++side) {
+            if (qualifier != names[side]) continue;
+            const TableSchema& schema = join.sides[side].table->schema;
+            ref = {side, findColumn(schema, column)};
+            if (ref.columnIndex >= 0) return true;
+            *queryErr << "ERROR: " << column << " 컬럼이 테이블 " << schema.tableName << "에 존재하지 않습니다.\n";
+            return false;
+        }
+        *queryErr << "ERROR: " << qualifier << " 은(는) FROM 절에 없는 테이블입니다.\n";
+        return false;
+    }
+
+    int found = 0;
+    for (int side = 0; side < 2; ++side) {
+        int columnIndex = findColumn(join.sides[side].table->schema, name);
+        if (columnIndex < 0) continue;
+        ref = {side, columnIndex};
+        ++found;
+    }
+    if (found == 1) return true;
+    if (found == 0) {
+        *queryErr << "ERROR: " << name << " 컬럼이 테이블 " << names[0] << ", " << names[1] << "에 존재하지 않습니다.\n";
+    } else {
+        *queryErr << "ERROR: " << name << " 컬럼이 두 테이블에 모두 있습니다. " << names[0] << "." << name << " 처럼 테이블 이름을 붙여주세요.\n";
+    }
+    return false;
+}
+
+// SELECT ... FROM a JOIN b ON a.x = b.y 문장을 해석하는 함수 (오류는 출력하고 false)
+// WHERE 조건은 열이 속한 테이블 쪽으로 내려 보내 조인 전에 거르고, 결과에 쓰는 열은 join->columns에 모음
+bool resolveJoinPlan(const Statement& stmt, QueryPlan& plan) {
+    auto& tables = databases[currentDatabase].tables;
+    unique_ptr<JoinPlan> join(new JoinPlan());
+    const string* tableNames[2] = {&stmt.tableName, &stmt.joinTable};
+    string names[2] = {stmt.tableAlias.empty() ? stmt.tableName : stmt.tableAlias,
+                       stmt.joinAlias.empty() ? stmt.joinTable : stmt.joinAlias};
+    for (int side = 0; side < 2; ++side) {
+        auto it = tables.find(*tableNames[side]);
+        if (it == tables.end()) {
+            *queryErr << "ERROR: " << *tableNames[side] << "이 데이터베이스 " << currentDatabase << "에 존재하지 않습니다.\n";
+            return false;
+        }
+        initView(it->second, join->views[side]);
+        join->sides[side].table = &join->views[side];
+    }
+    if (names[0] == names[1]) {
+        *queryErr << "ERROR: 같은 테이블을 JOIN하려면 서로 다른 별칭을 붙여주세요. (예: FROM " << stmt.tableName << " a JOIN "
+             << stmt.joinTable << " b)\n";
+        return false;
+    }
+
+    // ON 조건: 양쪽 테이블의 열을 하나씩 비교해야 함
+    JoinColumnRef keys[2];
+    if (!findJoinColumn(*join, names, stmt.joinLeft, keys[0]) || !findJoinColumn(*join, names, stmt.joinRight, keys[1])) return false;
+    if (keys[0].side == keys[1].side) {
+        *queryErr << "ERROR: ON 조건은 두 테이블의 열을 하나씩 비교해야 합니다.\n";
+        return false;
+    }
+    if (keys[0].side == 1) swap(keys[0], keys[1]);
+    ColumnType keyTypes[2];
+    for (int side = 0; side < 2; ++side) {
+        join->sides[side].keyColumn = keys[side].columnIndex;
+        keyTypes[side] = join->sides[side].table->columns[keys[side].columnIndex].type;
+    }
+    auto isNumber = [](ColumnType type) { return type == ColumnType::Int || type == ColumnType::Float; };
+    if (keyTypes[0] == keyTypes[1] && keyTypes[0] != ColumnType::Float) {
+        join->keyMode = keyTypes[0] == ColumnType::String ? JoinKeyMode::String : JoinKeyMode::Exact;
+    } else if (isNumber(keyTypes[0]) && isNumber(keyTypes[1])) {
+        join->keyMode = JoinKeyMode::Double;
+    } else {
+        *queryErr << "ERROR: JOIN 키 타입이 맞지 않습니다. (" << stmt.joinLeft << ": "
+             << join->sides[0].table->schema.columnTypes[keys[0].columnIndex] << ", " << stmt.joinRight << ": "
+             << join->sides[1].table->schema.columnTypes[keys[1].columnIndex] << ")\n";
+        return false;
+    }
+
+    // WHERE 절: 그룹(OR)마다 각 조건을 그 열의 테이블 쪽 그룹으로 나눔
+    size_t groupCount = max<size_t>(1, stmt.where.size());
+    if (groupCount > 64) {
+        *queryErr << "ERROR: JOIN의 WHERE 절에는 OR로 연결된 조건 묶음을 64개까지 쓸 수 있습니다.\n";
+        return false;
+    }
+    for (auto& side : join->sides) side.groups.assign(groupCount, {});
+    join->termSlots.assign(stmt.where.size(), {});
+    for (size_t g = 0; g < stmt.where.size(); ++g) {
+        for (const auto& term : stmt.where[g]) {
+            JoinColumnRef ref;
+            if (!findJoinColumn(*join, names, term.column, ref)) return false;
+            JoinSide& side = join->sides[ref.side];
+            join->termSlots[g].push_back({ref.side, static_cast<int>(side.groups[g].size())});
+            side.groups[g].push_back(makeCondition(*side.table, ref.columnIndex, term.op, term.value.text));
+        }
+    }
+    for (auto& side : join->sides) {
+        for (const auto& group : side.groups) {
+            side.filters.emplace_back(group.empty() ? nullptr : new RowFilter(*side.table, {group}));
+        }
+    }
+
+    // SELECT 목록: *이면 양쪽 테이블의 모든 열 (두 테이블에 같은 이름이 있으면 테이블 이름을 붙임)
+    vector<SelectItem> items = stmt.items;
+    if (items.empty()) {
+        for (int side = 0; side < 2; ++side) {
+            for (const auto& column : join->sides[side].table->schema.columns) {
+                bool shared = findColumn(join->sides[1 - side].table->schema, column) >= 0;
+                items.push_back({AggregateFunc::None, shared ? names[side] + "." + column : column});
+            }
+        }
+    }
+    TableData& joined = join->joined;
+    joined.schema.tableName = names[0] + "_" + names[1];
+    auto lookup = [&](const string& name) {
+        JoinColumnRef ref;
+        if (!findJoinColumn(*join, names, name, ref)) return -1;
+        for (size_t i = 0; i < join->columns.size(); ++i) {
+            if (join->columns[i].side == ref.side && join->columns[i].columnIndex == ref.columnIndex) return static_cast<int>(i);
+        }
+        const TableSchema& schema = join->sides[ref.side].table->schema;
+        join->columns.push_back(ref);
+        joined.schema.columns.push_back(names[ref.side] + "." + schema.columns[ref.columnIndex]);
+        joined.schema.columnTypes.push_back(schema.columnTypes[ref.columnIndex]);
+        joined.columns.emplace_back();
+        joined.columns.back().type = join->sides[ref.side].table->columns[ref.columnIndex].type;
+        return static_cast<int>(join->columns.size() - 1);
+    };
+    if (!resolveSelectList(stmt, items, joined, lookup, plan)) return false;
+
+    // 집계는 조인 결과를 임시 테이블에 모은 뒤 조건 없이 실행
+    plan.groups.clear();
+    plan.filter.reset(new RowFilter(joined, plan.groups));
+    plan.table = &joined;
+    plan.join = move(join);
+    plan.catalogVersion = catalogVersion;
+    return true;
+}
+
+// 문장을 현재 데이터베이스의 테이블에 맞게 해석하는 함수 (오류는 출력하고 false)
+bool resolvePlan(const Statement& stmt, QueryPlan& plan) {
+    if (currentDatabase.empty()) {
+        *queryErr << "데이터베이스 선택 후 진행해주세요. \n";
+        return false;
+    }
+
+    plan.projection.clear();
+    plan.groupColumns.clear();
+    plan.items.clear();
+    plan.labels.clear();
+    plan.aggregate = false;
+    plan.join.reset();
+    plan.view.reset();
+    plan.order.clear();
+    plan.limit = SIZE_MAX;
+    if (stmt.kind == StatementKind::Select && !stmt.joinTable.empty()) return resolveJoinPlan(stmt, plan);
+
+    auto& tables = databases[currentDatabase].tables;
+    auto it = tables.find(stmt.tableName);
+    if (it == tables.end()) {
+        if (stmt.kind == StatementKind::Select) {
+            *queryErr << "ERROR: " << stmt.tableName << "이 데이터베이스 " << currentDatabase << "에 존재하지 않습니다.\n";
+        } else if (stmt.kind == StatementKind::Delete || stmt.kind == StatementKind::Update) {
+            *queryErr << "ERROR: " << stmt.tableName << " 테이블이 존재하지 않습니다. 현재데이터베이스: " << currentDatabase << ".\n";
+        } else {
+            *queryErr << "ERROR: " << stmt.tableName << " 존재하지 않습니다. 현재 데이터베이스: " << currentDatabase << ".\n";
+        }
+        return false;
+    }
+    TableData* target = &it->second;
+    if (stmt.kind == StatementKind::Select) {
+        plan.view.reset(new TableData());
+        initView(it->second, *plan.view);
+        target = plan.view.get();
+    }
+    TableData& table = *target;
+
+    // WHERE 절 조건의 열 위치와 리터럴 변환
+    string missingColumn;
+    if (!resolveWhere(table, stmt.where, plan.groups, missingColumn)) {
+        if (stmt.kind == StatementKind::Delete || stmt.kind == StatementKind::Update) {
+            *queryErr << "ERROR: 테이블에 " << missingColumn << " 컬럼이 존재하지 않습니다. " << stmt.tableName << ".\n";
+        } else {
+            *queryErr << "ERROR: " << missingColumn << " 컬럼이 테이블 " << stmt.tableName << "에 존재하지 않습니다.\n";
+        }
+        return false;
+    }
+
+    // SELECT 목록 (비어 있으면 모든 열)과 GROUP BY
+    if (stmt.kind == StatementKind::Select) {
+        vector<SelectItem> items = stmt.items;
+        if (items.empty()) {
+            for (const auto& column : table.schema.columns) items.push_back({AggregateFunc::None, column});
+        }
+        auto lookup = [&](const string& name) {
+            int columnIndex = findColumn(table.schema, name);
+            if (columnIndex < 0) *queryErr << "ERROR: " << name << " 컬럼이 테이블 " << stmt.tableName << "에 존재하지 않습니다.\n";
+            return columnIndex;
+        };
+        if (!resolveSelectList(stmt, items, table, lookup, plan)) return false;
+    }
+
+    // UPDATE SET 열 (같은 열을 두 번 바꿀 수 없음)
+    if (stmt.kind == StatementKind::Update) {
+        for (const auto& column : stmt.columns) {
+            int columnIndex = findColumn(table.schema, column);
+            if (columnIndex < 0) {
+                *queryErr << "ERROR: 테이블에 " << column << " 컬럼이 존재하지 않습니다. " << stmt.tableName << ".\n";
+                return false;
+            }
+            if (find(plan.projection.begin(), plan.projection.end(), columnIndex) != plan.projection.end()) {
+                *queryErr << "ERROR: " << column << " 컬럼을 두 번 지정했습니다.\n";
+                return false;
+            }
+            plan.projection.push_back(columnIndex);
+        }
+    }
+
+    // 스캔한 행에서 읽는 열을 필터에 알려 둠 (버퍼 풀에 올릴 페이지): UPDATE는 새 버전에 모든 열을 복사
+    plan.filter.reset(new RowFilter(table, plan.groups));
+    if (stmt.kind == StatementKind::Update) {
+        for (size_t i = 0; i < table.columns.size(); ++i) plan.filter->addOutputColumn(static_cast<int>(i));
+    }
+    for (int column : plan.projection) {
+        if (column >= 0) plan.filter->addOutputColumn(column);
+    }
+    for (int column : plan.groupColumns) plan.filter->addOutputColumn(column);
+    if (!plan.aggregate) {
+        for (const auto& key : plan.order) plan.filter->addOutputColumn(key.index);
+    }
+    plan.table = &table;
+    plan.catalogVersion = catalogVersion;
+    return true;
+}
+
+// EXECUTE 파라미터 값을 WHERE 조건의 자리에 채우는 함수 (그 조건만 다시 컴파일)
+// 값이 열 타입으로 변환되지 않으면 INSERT와 같은 타입 오류를 쓰고 false (0행으로 실행하지 않음)
+bool bindParams(const Statement& stmt, QueryPlan& plan, const vector<string>& params) {
+    auto checkType = [&](const TableData& table, const Condition& cond, const WhereTerm& term) {
+        CompareOp op;
+        if (cond.valid || !parseCompareOp(term.op, op)) return true;
+        *queryErr << "Error: 데이터 타입이 일치하지 않습니다. 열: " << table.schema.columns[cond.columnIndex] << ", 예상 타입: "
+                  << table.schema.columnTypes[cond.columnIndex] << ", 제공된 값: " << params[term.value.param - 1]
+                  << ". 테이블: " << table.schema.tableName << ".\n";
+        return false;
+    };
+    for (size_t g = 0; g < stmt.where.size(); ++g) {
+        for (size_t t = 0; t < stmt.where[g].size(); ++t) {
+            const WhereTerm& term = stmt.where[g][t];
+            if (term.value.param == 0) continue;
+            if (plan.join) {
+                // JOIN이면 조건이 내려간 테이블 쪽 그룹에서 다시 컴파일
+                auto slot = plan.join->termSlots[g][t];
+                JoinSide& side = plan.join->sides[slot.first];
+                Condition& cond = side.groups[g][slot.second];
+                cond = makeCondition(*side.table, cond.columnIndex, term.op, params[term.value.param - 1]);
+                if (!checkType(*side.table, cond, term)) return false;
+                side.filters[g]->setPredicate(0, slot.second, compilePredicate(*side.table, cond));
+                continue;
+            }
+            Condition& cond = plan.groups[g][t];
+            cond = makeCondition(*plan.table, cond.columnIndex, term.op, params[term.value.param - 1]);
+            if (!checkType(*plan.table, cond, term)) return false;
+            plan.filter->setPredicate(g, t, compilePredicate(*plan.table, cond));
+        }
+    }
+    return true;
+}
+
+// 집계 결과 값 하나를 출력하는 함수 (값이 없는 SUM/AVG/MIN/MAX는 NULL)
+void writeAggregate(ostream& out, const TableData& table, const AggregateSpec& spec, const AggregateState& st) {
+    char buffer[32];
+    auto writeNumber = [&](auto value) {
+        auto result = to_chars(buffer, buffer + sizeof(buffer), value);
+        out.write(buffer, result.ptr - buffer);
+    };
+    if (spec.func == AggregateFunc::Count) {
+        writeNumber(st.count);
+        return;
+    }
+    if (st.count == 0) {
+        out << "NULL";
+        return;
+    }
+    const ColumnData& column = table.columns[spec.columnIndex];
+    switch (spec.func) {
+        case AggregateFunc::Sum:
+            if (column.type == ColumnType::Int) writeNumber(st.intSum);
+            else writeNumber(st.floatSum);
+            break;
+        case AggregateFunc::Avg:
+            writeNumber((column.type == ColumnType::Int ? static_cast<double>(st.intSum) : st.floatSum) / st.count);
+            break;
+        default:
+            writeCell(out, column, st.row);
+            break;
+    }
+}
+
+// 두 그룹의 집계 항목 값을 비교하는 함수 (a < b이면 음수, 같으면 0, 값이 없는 NULL이 가장 앞)
+int compareAggregate(const TableData& table, const AggregateSpec& spec, const AggregateHashTable& result, size_t a, size_t b,
+                     size_t item) {
+    if (spec.func == AggregateFunc::None) return compareCells(table.columns[spec.columnIndex], result.groupRow(a), result.groupRow(b));
+    const AggregateState& x = result.state(a, item);
+    const AggregateState& y = result.state(b, item);
+    auto compare = [](auto p, auto q) { return p < q ? -1 : q < p; };
+    if (spec.func == AggregateFunc::Count) return compare(x.count, y.count);
+    if (x.count == 0 || y.count == 0) return compare(x.count != 0, y.count != 0);
+    const ColumnData& column = table.columns[spec.columnIndex];
+    bool isInt = column.type == ColumnType::Int;
+    switch (spec.func) {
+        case AggregateFunc::Sum: return isInt ? compare(x.intSum, y.intSum) : compare(x.floatSum, y.floatSum);
+        case AggregateFunc::Avg:
+            return compare((isInt ? static_cast<double>(x.intSum) : x.floatSum) / x.count,
+                           (isInt ? static_cast<double>(y.intSum) : y.floatSum) / y.count);
+        default: return compareCells(column, x.row, y.row);
+    }
+}
+
+// 출력할 행들의 셀을 미리 캐시로 가져오는 함수 (정렬된 순서처럼 행 번호가 흩어져 있을 때)
+void prefetchCells(const TableData& table, const vector<int>& columns, const uint64_t* rows, size_t count) {
+    for (int columnIndex : columns) {
+        const ColumnData& column = table.columns[columnIndex];
+        for (size_t i = 0; i < count; ++i) {
+            switch (column.type) {
+                case ColumnType::Int: __builtin_prefetch(column.ints.data() + rows[i]); break;
+                case ColumnType::Float: __builtin_prefetch(column.floats.data() + rows[i]); break;
+                case ColumnType::Date: __builtin_prefetch(column.dates.data() + rows[i]); break;
+                case ColumnType::String:
+                    if (column.strings.encoded) __builtin_prefetch(column.strings.codes.data() + rows[i]);
+                    else __builtin_prefetch(column.strings.offsets.data() + rows[i]);
+                    break;
+            }
+        }
+    }
+}
+
+// 결과를 queryOut에 탭으로 나눈 텍스트로 쓰는 쪽 (REPL / 서버 응답 형식, 행마다 줄바꿈)
+// 받은 블록을 문자열 하나로 만든 뒤 한 번에 씀 (셀마다 스트림을 거치지 않음)
+class TextResultSink : public ResultSink {
+public:
+    void tableRows(const QueryPlan& plan, const TableData& table, const uint64_t* rows, size_t count) override {
+        if (!plan.order.empty()) prefetchCells(table, plan.projection, rows, count);
+        string& text = blockText();
+        for (size_t i = 0; i < count; ++i) {
+            for (int columnIndex : plan.projection) {
+                appendCell(text, table.columns[columnIndex], rows[i]);
+                text += '\t';
+            }
+            text += '\n';
+        }
+        queryOut->write(text.data(), static_cast<streamsize>(text.size()));
+    }
+
+    void joinRows(const QueryPlan& plan, const uint64_t* const* rows, size_t count) override {
+        const JoinPlan& join = *plan.join;
+        string& text = blockText();
+        for (size_t i = 0; i < count; ++i) {
+            for (int c : plan.projection) {
+                const JoinColumnRef& ref = join.columns[c];
+                appendCell(text, join.sides[ref.side].table->columns[ref.columnIndex], rows[ref.side][i]);
+                text += '\t';
+            }
+            text += '\n';
+        }
+        queryOut->write(text.data(), static_cast<streamsize>(text.size()));
+    }
+
+    void aggregateRow(const QueryPlan& plan, const TableData& table, size_t groupRow, const AggregateState* const* states) override {
+        for (size_t i = 0; i < plan.items.size(); ++i) {
+            const AggregateSpec& spec = plan.items[i];
+            if (spec.func == AggregateFunc::None) {
+                writeCell(*queryOut, table.columns[spec.columnIndex], groupRow);
+            } else {
+                writeAggregate(*queryOut, table, spec, *states[i]);
+            }
+            *queryOut << "\t";
+        }
+        *queryOut << "\n";
+    }
+
+private:
+    // 스레드마다 하나씩 두고 다시 쓰는 블록 문자열 (비운 상태로 돌려줌)
+    static string& blockText() {
+        thread_local string text;
+        text.clear();
+        return text;
+    }
+};
+
+TextResultSink textResultSink;
+
+ResultSink& resultSink(QueryPlan& plan) {
+    return plan.sink ? *plan.sink : textResultSink;
+}
+
+// 해시 집계 후 그룹마다 한 행씩 결과로 넘김
+// 그룹 순서는 ORDER BY가 없으면 그룹이 테이블에 처음 나타난 순서, LIMIT이 있으면 앞의 limit개만 정렬
+void runAggregate(QueryPlan& plan) {
+    TableData& table = *plan.table;
+    AggregateHashTable result(table, plan.groupColumns, plan.items);
+    {
+        StageTimer timer(plan.profile ? &plan.profile->aggregateNanos : nullptr);
+        aggregateTable(table, plan.groups, *plan.filter, result, plan.groupColumns, plan.items);
+    }
+    if (plan.profile) plan.profile->groups = result.groupCount();
+
+    vector<size_t> order(result.groupCount());
+    for (size_t g = 0; g < order.size(); ++g) order[g] = g;
+    auto before = [&](size_t a, size_t b) {
+        for (const auto& key : plan.order) {
+            int c = compareAggregate(table, plan.items[key.index], result, a, b, key.index);
+            if (c != 0) return key.descending ? c > 0 : c < 0;
+        }
+        return result.groupRow(a) < result.groupRow(b);
+    };
+    size_t count = min(plan.limit, order.size());
+    partial_sort(order.begin(), order.begin() + count, order.end(), before);
+
+    // GROUP BY가 없으면 행이 없어도 결과 한 행 (COUNT = 0)
+    if (plan.groupColumns.empty() && order.empty()) count = min<size_t>(plan.limit, 1);
+    ResultSink& sink = resultSink(plan);
+    AggregateState empty;
+    vector<const AggregateState*> states(plan.items.size(), &empty);
+    for (size_t g = 0; g < count; ++g) {
+        if (!order.empty()) {
+            for (size_t i = 0; i < plan.items.size(); ++i) states[i] = &result.state(order[g], i);
+        }
+        sink.aggregateRow(plan, table, order.empty() ? 0 : result.groupRow(order[g]), states.data());
+    }
+    countReturned(plan, count);
+}
+
+// plan.table에서 WHERE를 만족하는 행의 선택한 열을 결과로 넘김 (ORDER BY가 있으면 정렬해서, LIMIT개까지)
+void runRows(QueryPlan& plan) {
+    if (plan.aggregate) {
+        runAggregate(plan);
+        return;
+    }
+
+    TableData& table = *plan.table;
+    ResultSink& sink = resultSink(plan);
+    auto print = [&](const uint64_t* rows, size_t count) {
+        sink.tableRows(plan, table, rows, count);
+        countReturned(plan, count);
+    };
+    if (plan.order.empty()) {
+        scanTable(table, plan.groups, *plan.filter, print, plan.limit);
+    } else {
+        StageTimer timer(plan.profile ? &plan.profile->sortNanos : nullptr);
+        sortTable(table, plan.groups, *plan.filter, plan.order, plan.limit, print);
+    }
+}
+
+// 해시 조인 결과를 결과 받는 쪽에 넘기는 함수
+// 집계나 ORDER BY가 있으면 결과에 쓰는 열만 임시 테이블에 모은 뒤 그 테이블로 집계/정렬함
+void runJoin(QueryPlan& plan) {
+    JoinPlan& join = *plan.join;
+    if (plan.aggregate || !plan.order.empty()) {
+        TableData& joined = join.joined;
+        initColumns(joined, false);
+        bool ok;
+        {
+            StageTimer timer(plan.profile ? &plan.profile->joinNanos : nullptr);
+            ok = hashJoin(join, [&](const uint64_t* left, const uint64_t* right, size_t count) {
+                const uint64_t* rows[2] = {left, right};
+                for (size_t c = 0; c < join.columns.size(); ++c) {
+                    const JoinColumnRef& ref = join.columns[c];
+                    gatherColumn(joined.columns[c], join.sides[ref.side].table->columns[ref.columnIndex], rows[ref.side], count);
+                }
+                joined.rowCount += count;
+                return true;
+            }, plan.profile);
+        }
+        if (plan.profile) plan.profile->joinRows = joined.rowCount;
+        if (ok) runRows(plan);
+        if (!resultSink(plan).keepsJoinedRows()) initColumns(joined, false);
+        return;
+    }
+
+    // LIMIT을 채우면 조인을 멈춤
+    size_t remaining = plan.limit;
+    if (remaining == 0) return;
+    StageTimer timer(plan.profile ? &plan.profile->joinNanos : nullptr);
+    ResultSink& sink = resultSink(plan);
+    hashJoin(join, [&](const uint64_t* left, const uint64_t* right, size_t count) {
+        const uint64_t* rows[2] = {left, right};
+        count = min(count, remaining);
+        sink.joinRows(plan, rows, count);
+        remaining -= count;
+        countReturned(plan, count);
+        if (plan.profile) plan.profile->joinRows += count;
+        return remaining > 0;
+    }, plan.profile);
+}
+
+// 조건을 만족하는 행의 선택 벡터를 받아 선택한 열만 출력
+// SELECT 하나를 실행하는 동안 스냅샷을 잡고 뷰를 채워 두는 객체 (끝나면 뷰를 비움)
+// 실행 중에 들어온 INSERT / DELETE는 뷰가 보는 값을 바꾸지 않으므로 SELECT와 writer가 서로 기다리지 않음
+class ReadSnapshot {
+public:
+    explicit ReadSnapshot(QueryPlan& plan) : snapshot_(transactions.snapshot()) {
+        if (plan.join) {
+            for (auto& view : plan.join->views) views_.push_back(&view);
+        } else if (plan.view) {
+            views_.push_back(plan.view.get());
+        }
+        for (TableData* view : views_) refreshView(*view, &snapshot_);
+    }
+
+    ~ReadSnapshot() {
+        for (TableData* view : views_) releaseView(*view);
+    }
+
+private:
+    Snapshot snapshot_;
+    vector<TableData*> views_;
+};
+
+void runSelect(QueryPlan& plan) {
+    ReadSnapshot snapshot(plan);
+    for (const auto& label : plan.labels) {
+        *queryOut << label << "\t";
+    }
+    *queryOut << "\n";
+    if (plan.join) {
+        runJoin(plan);
+    } else {
+        runRows(plan);
+    }
+}
+
+// ---- EXPLAIN ----
+
+// 테이블 하나를 읽는 방법을 출력하는 함수
+// 인덱스로 처리할 조건이 있으면 인덱스 조회, 아니면 zone map으로 건너뛸 세그먼트 수와 함께 세그먼트 스캔
+// mayMatch(segment)는 세그먼트에 WHERE 절을 만족하는 행이 있을 수 있는지 (WHERE가 없으면 nullptr)
+// actual은 EXPLAIN ANALYZE가 줄 끝에 붙이는 실제 실행 값
+void explainScan(TableData& table, const string& name, const vector<vector<Condition>>& groups, bool useIndex,
+                 const function<bool(size_t)>& mayMatch, int depth, const string& actual = string()) {
+    string indent(depth * 2, ' ');
+    TableData& owner = table.source ? *table.source : table;
+    if (useIndex && groups.size() == 1) {
+        for (const auto& cond : groups.front()) {
+            TableIndex* index = findUsableIndex(owner, cond);
+            if (index == nullptr) continue;
+            *queryOut << indent << "Index Scan " << name << ": " << index->name << " ("
+                      << (index->kind == IndexKind::Hash ? "HASH" : "BTREE") << ", " << index->column << ")" << actual << "\n";
+            return;
+        }
+    }
+    size_t segments = (table.rowCount + kSegmentRows - 1) / kSegmentRows;
+    size_t pruned = 0;
+    if (mayMatch) {
+        for (size_t segment = 0; segment < segments; ++segment) pruned += !mayMatch(segment);
+    }
+    *queryOut << indent << "Seq Scan " << name << ": " << table.rowCount << "행, 세그먼트 " << segments << "개 중 "
+              << pruned << "개 건너뜀 (zone map)" << actual << "\n";
+}
+
+// EXPLAIN ANALYZE 줄 끝에 붙이는 " (실제: ..., X.XXX ms)"
+string actualText(const string& values, uint64_t nanos) {
+    char time[32];
+    snprintf(time, sizeof(time), "%.3f ms", nanos / 1e6);
+    return " (실제: " + values + ", " + time + ")";
+}
+
+// EXPLAIN [ANALYZE] SELECT ... 쿼리를 처리하는 함수: 계획만 출력
+// 위에서부터 마지막에 실행되는 단계 순서 (LIMIT, 정렬, 집계, 조인, 스캔)
+// ANALYZE면 결과를 버리면서 실제로 실행한 뒤 단계마다 실제 행 수와 시간을 붙임
+// 정렬 / 집계 시간은 함께 실행되는 스캔을 포함하고 (JOIN이면 조인이 끝난 뒤의 시간만), 스캔 시간은 스캔 스레드들의 시간을 더한 값
+void explainSelect(const Statement& stmt) {
+    const Statement& select = *stmt.body;
+    QueryPlan plan;
+    if (!resolvePlan(select, plan)) return;
+    ReadSnapshot snapshot(plan);
+
+    QueryProfile profile;
+    uint64_t totalNanos = 0;
+    if (stmt.analyze) {
+        plan.profile = &profile;
+        if (plan.filter) plan.filter->setProfiling(true);
+        ostream discard(nullptr);
+        ostream* out = queryOut;
+        queryOut = &discard;
+        auto start = chrono::steady_clock::now();
+        if (plan.join) {
+            runJoin(plan);
+        } else {
+            runRows(plan);
+        }
+        totalNanos = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        queryOut = out;
+    }
+    auto actual = [&](const string& values, uint64_t nanos) { return stmt.analyze ? actualText(values, nanos) : string(); };
+    auto rows = [](size_t count) { return "행 " + to_string(count) + "개"; };
+
+    *queryOut << "QUERY PLAN\n";
+    int depth = 0;
+    if (plan.limit != SIZE_MAX) {
+        *queryOut << "Limit: " << plan.limit << (stmt.analyze ? " (실제: " + rows(profile.rowsOut) + ")" : string()) << "\n";
+        ++depth;
+    }
+    if (!select.orderBy.empty()) {
+        *queryOut << string(depth * 2, ' ') << "Sort:";
+        for (size_t i = 0; i < select.orderBy.size(); ++i) {
+            *queryOut << (i > 0 ? ", " : " ") << selectItemLabel(select.orderBy[i].item) << (select.orderBy[i].descending ? " DESC" : "");
+        }
+        *queryOut << (plan.limit != SIZE_MAX ? " (상위 " + to_string(plan.limit) + "개 힙)" : string())
+                  << actual(rows(profile.rowsOut), plan.aggregate ? profile.aggregateNanos.load() : profile.sortNanos.load()) << "\n";
+        ++depth;
+    }
+    if (plan.aggregate) {
+        *queryOut << string(depth * 2, ' ') << "Hash Aggregate";
+        for (size_t i = 0; i < select.groupBy.size(); ++i) *queryOut << (i > 0 ? ", " : ": GROUP BY ") << select.groupBy[i];
+        *queryOut << actual("그룹 " + to_string(profile.groups) + "개", profile.aggregateNanos) << "\n";
+        ++depth;
+    }
+    if (!select.where.empty()) {
+        *queryOut << string(depth * 2, ' ') << "Filter: " << whereText(select.where);
+        if (stmt.analyze && !plan.join) *queryOut << " (실제: " << rows(plan.filter->counters().rowsMatched) << ")";
+        *queryOut << "\n";
+        ++depth;
+    }
+
+    if (plan.join) {
+        JoinPlan& join = *plan.join;
+        *queryOut << string(depth * 2, ' ') << "Hash Join: " << select.joinLeft << " = " << select.joinRight
+                  << actual(rows(profile.joinRows), profile.joinNanos) << "\n";
+        const string names[2] = {select.tableName, select.joinTable};
+        for (int side = 0; side < 2; ++side) {
+            const JoinSide& joinSide = join.sides[side];
+            bool filtered = false;
+            for (const auto& filter : joinSide.filters) filtered = filtered || filter != nullptr;
+            auto mayMatch = [&](size_t segment) {
+                for (const auto& filter : joinSide.filters) {
+                    if (!filter || filter->mayMatch(segment)) return true;
+                }
+                return false;
+            };
+            string sideActual;
+            if (stmt.analyze && profile.buildSide >= 0) {
+                sideActual = " (실제: 후보 " + rows(profile.joinCandidates[side]) + ", " + (side == profile.buildSide ? "빌드" : "프로브") + ")";
             }
+            explainScan(*joinSide.table, names[side], joinSide.groups, false,
+                        filtered ? function<bool(size_t)>(mayMatch) : nullptr, depth + 1, sideActual);
+        }
+    } else {
+        const RowFilter& filter = *plan.filter;
+        const RowFilter::Counters& counters = filter.counters();
+        string scanActual = actual("읽은 " + rows(counters.rowsRead) + ", 건너뛴 블록 " + to_string(counters.blocksSkipped) + "개",
+                                   counters.scanNanos);
+        explainScan(*plan.table, select.tableName, plan.groups, true,
+                    plan.groups.empty() ? nullptr : function<bool(size_t)>([&](size_t segment) { return filter.mayMatch(segment); }),
+                    depth, scanActual);
+    }
+    if (stmt.analyze) {
+        char time[32];
+        snprintf(time, sizeof(time), "%.3f ms", totalNanos / 1e6);
+        *queryOut << "결과 " << rows(profile.rowsOut) << ", 실행 시간: " << time << "\n";
+    }
+}
+
+// 모든 행을 먼저 검사하고, 하나라도 틀리면 아무 행도 추가하지 않음
+void runInsert(const Statement& stmt, QueryPlan& plan, const vector<string>& params) {
+    TableData& table = *plan.table;
+    RowBatch batch(table.schema);
+    vector<string_view> values;
+    string error;
+    for (const auto& row : stmt.rows) {
+        values.clear();
+        for (const auto& value : row) {
+            values.push_back(value.param > 0 ? string_view(params[value.param - 1]) : string_view(value.text));
+        }
+        if (!appendBatchRow(batch, table.schema, values, error)) {
+            if (stmt.rows.size() > 1) error = to_string(batch.rowCount + 1) + "번째 행: " + error;
+            *queryErr << "Error: " << error << ". 테이블: " << stmt.tableName << ".\n";
+            return;
+        }
+    }
+
+    size_t firstRow = table.rowCount;
+    WriteTransaction txn(table);
+    {
+        unique_lock<shared_mutex> latch(table.latch.mutex);
+        appendRows(table, batch.columns, batch.rowCount, txn.id);
+    }
+    ioStats.rowsWritten.fetch_add(batch.rowCount, memory_order_relaxed);
+    Database& db = databases[currentDatabase];
+    if (batch.rowCount == 1) {
+        logInsert(db, table, firstRow);
+        *queryOut << "Success: 데이터 삽입 성공 " << stmt.tableName << ", 데이터베이스: " << currentDatabase << "\n";
+    } else {
+        logInsertRows(db, table, firstRow, batch.rowCount);
+        *queryOut << "Success: 데이터 " << batch.rowCount << "행 삽입 성공 " << stmt.tableName << ", 데이터베이스: " << currentDatabase << "\n";
+    }
+}
+
+// 조건에 맞는 행을 삭제하고 WHERE 절을 로그에 기록
+void runDelete(const Statement& stmt, QueryPlan& plan, const vector<string>& params) {
+    string clause = whereText(stmt.where, params);
+    WriteTransaction txn(*plan.table);
+    size_t deleted = markDeleted(*plan.table, plan.groups, *plan.filter, txn.id);
+    if (deleted > 0) vacuumWorker.notify();
+    ioStats.rowsWritten.fetch_add(deleted, memory_order_relaxed);
+    logDelete(databases[currentDatabase], stmt.tableName, clause);
+
+    *queryOut << "Rows 삭제 완료 (" << deleted << "), from " << stmt.tableName << " where " << clause << " successfully in database " << currentDatabase << ".\n";
+}
+
+// 조건에 맞는 행을 SET 값으로 바꾼 새 버전을 테이블 끝에 추가하고 옛 버전은 지운 것으로 표시
+// 같은 트랜잭션이 두 가지를 모두 하므로 스냅샷은 옛 버전이나 새 버전 중 하나만 봄
+// 로그에는 DELETE와 같은 WHERE 레코드와 새 버전의 INSERT 레코드를 남김 (재실행하면 같은 순서가 됨)
+void runUpdate(const Statement& stmt, QueryPlan& plan, const vector<string>& params) {
+    TableData& table = *plan.table;
+
+    // SET 값을 열 타입 규칙으로 검사해 한 칸짜리 컬럼으로 변환
+    vector<ColumnData> values(plan.projection.size());
+    for (size_t i = 0; i < plan.projection.size(); ++i) {
+        int columnIndex = plan.projection[i];
+        const SqlValue& value = stmt.rows[0][i];
+        string_view text = value.param > 0 ? string_view(params[value.param - 1]) : string_view(value.text);
+        values[i].type = table.columns[columnIndex].type;
+        if (!isCheckedType(table.schema.columnTypes[columnIndex])) {
+            values[i].strings.push_back(text);
+        } else if (!appendCheckedValue(values[i], text)) {
+            *queryErr << "Error: 데이터 타입이 일치하지 않습니다. 열: " << table.schema.columns[columnIndex] << ", 예상 타입: "
+                      << table.schema.columnTypes[columnIndex] << ", 제공된 값: " << text << ". 테이블: " << stmt.tableName << ".\n";
+            return;
+        }
+    }
+
+    // 조건에 맞는 행을 찾아 SET 열만 바꾼 새 버전을 컬럼별로 모음
+    vector<uint64_t> matched;
+    scanTable(table, plan.groups, *plan.filter, [&](const uint64_t* rows, size_t count) {
+        matched.insert(matched.end(), rows, rows + count);
+    });
+    RowBatch batch(table.schema);
+    vector<uint64_t> repeat(matched.size(), 0);
+    for (size_t c = 0; c < table.columns.size(); ++c) {
+        auto set = find(plan.projection.begin(), plan.projection.end(), static_cast<int>(c));
+        if (set == plan.projection.end()) {
+            gatherColumn(batch.columns[c], table.columns[c], matched.data(), matched.size());
+        } else {
+            gatherColumn(batch.columns[c], values[set - plan.projection.begin()], repeat.data(), repeat.size());
+        }
+    }
+    batch.rowCount = matched.size();
+
+    string clause = whereText(stmt.where, params);
+    if (!matched.empty()) {
+        size_t firstRow = table.rowCount;
+        WriteTransaction txn(table);
+        markDeleted(table, matched, txn.id);
+        {
+            unique_lock<shared_mutex> latch(table.latch.mutex);
+            appendRows(table, batch.columns, batch.rowCount, txn.id);
+        }
+        Database& db = databases[currentDatabase];
+        logDelete(db, stmt.tableName, clause);
+        logInsertRows(db, table, firstRow, batch.rowCount);
+        vacuumWorker.notify();
+        ioStats.rowsWritten.fetch_add(matched.size(), memory_order_relaxed);
+    }
+
+    *queryOut << "Rows 수정 완료 (" << matched.size() << "), from " << stmt.tableName << " where " << clause << " successfully in database " << currentDatabase << ".\n";
+}
+
+// ---- SELECT 결과 캐시 ----
+// 같은 SELECT가 반복될 때 실행하지 않고 저장해 둔 출력 텍스트를 그대로 돌려줌 (SET RESULT_CACHE mb로 켬, 기본값은 꺼짐)
+// 키는 데이터베이스 이름과 토큰 사이 공백을 하나로 맞춘 문장, 항목마다 읽은 테이블의 변경 번호를 함께 저장해
+// 조회할 때 지금 번호와 다르면 (그 뒤에 쓰기 문장이 있었거나 테이블을 다시 만들었으면) 버림
+// 용량은 출력 텍스트 바이트 기준이고, 넘치면 가장 오래 쓰지 않은 항목부터 내림 (LRU)
+
+// 결과 캐시 크기 (MB)
+// 환경 변수 DBMS_RESULT_CACHE_MB로 지정할 수 있고, 없으면 0 (꺼짐)
+size_t defaultResultCacheMegabytes() {
+    const char* forced = getenv("DBMS_RESULT_CACHE_MB");
+    return forced != nullptr && atoll(forced) > 0 ? static_cast<size_t>(atoll(forced)) : 0;
+}
+
+class ResultCache {
+public:
+    struct Stats {
+        size_t capacity = 0; // 바이트
+        size_t bytes = 0;
+        size_t entries = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t invalidations = 0; // 테이블이 바뀌어 버린 항목 수
+    };
+
+    ResultCache() : capacity_(defaultResultCacheMegabytes() << 20) {}
+
+    bool enabled() const { return capacity_.load(memory_order_relaxed) > 0; }
+
+    // 항목 하나의 최대 출력 크기 (용량의 1/4, 이보다 큰 결과는 넣지 않음)
+    size_t entryLimit() const { return capacity_.load(memory_order_relaxed) / 4; }
+
+    // 키와 변경 번호가 모두 맞는 항목의 출력 (없으면 nullptr, 번호가 다른 항목은 지움)
+    shared_ptr<const string> lookup(const string& key, const vector<uint64_t>& stamps, size_t& rows) {
+        lock_guard<mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            ++misses_;
+            return nullptr;
+        }
+        if (it->second->stamps != stamps) {
+            ++misses_;
+            ++invalidations_;
+            erase(it->second);
+            return nullptr;
+        }
+        ++hits_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        rows = it->second->rows;
+        return it->second->output;
+    }
+
+    void insert(const string& key, vector<uint64_t> stamps, string output, size_t rows) {
+        lock_guard<mutex> lock(mutex_);
+        size_t bytes = entryBytes(key, output);
+        if (bytes > capacity_ / 4) return;
+        auto it = index_.find(key);
+        if (it != index_.end()) erase(it->second); // 같은 문장을 동시에 실행한 다른 세션이 먼저 넣은 항목
+        entries_.push_front(Entry{key, move(stamps), make_shared<const string>(move(output)), rows});
+        index_.emplace(entries_.front().key, entries_.begin());
+        bytes_ += bytes;
+        evictOverflow();
+    }
+
+    // SET RESULT_CACHE mb: 0이면 끄고 항목을 모두 지움, 줄이면 넘치는 항목을 바로 내림
+    void setCapacity(size_t bytes) {
+        lock_guard<mutex> lock(mutex_);
+        capacity_ = bytes;
+        evictOverflow();
+    }
+
+    Stats stats() const {
+        lock_guard<mutex> lock(mutex_);
+        return Stats{capacity_, bytes_, entries_.size(), hits_, misses_, evictions_, invalidations_};
+    }
+
+private:
+    struct Entry {
+        string key;
+        vector<uint64_t> stamps; // 문장이 읽는 테이블의 변경 번호 (FROM, JOIN 순서)
+        shared_ptr<const string> output;
+        size_t rows = 0;
+    };
+
+    static size_t entryBytes(const string& key, const string& output) { return key.size() + output.size() + sizeof(Entry); }
+
+    void erase(list<Entry>::iterator entry) {
+        bytes_ -= entryBytes(entry->key, *entry->output);
+        index_.erase(entry->key);
+        entries_.erase(entry);
+    }
+
+    // 가장 오래 쓰지 않은 (목록 끝) 항목부터 용량 안에 들어갈 때까지 내림
+    void evictOverflow() {
+        while (bytes_ > capacity_ && !entries_.empty()) {
+            erase(prev(entries_.end()));
+            ++evictions_;
+        }
+    }
+
+    mutable mutex mutex_;
+    list<Entry> entries_; // 앞쪽이 최근에 쓴 항목
+    unordered_map<string_view, list<Entry>::iterator> index_; // 키는 entries_ 항목의 key를 가리킴
+    atomic<size_t> capacity_;
+    size_t bytes_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+    uint64_t invalidations_ = 0;
+};
+
+ResultCache resultCache;
+
+// 받은 바이트를 원래 스트림에 그대로 넘기면서 limit 바이트까지 복사해 두는 출력 버퍼 (결과 캐시에 넣을 출력을 모음)
+// limit을 넘으면 모으기를 그만두고 complete()가 false
+class CaptureBuffer : public streambuf {
+public:
+    CaptureBuffer(ostream& target, size_t limit) : target_(target), limit_(limit) { setp(buffer_, buffer_ + sizeof(buffer_)); }
+
+    bool complete() const { return complete_; }
+    size_t written() const { return written_; }
+    string& captured() { return captured_; }
+
+protected:
+    int overflow(int c) override {
+        drain();
+        if (c == EOF) return 0;
+        *pptr() = static_cast<char>(c);
+        pbump(1);
+        return c;
+    }
+
+    int sync() override {
+        drain();
+        return 0;
+    }
+
+private:
+    // 버퍼에 쌓인 바이트를 원래 스트림에 쓰고 모아 둠
+    void drain() {
+        size_t count = static_cast<size_t>(pptr() - pbase());
+        if (count == 0) return;
+        target_.write(pbase(), static_cast<streamsize>(count));
+        written_ += count;
+        if (complete_ && captured_.size() + count <= limit_) {
+            captured_.append(pbase(), count);
+        } else if (complete_) {
+            complete_ = false;
+            string().swap(captured_);
+        }
+        setp(buffer_, buffer_ + sizeof(buffer_));
+    }
+
+    ostream& target_;
+    size_t limit_;
+    bool complete_ = true;
+    size_t written_ = 0;
+    string captured_;
+    char buffer_[1 << 14];
+};
+
+// SELECT가 읽는 테이블 (FROM, JOIN 순서)의 지금 변경 번호 (없는 테이블이 있으면 false, 실행하면서 오류를 출력)
+// 스냅샷을 잡기 전에 읽어야 그 뒤의 변경이 빠진 출력이 새 번호로 저장되지 않음
+bool readModificationStamps(const Statement& stmt, vector<uint64_t>& stamps) {
+    auto db = databases.find(currentDatabase);
+    if (db == databases.end()) return false;
+    for (const string* name : {&stmt.tableName, &stmt.joinTable}) {
+        if (name->empty()) continue;
+        auto it = db->second.tables.find(*name);
+        if (it == db->second.tables.end()) return false;
+        stamps.push_back(it->second.modification.load());
+    }
+    return true;
+}
+
+// INSERT INTO 쿼리를 처리하는 함수
+// INSERT INTO table_name v v ... 또는 INSERT INTO table_name VALUES (v, ...), (v, ...)
+void insertIntoTable(const Statement& stmt) {
+    QueryPlan plan;
+    if (resolvePlan(stmt, plan)) runInsert(stmt, plan, {});
+}
+
+// DELETE 쿼리를 처리하는 함수: DELETE FROM table_name WHERE ... (AND / OR 조합 가능)
+void deleteFromTable(const Statement& stmt) {
+    QueryPlan plan;
+    if (resolvePlan(stmt, plan)) runDelete(stmt, plan, {});
+}
+
+// UPDATE 쿼리를 처리하는 함수: UPDATE table_name SET column = value[, ...] WHERE ... (AND / OR 조합 가능)
+void updateTable(const Statement& stmt) {
+    QueryPlan plan;
+    if (resolvePlan(stmt, plan)) runUpdate(stmt, plan, {});
+}
+
+// SELECT 쿼리를 처리하는 함수 (WHERE 조건 및 여러 열 조회)
+// 결과 캐시를 켰으면 읽는 테이블의 변경 번호가 그대로인 같은 문장의 출력을 다시 쓰고, 아니면 실행하면서 출력을 모아 넣음
+void selectFromTable(const Statement& stmt) {
+    QueryPlan plan;
+    vector<uint64_t> stamps;
+    if (stmt.text.empty() || !readModificationStamps(stmt, stamps)) {
+        if (resolvePlan(stmt, plan)) runSelect(plan);
+        return;
+    }
+
+    string key = currentDatabase + '\n' + stmt.text;
+    size_t rows = 0;
+    if (shared_ptr<const string> output = resultCache.lookup(key, stamps, rows)) {
+        queryOut->write(output->data(), static_cast<streamsize>(output->size()));
+        ioStats.rowsReturned.fetch_add(rows, memory_order_relaxed);
+        return;
+    }
+
+    // 오류 메시지가 하나라도 나온 실행의 출력은 넣지 않음
+    ostream* out = queryOut;
+    ostream* err = queryErr;
+    CaptureBuffer captureOut(*out, resultCache.entryLimit());
+    CaptureBuffer captureErr(*err, 0);
+    ostream captureOutStream(&captureOut);
+    ostream captureErrStream(&captureErr);
+    captureOutStream.copyfmt(*out);
+    captureErrStream.copyfmt(*err);
+    queryOut = &captureOutStream;
+    queryErr = &captureErrStream;
+    bool ok = resolvePlan(stmt, plan);
+    if (ok) runSelect(plan);
+    captureOutStream.flush();
+    captureErrStream.flush();
+    queryOut = out;
+    queryErr = err;
+    if (ok && captureOut.complete() && captureErr.written() == 0) {
+        resultCache.insert(key, move(stamps), move(captureOut.captured()), plan.rowsReturned);
+    }
+}
+
+// PREPARE로 준비된 문장과 해석해 둔 계획
+struct PreparedStatement {
+    Statement statement;
+    QueryPlan plan;
+};
+
+thread_local unordered_map<string, PreparedStatement> preparedStatements; // 세션마다 따로
+
+// PREPARE name AS ... 쿼리를 처리하는 함수: 파싱된 문장을 보관 (계획은 처음 EXECUTE할 때 해석)
+void prepareStatement(const Statement& stmt) {
+    PreparedStatement& prepared = preparedStatements[stmt.name];
+    prepared.statement = *stmt.body;
+    prepared.plan = QueryPlan();
+    *queryOut << "Prepared: " << stmt.name << " 문장이 준비되었습니다. 파라미터 " << stmt.body->paramCount << "개.\n";
+}
+
+// EXECUTE name (v, ...) 쿼리를 처리하는 함수
+// 카탈로그가 바뀌지 않았으면 보관된 계획에 파라미터만 채워 바로 실행
+void executePrepared(const Statement& stmt) {
+    auto it = preparedStatements.find(stmt.name);
+    if (it == preparedStatements.end()) {
+        *queryErr << "ERROR: " << stmt.name << " 준비된 문장이 존재하지 않습니다.\n";
+        return;
+    }
+
+    const Statement& body = it->second.statement;
+    QueryPlan& plan = it->second.plan;
+    if (static_cast<int>(stmt.params.size()) != body.paramCount) {
+        *queryErr << "ERROR: 파라미터 개수가 맞지 않습니다. 필요: " << body.paramCount << "개, 입력: " << stmt.params.size() << "개.\n";
+        return;
+    }
+    if (plan.catalogVersion != catalogVersion && !resolvePlan(body, plan)) {
+        return;
+    }
+    if (!bindParams(body, plan, stmt.params)) {
+        return;
+    }
+
+    switch (body.kind) {
+        case StatementKind::Select: runSelect(plan); break;
+        case StatementKind::Insert: runInsert(body, plan, stmt.params); break;
+        case StatementKind::Delete: runDelete(body, plan, stmt.params); break;
+        case StatementKind::Update: runUpdate(body, plan, stmt.params); break;
+        default: break;
+    }
+}
+
+// DEALLOCATE name 쿼리를 처리하는 함수
+void deallocateStatement(const Statement& stmt) {
+    if (preparedStatements.erase(stmt.name) == 0) {
+        *queryErr << "ERROR: " << stmt.name << " 준비된 문장이 존재하지 않습니다.\n";
+        return;
+    }
+    *queryOut << "Deallocated: " << stmt.name << " 문장을 삭제했습니다.\n";
+}
+
+// COMMIT 쿼리를 처리하는 함수: 커밋 레코드를 붙이고 그룹 커밋 스레드가 로그를 fsync할 때까지 기다림
+// 비동기 모드면 기다리지 않고 바로 완료를 알림
+void commitDatabase() {
+    if (currentDatabase.empty()) {
+        *queryErr << "데이터베이스 선택 후 진행해주세요. \n";
+        return;
+    }
+
+    Database& db = databases[currentDatabase];
+    uint64_t lsn;
+    {
+        lock_guard<mutex> lock(db.walLock.mutex);
+        lsn = ++db.lastLsn;
+        string payload;
+        putU64(payload, lsn);
+        appendWalRecord(db, WalRecordType::Commit, payload);
+    }
+    future<bool> durable = commitFlusher.enqueue(db, lsn);
+    string filename = walFilename(currentDatabase);
+    if (asyncCommit.load()) {
+        *queryOut << "Database " << currentDatabase << " committed 완료 (비동기), " << filename << " 파일에는 곧 저장됩니다. \n";
+    } else if (!durable.get()) {
+        *queryErr << "Error: " << filename << "파일을 쓰는데 실패했습니다. \n";
+        return;
+    } else {
+        *queryOut << "Database " << currentDatabase << " committed 완료, " << filename << " 파일에 쓰기 및 저장 완료되었습니다. \n";
+    }
+
+    // 로그가 충분히 커지면 모든 writer를 (주소 순서로) 막고 .mydb 파일에 합침
+    {
+        lock_guard<mutex> lock(db.walLock.mutex);
+        if (db.walSize < kCheckpointThreshold) return;
+    }
+    vector<TableData*> tables;
+    for (auto& entry : db.tables) tables.push_back(&entry.second);
+    sort(tables.begin(), tables.end());
+    vector<unique_lock<mutex>> writers;
+    for (TableData* table : tables) writers.emplace_back(table->writeLock.mutex);
+    lock_guard<mutex> lock(db.walLock.mutex);
+    if (db.walSize >= kCheckpointThreshold && !checkpointDatabase(db)) {
+        *queryErr << "Error: " << currentDatabase << " 체크포인트에 실패했습니다. \n";
+    }
+}
+
+// CHECKPOINT 쿼리를 처리하는 함수: 커밋 후 로그를 .mydb 파일에 합침
+void checkpointCurrentDatabase() {
+    if (currentDatabase.empty()) {
+        *queryErr << "데이터베이스 선택 후 진행해주세요. \n";
+        return;
+    }
 
-            if (!row.empty() && row.size() == currentSchema.columns.size()) {
-                db.tables[currentTableName].rows.push_back(row);
-            }
+    commitDatabase();
+    Database& db = databases[currentDatabase];
+    lock_guard<mutex> lock(db.walLock.mutex);
+    if (!checkpointDatabase(db)) {
+        *queryErr << "Error: " << currentDatabase << " 체크포인트에 실패했습니다. \n";
+        return;
+    }
+    *queryOut << "Database " << currentDatabase << " 체크포인트 완료, " << currentDatabase << ".mydb 파일에 반영되었습니다. \n";
+}
+
+// SET THREADS n 쿼리를 처리하는 함수: 스캔에 쓸 스레드 수 지정 (1이면 단일 스레드)
+// SET JOIN_MEMORY n / SET SORT_MEMORY n 쿼리: JOIN / ORDER BY에 쓸 메모리 한도를 MB 단위로 지정 (넘으면 임시 파일을 씀)
+// SET COMMIT_MODE / COMMIT_DELAY / COMMIT_BATCH 쿼리: 그룹 커밋의 동기 / 비동기 모드, 최대 지연 시간(us), 배치 크기
+// SET RESULT_CACHE n 쿼리: SELECT 결과 캐시 크기를 MB 단위로 지정 (0이면 끔)
+void setOption(const Statement& stmt) {
+    int64_t value = 0;
+    double ratio = 0;
+    if (strcasecmp(stmt.name.c_str(), "THREADS") == 0 && parseInt(stmt.value, value) && value >= 1 && value <= 1024) {
+        scanThreads = static_cast<size_t>(value);
+        *queryOut << "스캔 스레드 수가 " << scanThreads << "(으)로 설정되었습니다.\n";
+    } else if (strcasecmp(stmt.name.c_str(), "JOIN_MEMORY") == 0 && parseInt(stmt.value, value) && value >= 1 && value <= 1048576) {
+        joinMemoryBudget = static_cast<size_t>(value) << 20;
+        *queryOut << "JOIN 메모리 한도가 " << value << "MB로 설정되었습니다.\n";
+    } else if (strcasecmp(stmt.name.c_str(), "SORT_MEMORY") == 0 && parseInt(stmt.value, value) && value >= 1 && value <= 1048576) {
+        sortMemoryBudget = static_cast<size_t>(value) << 20;
+        *queryOut << "정렬 메모리 한도가 " << value << "MB로 설정되었습니다.\n";
+    } else if (strcasecmp(stmt.name.c_str(), "VACUUM_RATIO") == 0 && parseFloat(stmt.value, ratio) && ratio > 0 && ratio <= 1) {
+        vacuumRatio = ratio;
+        *queryOut << "지운 행이 " << ratio * 100 << "% 이상인 테이블을 정리하도록 설정되었습니다.\n";
+        vacuumWorker.notify();
+    } else if (strcasecmp(stmt.name.c_str(), "BUFFER_POOL") == 0 && parseInt(stmt.value, value) && value >= 1 && value <= 1048576) {
+        bufferPool.setCapacity(static_cast<size_t>(value) * ((1 << 20) / kPageBytes));
+        *queryOut << "버퍼 풀 크기가 " << value << "MB로 설정되었습니다.\n";
+    } else if (strcasecmp(stmt.name.c_str(), "COMMIT_MODE") == 0 &&
+               (strcasecmp(stmt.value.c_str(), "SYNC") == 0 || strcasecmp(stmt.value.c_str(), "ASYNC") == 0)) {
+        asyncCommit = strcasecmp(stmt.value.c_str(), "ASYNC") == 0;
+        *queryOut << "COMMIT이 " << (asyncCommit ? "로그를 fsync하기 전에" : "로그를 fsync한 뒤에") << " 완료되도록 설정되었습니다.\n";
+    } else if (strcasecmp(stmt.name.c_str(), "COMMIT_DELAY") == 0 && parseInt(stmt.value, value) && value >= 0 && value <= 1000000) {
+        commitDelayMicros = static_cast<uint64_t>(value);
+        *queryOut << "그룹 커밋 최대 지연 시간이 " << value << "us로 설정되었습니다.\n";
+    } else if (strcasecmp(stmt.name.c_str(), "COMMIT_BATCH") == 0 && parseInt(stmt.value, value) && value >= 1 && value <= 1000000) {
+        commitBatchLimit = static_cast<size_t>(value);
+        *queryOut << "그룹 커밋 배치 크기가 " << value << "(으)로 설정되었습니다.\n";
+    } else if (strcasecmp(stmt.name.c_str(), "RESULT_CACHE") == 0 && parseInt(stmt.value, value) && value >= 0 && value <= 1048576) {
+        resultCache.setCapacity(static_cast<size_t>(value) << 20);
+        if (value == 0) {
+            *queryOut << "SELECT 결과 캐시를 껐습니다.\n";
+        } else {
+            *queryOut << "SELECT 결과 캐시 크기가 " << value << "MB로 설정되었습니다.\n";
         }
+    } else {
+        *queryErr << "Invalid SET query syntax. Use SET THREADS n; (1 ~ 1024) or SET JOIN_MEMORY mb; / SET SORT_MEMORY mb; / SET BUFFER_POOL mb;"
+                     " (1 ~ 1048576) or SET VACUUM_RATIO r; (0 < r <= 1) or SET COMMIT_MODE SYNC | ASYNC; / SET COMMIT_DELAY us;"
+                     " (0 ~ 1000000) / SET COMMIT_BATCH n; (1 ~ 1000000) or SET RESULT_CACHE mb; (0 ~ 1048576)\n";
     }
+}
 
-    databases[dbName] = db;
-    currentDatabase = dbName;
-    cout << "Database " << dbName << "로드 완료. \n";
+// SHOW BUFFER_POOL: 버퍼 풀 크기와 사용량, hit / miss / eviction 수, dirty 페이지 수를 출력
+// dirty 페이지는 로드된 모든 데이터베이스에서 파일에 아직 쓰지 않아 메모리에만 있는 테이블 데이터 (체크포인트가 파일에 씀)
+void showBufferPool() {
+    BufferPool::Stats stats = bufferPool.stats();
+    size_t dirtyBytes = 0;
+    for (const auto& dbPair : databases) {
+        for (const auto& tablePair : dbPair.second.tables) {
+            for (const auto& column : tablePair.second.columns) dirtyBytes += columnDirtyBytes(column);
+        }
+    }
+    uint64_t lookups = stats.hits + stats.misses;
+    char hitRatio[32];
+    snprintf(hitRatio, sizeof(hitRatio), "%.3f", lookups == 0 ? 0.0 : double(stats.hits) / lookups);
+    *queryOut << "capacity_mb\tcapacity_pages\tresident_pages\thits\tmisses\thit_ratio\tevictions\tdirty_pages\t\n"
+              << stats.capacity * kPageBytes / (1 << 20) << "\t" << stats.capacity << "\t" << stats.resident << "\t" << stats.hits
+              << "\t" << stats.misses << "\t" << hitRatio << "\t" << stats.evictions << "\t" << (dirtyBytes + kPageBytes - 1) / kPageBytes
+              << "\t\n";
 }
 
-// USE DATABASE 쿼리를 처리하는 함수
-void useDatabase(const string& query) {
-    istringstream ss(query);
-    string token;
-    ss >> token; // 'USE'
+// SHOW RESULT_CACHE: SELECT 결과 캐시 크기와 사용량, hit / miss / eviction 수, 테이블이 바뀌어 버린 항목 수를 출력
+void showResultCache() {
+    ResultCache::Stats stats = resultCache.stats();
+    uint64_t lookups = stats.hits + stats.misses;
+    char hitRatio[32];
+    snprintf(hitRatio, sizeof(hitRatio), "%.3f", lookups == 0 ? 0.0 : double(stats.hits) / lookups);
+    *queryOut << "capacity_mb\tentries\tbytes\thits\tmisses\thit_ratio\tevictions\tinvalidations\t\n"
+              << (stats.capacity >> 20) << "\t" << stats.entries << "\t" << stats.bytes << "\t" << stats.hits << "\t" << stats.misses
+              << "\t" << hitRatio << "\t" << stats.evictions << "\t" << stats.invalidations << "\t\n";
+}
 
-    string dbName;
-    ss >> dbName; // 데이터베이스 이름
+// 테이블 하나가 차지하는 메모리 (SHOW STATS)
+// memory는 메모리에만 있는 배열 (새로 쓴 행, 행 버전, 바뀐 인덱스 순서), mapped는 .mydb 파일 매핑을 그대로 읽는 배열
+struct TableMemory {
+    size_t memoryBytes = 0;
+    size_t mappedBytes = 0;
+};
 
-    if (databases.find(dbName) != databases.end()) {
-        // 이미 메모리에 로드된 데이터베이스 사용
-        currentDatabase = dbName;
-        cout << "Database: " << dbName << "를 사용합니다. \n";
-    } else {
-        // 파일에서 데이터베이스 로드 시도
-        loadDatabase(dbName);
+TableMemory tableMemory(const TableData& table) {
+    TableMemory memory;
+    for (const auto& column : table.columns) {
+        memory.memoryBytes += columnDirtyBytes(column);
+        memory.mappedBytes += columnMappedBytes(column);
+    }
+    for (const ColumnArray<uint64_t>* array : {&table.versions.createdBy, &table.versions.deletedBy}) {
+        memory.memoryBytes += array->dirtyBytes();
+        memory.mappedBytes += array->mappedBytes();
+    }
+    for (const auto& index : table.indexes) {
+        memory.memoryBytes += index.persistedOrder.dirtyBytes();
+        memory.mappedBytes += index.persistedOrder.mappedBytes();
     }
+    return memory;
 }
 
-// CREATE TABLE 쿼리를 처리하는 함수
-void createTable(const string& query) {
-    if (currentDatabase.empty()) {
-        cerr << "데이터베이스 선택 후 진행해주세요. \n";
-        return;
+// JSON 문자열 값으로 쓰는 함수 (따옴표, 역슬래시, 제어 문자만 이스케이프)
+void writeJsonString(ostream& out, const string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
     }
+    out << '"';
+}
 
-    istringstream ss(query);
-    string token;
-    ss >> token; // 'CREATE'
-    ss >> token; // 'TABLE'
+// 마이크로초를 소수점 셋째 자리까지의 ms 문자열로 바꾸는 함수
+string formatMillis(double micros) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.3f", micros / 1000);
+    return text;
+}
 
-    TableSchema schema;
-    ss >> schema.tableName; // 테이블 이름
-
-    string columnDef;
-    while (ss >> columnDef) {
-        size_t typeStart = columnDef.find('(');
-        size_t typeEnd = columnDef.find(')');
-        if (typeStart != string::npos && typeEnd != string::npos && typeEnd > typeStart + 1) {
-            string columnType = columnDef.substr(typeStart + 1, typeEnd - typeStart - 1); // 데이터 타입
-            string columnName = columnDef.substr(typeEnd + 1);  // 데이터 타입 이후의 열 이름
-            
-            // 공백 제거
-            cout << "공백 제거 전 이름: " << columnName << " 타입: " << columnType << endl;
-            columnName.erase(remove(columnName.begin(), columnName.end(), ','), columnName.end());
-            columnType.erase(remove(columnType.begin(), columnType.end(), ' '), columnType.end());
-            cout << "공백 제거 후 이름: " << columnName << " 타입: " << columnType << endl;
-            
-            schema.columns.push_back(columnName);
-            schema.columnTypes.push_back(columnType);
+// SHOW STATS [JSON]: 프로세스가 시작된 뒤의 실행 통계를 출력
+// 문장 종류별 지연 시간 히스토그램, 읽은 / 돌려준 / 쓴 행 수와 COMMIT한 로그 바이트 수, 로드된 테이블별 메모리
+// JSON이면 같은 내용을 JSON 객체 하나로 (다른 프로그램이 읽을 수 있게), 아니면 표 세 개를 빈 줄로 나눠 출력
+void showStats(bool json) {
+    ostream& out = *queryOut;
+    if (json) {
+        out << "{\"latency_bounds_ms\":[";
+        for (size_t b = 0; b + 1 < kLatencyBuckets; ++b) out << (b > 0 ? "," : "") << kLatencyBoundsMs[b];
+        out << "],\"statements\":[";
+    } else {
+        out << "statement\tcount\tavg_ms\tmax_ms\t";
+        for (size_t b = 0; b + 1 < kLatencyBuckets; ++b) out << "le_" << kLatencyBoundsMs[b] << "ms\t";
+        out << "gt_" << kLatencyBoundsMs[kLatencyBuckets - 2] << "ms\t\n";
+    }
+    bool first = true;
+    for (size_t kind = 0; kind < kStatementKinds; ++kind) {
+        const LatencyHistogram& histogram = statementLatency[kind];
+        uint64_t count = histogram.count.load(memory_order_relaxed);
+        if (count == 0) continue;
+        string name = statementKindName(static_cast<StatementKind>(kind));
+        string average = formatMillis(double(histogram.totalMicros.load(memory_order_relaxed)) / count);
+        string maximum = formatMillis(double(histogram.maxMicros.load(memory_order_relaxed)));
+        if (json) {
+            out << (first ? "" : ",") << "{\"statement\":";
+            writeJsonString(out, name);
+            out << ",\"count\":" << count << ",\"avg_ms\":" << average << ",\"max_ms\":" << maximum << ",\"buckets\":[";
+            for (size_t b = 0; b < kLatencyBuckets; ++b) out << (b > 0 ? "," : "") << histogram.buckets[b].load(memory_order_relaxed);
+            out << "]}";
         } else {
-            cerr << "ERROR: 잘못된 테이블 정의입니다. 형식은 다음과 같아야 합니다: (type)column_name\n";
-            return;
+            out << name << "\t" << count << "\t" << average << "\t" << maximum << "\t";
+            for (size_t b = 0; b < kLatencyBuckets; ++b) out << histogram.buckets[b].load(memory_order_relaxed) << "\t";
+            out << "\n";
         }
+        first = false;
     }
 
-    // 테이블을 데이터베이스에 추가
-    TableData table;
-    table.schema = schema;
-    databases[currentDatabase].tables[schema.tableName] = table;
+    uint64_t rowsRead = ioStats.rowsRead.load(memory_order_relaxed);
+    uint64_t rowsReturned = ioStats.rowsReturned.load(memory_order_relaxed);
+    uint64_t rowsWritten = ioStats.rowsWritten.load(memory_order_relaxed);
+    uint64_t bytesCommitted = ioStats.bytesCommitted.load(memory_order_relaxed);
+    uint64_t commitBatches = commitFlusher.batches();
+    uint64_t commits = commitFlusher.commits();
+    if (json) {
+        out << "],\"io\":{\"rows_read\":" << rowsRead << ",\"rows_returned\":" << rowsReturned << ",\"rows_written\":" << rowsWritten
+            << ",\"bytes_committed\":" << bytesCommitted << ",\"commit_batches\":" << commitBatches << ",\"batched_commits\":" << commits
+            << "},\"tables\":[";
+    } else {
+        out << "\nrows_read\trows_returned\trows_written\tbytes_committed\tcommit_batches\tbatched_commits\t\n"
+            << rowsRead << "\t" << rowsReturned << "\t" << rowsWritten << "\t" << bytesCommitted << "\t" << commitBatches << "\t" << commits
+            << "\t\n"
+            << "\ndatabase\ttable\trows\tdeleted_rows\tmemory_bytes\tmapped_bytes\t\n";
+    }
 
-    cout << "Table: " << schema.tableName << " 테이블 생성이 완료되었습니다. 현재 데이터베이스: " << currentDatabase << ".\n";
+    // 데이터베이스와 테이블 이름 순서
+    vector<pair<string, const Database*>> sortedDatabases;
+    for (const auto& dbPair : databases) sortedDatabases.emplace_back(dbPair.first, &dbPair.second);
+    sort(sortedDatabases.begin(), sortedDatabases.end());
+    first = true;
+    for (const auto& dbPair : sortedDatabases) {
+        vector<pair<string, const TableData*>> sortedTables;
+        for (const auto& tablePair : dbPair.second->tables) sortedTables.emplace_back(tablePair.first, &tablePair.second);
+        sort(sortedTables.begin(), sortedTables.end());
+        for (const auto& tablePair : sortedTables) {
+            const TableData& table = *tablePair.second;
+            TableMemory memory = tableMemory(table);
+            if (json) {
+                out << (first ? "" : ",") << "{\"database\":";
+                writeJsonString(out, dbPair.first);
+                out << ",\"table\":";
+                writeJsonString(out, tablePair.first);
+                out << ",\"rows\":" << table.rowCount << ",\"deleted_rows\":" << table.versions.deletedRows << ",\"memory_bytes\":"
+                    << memory.memoryBytes << ",\"mapped_bytes\":" << memory.mappedBytes << "}";
+            } else {
+                out << dbPair.first << "\t" << tablePair.first << "\t" << table.rowCount << "\t" << table.versions.deletedRows << "\t"
+                    << memory.memoryBytes << "\t" << memory.mappedBytes << "\t\n";
+            }
+            first = false;
+        }
+    }
+    if (json) out << "]}\n";
 }
 
-// INSERT INTO 쿼리를 처리하는 함수
-void insertIntoTable(const string& query) {
-    if (currentDatabase.empty()) {
-        cerr << "데이터베이스 선택 후 진행해주세요. \n";
-        return;
+// SHOW 쿼리를 처리하는 함수: SHOW BUFFER_POOL; / SHOW STATS [JSON];
+void showInfo(const Statement& stmt) {
+    bool json = strcasecmp(stmt.value.c_str(), "JSON") == 0;
+    if (strcasecmp(stmt.name.c_str(), "BUFFER_POOL") == 0 && stmt.value.empty()) {
+        showBufferPool();
+    } else if (strcasecmp(stmt.name.c_str(), "RESULT_CACHE") == 0 && stmt.value.empty()) {
+        showResultCache();
+    } else if (strcasecmp(stmt.name.c_str(), "STATS") == 0 && (stmt.value.empty() || json)) {
+        showStats(json);
+    } else {
+        *queryErr << "Invalid SHOW query syntax. Use SHOW BUFFER_POOL; / SHOW RESULT_CACHE; or SHOW STATS [JSON];\n";
     }
+}
+
+// 문장을 실행하는 동안 잡아 두는 카탈로그 / 테이블 잠금
+// CREATE, USE, SET, CHECKPOINT은 카탈로그를 배타적으로 잡아 다른 쿼리가 모두 끝난 뒤 혼자 실행하고,
+// 나머지는 카탈로그를 공유로 잡은 뒤 SELECT는 읽는 테이블의 layoutLock을 공유로 (vacuum만 막음),
+// INSERT / DELETE / COPY는 쓰는 테이블의 writeLock을 잡고, COMMIT은 테이블을 잡지 않음 (그룹 커밋을 기다리는 동안 writer를 막지 않음)
+// SELECT는 스냅샷 뷰를 읽으므로 writer와 서로 기다리지 않고, 같은 테이블의 writer는 한 번에 하나씩 실행됨
+// 테이블 여러 개는 항상 주소 순서로 잡으므로 교착 상태가 생기지 않음
+class StatementLocks {
+public:
+    explicit StatementLocks(const Statement& stmt) {
+        const Statement* target = &stmt;
+        if (stmt.kind == StatementKind::Execute) {
+            auto it = preparedStatements.find(stmt.name);
+            if (it == preparedStatements.end()) return;
+            target = &it->second.statement;
+        } else if (stmt.kind == StatementKind::Explain) {
+            target = stmt.body.get();
+        }
 
-    istringstream ss(query);
-    string token;
-    ss >> token; // 'INSERT'
-    ss >> token; // 'INTO'
+        switch (target->kind) {
+            case StatementKind::Prepare:
+            case StatementKind::Deallocate:
+                return; // 세션 안의 상태만 바꿈
+            case StatementKind::Select:
+                catalogShared_ = shared_lock<shared_mutex>(catalogMutex);
+                for (TableData* table : findTables({&target->tableName, &target->joinTable})) {
+                    readers_.emplace_back(table->layoutLock.mutex);
+                }
+                return;
+            case StatementKind::Insert:
+            case StatementKind::Delete:
+            case StatementKind::Update:
+            case StatementKind::Copy:
+                catalogShared_ = shared_lock<shared_mutex>(catalogMutex);
+                for (TableData* table : findTables({&target->tableName})) writers_.emplace_back(table->writeLock.mutex);
+                return;
+            case StatementKind::Commit:
+                // 로그만 쓰므로 테이블은 잡지 않음 (체크포인트할 때만 commitDatabase가 모든 writer를 막음)
+                catalogShared_ = shared_lock<shared_mutex>(catalogMutex);
+                return;
+            default:
+                catalogExclusive_ = unique_lock<shared_mutex>(catalogMutex);
+                return;
+        }
+    }
 
-    string tableName;
-    ss >> tableName; // 테이블 이름
+private:
+    // 현재 데이터베이스에서 이름이 주어진 테이블을 주소 순서로 찾는 함수
+    // 존재하지 않는 테이블은 건너뜀 (실행하면서 오류를 출력)
+    static vector<TableData*> findTables(initializer_list<const string*> names) {
+        vector<TableData*> tables;
+        auto db = databases.find(currentDatabase);
+        if (db == databases.end()) return tables;
+        for (const string* name : names) {
+            auto it = db->second.tables.find(*name);
+            if (it != db->second.tables.end()) tables.push_back(&it->second);
+        }
+        sort(tables.begin(), tables.end());
+        tables.erase(unique(tables.begin(), tables.end()), tables.end());
+        return tables;
+    }
 
-    // 세미콜론 제거
-    tableName.erase(remove(tableName.begin(), tableName.end(), ';'), tableName.end());
+    // 테이블 잠금이 카탈로그 잠금보다 먼저 풀리도록 선언 순서를 유지
+    shared_lock<shared_mutex> catalogShared_;
+    unique_lock<shared_mutex> catalogExclusive_;
+    vector<shared_lock<shared_mutex>> readers_;
+    vector<unique_lock<mutex>> writers_;
+};
 
-    auto it = databases[currentDatabase].tables.find(tableName);
-    if (it == databases[currentDatabase].tables.end()) {
-        cerr << "ERROR: " << tableName << " 존재하지 않습니다. 현재 데이터베이스: " << currentDatabase << ".\n";
+// 파싱된 문장 하나를 해당 기능으로 보내는 함수
+void executeStatement(const Statement& stmt) {
+    if (stmt.paramCount > 0 && stmt.kind != StatementKind::Prepare) {
+        *queryErr << "ERROR: 파라미터($n, ?)는 PREPARE 문장에서만 사용할 수 있습니다.\n";
         return;
     }
 
-    TableData& table = it->second;
-    vector<string> row;
-    string value;
-    int columnIndex = 0; // `columnIndex` 변수를 선언하고 0으로 초기화
-
-    while (ss >> value) {
-        // 데이터 타입 검사
-        if (columnIndex >= table.schema.columnTypes.size()) {
-            cerr << "Error: 입력된 데이터 수가 테이블의 열 수를 초과했습니다. 테이블: " << tableName << ".\n";
-            return;
-        }
+    auto start = chrono::steady_clock::now();
+    StatementLocks locks(stmt);
 
-        string expectedType = table.schema.columnTypes[columnIndex];
+    switch (stmt.kind) {
+        case StatementKind::CreateDatabase: createDatabase(stmt); break;
+        case StatementKind::CreateTable: createTable(stmt); break;
+        case StatementKind::CreateIndex: createIndex(stmt); break;
+        case StatementKind::Use: useDatabase(stmt); break;
+        case StatementKind::Insert: insertIntoTable(stmt); break;
+        case StatementKind::Select: selectFromTable(stmt); break;
+        case StatementKind::Delete: deleteFromTable(stmt); break;
+        case StatementKind::Update: updateTable(stmt); break;
+        case StatementKind::Commit: commitDatabase(); break;
+        case StatementKind::Checkpoint: checkpointCurrentDatabase(); break;
+        case StatementKind::Set: setOption(stmt); break;
+        case StatementKind::Copy: copyFromFile(stmt); break;
+        case StatementKind::Prepare: prepareStatement(stmt); break;
+        case StatementKind::Execute: executePrepared(stmt); break;
+        case StatementKind::Deallocate: deallocateStatement(stmt); break;
+        case StatementKind::Explain: explainSelect(stmt); break;
+        case StatementKind::Show: showInfo(stmt); break;
+    }
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    statementLatency[static_cast<size_t>(stmt.kind)].record(static_cast<uint64_t>(elapsed));
+}
 
-        // 데이터 타입 검사
-        bool typeMismatch = false;
+// 쿼리를 파싱하고 해당 기능을 호출하는 함수
+// 한 번 토큰으로 나눈 뒤 세미콜론마다 문장 하나씩 파싱해 실행
+void executeQuery(const string& query) {
+    vector<Token> tokens;
+    string error;
+    if (!tokenize(query, tokens, error)) {
+        *queryErr << error << "\n";
+        return;
+    }
 
-        if (expectedType == "int") {
-            // 숫자가 아닌 경우 에러
-            if (!isNumeric(value)) {
-                typeMismatch = true;
-            }
-        } else if (expectedType == "float") {
-            // 실수가 아닌 경우 에러
-            if (value.find_first_not_of("0123456789.") != string::npos || count(value.begin(), value.end(), '.') > 1) {
-                typeMismatch = true;
-            }
-        } else if (expectedType == "string") {
-            // 문자열은 따옴표로 감싸져 있어야 함
-            if (value.front() != '"' || value.back() != '"') {
-                typeMismatch = true;
-            }
-        } else if (expectedType == "date") {
-            // 날짜는 'YYYY-MM-DD' 형식이어야 함
-            if (value.find_first_not_of("0123456789-") != string::npos || count(value.begin(), value.end(), '-') != 2) {
-                typeMismatch = true;
+    size_t begin = 0;
+    while (begin < tokens.size()) {
+        size_t end = begin;
+        while (end < tokens.size() && !(tokens[end].kind == TokenKind::Symbol && tokens[end].text == ";")) ++end;
+        if (end > begin) {
+            Statement stmt;
+            SqlParser parser(tokens, begin, end);
+            if (parser.parseStatement(stmt, error)) {
+                if (stmt.kind == StatementKind::Select && resultCache.enabled()) {
+                    for (size_t i = begin; i < end; ++i) stmt.text += (i > begin ? " " : "") + tokens[i].text;
+                }
+                executeStatement(stmt);
+            } else {
+                *queryErr << error << "\n";
             }
         }
+        begin = end + 1;
+    }
+}
 
-        if (typeMismatch) {
-            cerr << "Error: 데이터 타입이 일치하지 않습니다. 열: " << table.schema.columns[columnIndex]
-                 << ", 예상 타입: " << expectedType << ", 제공된 값: " << value << ".\n";
-            return;
-        }
+// ---- 서버 모드 ----
+// ./DBMS --server <port | unix-socket-path> 로 실행하면 REPL 대신 소켓으로 여러 클라이언트를 받음
+// 이벤트 루프 스레드 하나가 epoll로 연결 수락과 읽기를 처리하고, 완성된 쿼리 줄은 워커 풀에서 실행
+// 요청은 줄바꿈으로 끝나는 쿼리 한 줄, 응답은 그 쿼리의 출력과 오류 메시지 뒤에 '\0' 한 바이트
+
+const char kResponseEnd = '\0';
 
-        row.push_back(value);
-        columnIndex++;
+// 주소 문자열을 소켓 주소로 바꾸는 함수
+// 숫자만 있으면 127.0.0.1의 TCP 포트, host:port이면 해당 IPv4 주소, 그 외에는 Unix 소켓 경로
+bool parseSocketAddress(const string& address, sockaddr_storage& storage, socklen_t& length) {
+    memset(&storage, 0, sizeof(storage));
+    size_t colon = address.rfind(':');
+    int64_t port = 0;
+    if (address.find('/') == string::npos && parseInt(colon == string::npos ? address : address.substr(colon + 1), port)) {
+        if (port <= 0 || port > 65535) return false;
+        auto& inet = reinterpret_cast<sockaddr_in&>(storage);
+        inet.sin_family = AF_INET;
+        inet.sin_port = htons(static_cast<uint16_t>(port));
+        string host = colon == string::npos ? "127.0.0.1" : address.substr(0, colon);
+        if (inet_pton(AF_INET, host.c_str(), &inet.sin_addr) != 1) return false;
+        length = sizeof(sockaddr_in);
+        return true;
     }
+    auto& local = reinterpret_cast<sockaddr_un&>(storage);
+    if (address.empty() || address.size() >= sizeof(local.sun_path)) return false;
+    local.sun_family = AF_UNIX;
+    memcpy(local.sun_path, address.data(), address.size());
+    length = sizeof(sockaddr_un);
+    return true;
+}
 
-    // 입력된 값의 개수와 테이블의 열 수가 일치하는지 확인
-    if (row.size() != table.schema.columns.size()) {
-        cerr << "Error: 입력 값 (" << row.size() << ")개, 컬럼 갯수가 일치 하지 않습니다. 컬럼 (" << table.schema.columns.size() << ")개 테이블 명: " << tableName << ".\n";
-        return;
+// 서버 소켓을 열어 대기 상태로 만드는 함수 (실패하면 -1)
+int openListener(const string& address) {
+    sockaddr_storage storage;
+    socklen_t length = 0;
+    if (!parseSocketAddress(address, storage, length)) {
+        cerr << "ERROR: " << address << " 은(는) 올바른 주소가 아닙니다. 포트 번호, host:port 또는 Unix 소켓 경로를 입력하세요.\n";
+        return -1;
     }
+    int fd = socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (storage.ss_family == AF_UNIX) {
+        unlink(address.c_str()); // 이전 실행이 남긴 소켓 파일
+    } else {
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&storage), length) != 0 || listen(fd, SOMAXCONN) != 0) {
+        cerr << "ERROR: " << address << " 에서 연결을 기다리는데 실패했습니다: " << strerror(errno) << "\n";
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
 
-    table.rows.push_back(row);
-    cout << "Success: 데이터 삽입 성공 " << tableName << ", 데이터베이스: " << currentDatabase << "\n";
+// 서버에 연결하는 함수 (실패하면 -1)
+int connectServer(const string& address) {
+    sockaddr_storage storage;
+    socklen_t length = 0;
+    if (!parseSocketAddress(address, storage, length)) return -1;
+    int fd = socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&storage), length) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (storage.ss_family == AF_INET) {
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+    return fd;
 }
 
-// DELETE 쿼리를 처리하는 함수
-void deleteFromTable(const string& query) {
-    if (currentDatabase.empty()) {
-        cerr << "데이터베이스 선택 후 진행해주세요. \n";
-        return;
+// 논블로킹 소켓에 전부 보낼 때까지 쓰는 함수 (버퍼가 차면 쓸 수 있을 때까지 기다림)
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            pollfd waiting = {fd, POLLOUT, 0};
+            if (poll(&waiting, 1, -1) < 0 && errno != EINTR) return false;
+            continue;
+        }
+        data += sent;
+        size -= sent;
     }
+    return true;
+}
 
-    istringstream ss(query);
-    string token;
-    ss >> token; // 'DELETE'
-    ss >> token; // 'FROM'
+// 클라이언트 연결 하나의 상태
+// 한 세션의 쿼리는 도착한 순서대로 한 번에 하나씩만 실행됨 (busy)
+struct ClientSession {
+    int fd = -1;
+    string input; // 아직 줄바꿈이 오지 않은 입력 (이벤트 루프만 사용)
 
-    string tableName;
-    ss >> tableName; // 테이블 이름
+    mutex lock;           // 아래 두 필드를 이벤트 루프와 워커가 같이 사용
+    deque<string> queries; // 도착했지만 아직 실행하지 않은 쿼리
+    bool busy = false;     // 워커 대기열에 있거나 실행 중
 
-    // 세미콜론 제거
-    tableName.erase(remove(tableName.begin(), tableName.end(), ';'), tableName.end());
+    string database;                                     // 세션의 현재 데이터베이스 (워커만 사용)
+    unordered_map<string, PreparedStatement> prepared;   // 세션의 준비된 문장 (워커만 사용)
 
-    auto it = databases[currentDatabase].tables.find(tableName);
-    if (it == databases[currentDatabase].tables.end()) {
-        cerr << "ERROR: " << tableName << " 테이블이 존재하지 않습니다. 현재데이터베이스: " << currentDatabase << ".\n";
-        return;
+    ~ClientSession() {
+        if (fd >= 0) close(fd);
     }
+};
 
-    TableData& table = it->second;
-
-    // WHERE 절이 있는지 확인
-    size_t wherePos = query.find("WHERE");
-    if (wherePos != string::npos) {
-        string whereClause = query.substr(wherePos + 6); // 'WHERE ' 이후의 문자열
+// 세션의 쿼리를 실행하는 워커 스레드 풀
+// 쿼리 하나를 실행할 때마다 세션을 대기열 뒤로 보내 한 클라이언트가 워커를 독차지하지 않게 함
+class SessionWorkers {
+public:
+    explicit SessionWorkers(size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+    }
 
-        // WHERE 절 조건 처리
-        string whereColumn, op, whereValue;
-        istringstream whereStream(whereClause);
-        whereStream >> whereColumn >> op;
-        getline(whereStream, whereValue);
-        whereValue.erase(remove(whereValue.begin(), whereValue.end(), ' '), whereValue.end());
+    ~SessionWorkers() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stop_ = true;
+        }
+        ready_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
 
-        // 문자열 값에서 작은 따옴표 제거
-        if (whereValue.front() == '\'' && whereValue.back() == '\'') {
-            whereValue = whereValue.substr(1, whereValue.size() - 2);
+    void schedule(shared_ptr<ClientSession> session) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            sessions_.push_back(move(session));
         }
+        ready_.notify_one();
+    }
 
-        if (whereColumn.empty() || op.empty() || whereValue.empty()) {
-            cerr << "Invalid DELETE query syntax. Use DELETE FROM table_name WHERE column operator value;\n";
-            return;
+private:
+    void workerLoop() {
+        while (true) {
+            shared_ptr<ClientSession> session;
+            {
+                unique_lock<mutex> lock(mutex_);
+                ready_.wait(lock, [&] { return stop_ || !sessions_.empty(); });
+                if (sessions_.empty()) return;
+                session = move(sessions_.front());
+                sessions_.pop_front();
+            }
+            runNext(session);
         }
+    }
 
-        // 선택한 열의 인덱스를 찾기 위한 맵
-        unordered_map<string, int> columnIndices;
-        for (int i = 0; i < table.schema.columns.size(); ++i) {
-            columnIndices[table.schema.columns[i]] = i;
+    // 세션의 다음 쿼리 하나를 세션의 데이터베이스와 준비된 문장으로 실행하고 응답을 보내는 함수
+    void runNext(const shared_ptr<ClientSession>& session) {
+        string query;
+        {
+            lock_guard<mutex> lock(session->lock);
+            query = move(session->queries.front());
+            session->queries.pop_front();
         }
 
-        int whereColumnIndex = -1;
-        if (columnIndices.find(whereColumn) != columnIndices.end()) {
-            whereColumnIndex = columnIndices[whereColumn];
+        bool open = true;
+        if (query == "exit") {
+            shutdown(session->fd, SHUT_RDWR); // 이벤트 루프가 연결 종료를 보고 세션을 정리
+            open = false;
         } else {
-            cerr << "ERROR: 테이블에 " << whereColumn << " 컬럼이 존재하지 않습니다. " << tableName << ".\n";
-            return;
+            ostringstream response;
+            currentDatabase.swap(session->database);
+            preparedStatements.swap(session->prepared);
+            queryOut = queryErr = &response;
+            executeQuery(query);
+            queryOut = &cout;
+            queryErr = &cerr;
+            preparedStatements.swap(session->prepared);
+            currentDatabase.swap(session->database);
+
+            response << kResponseEnd;
+            string text = response.str();
+            open = sendAll(session->fd, text.data(), text.size());
         }
 
-        // 조건에 맞는 행을 삭제
-        table.rows.erase(remove_if(table.rows.begin(), table.rows.end(), [&](const vector<string>& row) {
-            return evaluateCondition(row[whereColumnIndex], op, whereValue);
-        }), table.rows.end());
+        {
+            lock_guard<mutex> lock(session->lock);
+            if (!open) session->queries.clear();
+            if (session->queries.empty()) {
+                session->busy = false;
+                return;
+            }
+        }
+        schedule(session);
+    }
 
-        cout << "Rows 삭제 완료, from " << tableName << " where " << whereColumn << " " << op << " '" << whereValue << "' successfully in database " << currentDatabase << ".\n";
-    } else {
-        // WHERE 절이 없으면 경고 메시지 표시하고 삭제를 수행하지 않음
-        cerr << "Invalid DELETE query syntax. Missing WHERE clause. Use DELETE FROM table_name WHERE column operator value;\n";
+    vector<thread> workers_;
+    mutex mutex_;
+    condition_variable ready_;
+    deque<shared_ptr<ClientSession>> sessions_;
+    bool stop_ = false;
+};
+
+// 읽은 입력에서 완성된 줄을 쿼리로 꺼내 세션 대기열에 넣는 함수
+// 세션이 쉬고 있으면 워커 대기열에 올림
+void queueQueries(const shared_ptr<ClientSession>& session, SessionWorkers& workers) {
+    string& input = session->input;
+    size_t begin = 0;
+    bool schedule = false;
+    {
+        lock_guard<mutex> lock(session->lock);
+        for (size_t end = input.find('\n'); end != string::npos; end = input.find('\n', begin)) {
+            string_view line = trimSpaces(string_view(input).substr(begin, end - begin));
+            if (!line.empty()) session->queries.emplace_back(line);
+            begin = end + 1;
+        }
+        if (!session->busy && !session->queries.empty()) {
+            session->busy = true;
+            schedule = true;
+        }
     }
+    input.erase(0, begin);
+    if (schedule) workers.schedule(session);
 }
 
-// SELECT 쿼리를 처리하는 함수 (WHERE 조건 및 여러 열 조회 추가)
-void selectFromTable(const string& query) {
-    if (currentDatabase.empty()) {
-        cerr << "데이터베이스 선택 후 진행해주세요.\n";
-        return;
+// 서버 이벤트 루프: 연결을 받고, 읽을 수 있는 연결에서 쿼리를 모아 워커에 넘김
+// 연결이 닫혀도 이미 받은 쿼리는 끝까지 실행하고 응답을 보낸 뒤 세션을 정리함
+int runServer(const string& address, size_t workerCount) {
+    int listener = openListener(address);
+    if (listener < 0) return 1;
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    if (epoll < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) != 0) {
+        cerr << "ERROR: 이벤트 루프를 만드는데 실패했습니다: " << strerror(errno) << "\n";
+        return 1;
     }
 
-    istringstream ss(query);
-    string token;
-    ss >> token; // 'SELECT'
+    SessionWorkers workers(workerCount);
+    unordered_map<int, shared_ptr<ClientSession>> sessions;
+    vector<char> buffer(1 << 16);
+    epoll_event events[64];
+    cout << "서버가 " << address << " 에서 연결을 기다립니다 (워커 " << workerCount << "개, 스캔 스레드 " << scanThreads << "개).\n" << flush;
 
-    vector<string> selectColumns;
-    string column;
+    while (true) {
+        int ready = epoll_wait(epoll, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            cerr << "ERROR: epoll_wait 실패: " << strerror(errno) << "\n";
+            return 1;
+        }
+        for (int e = 0; e < ready; ++e) {
+            int fd = events[e].data.fd;
+            if (fd == listener) {
+                int client;
+                while ((client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    int noDelay = 1;
+                    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)); // Unix 소켓이면 무시됨
+                    auto session = make_shared<ClientSession>();
+                    session->fd = client;
+                    event.events = EPOLLIN;
+                    event.data.fd = client;
+                    epoll_ctl(epoll, EPOLL_CTL_ADD, client, &event);
+                    sessions[client] = move(session);
+                }
+                continue;
+            }
 
-    // SELECT 절에서 조회할 열 추출
-    while (ss >> column) {
-        if (column == "FROM") {
-            break; // 'FROM' 키워드를 만나면 루프 종료
-        } else if (column == "*") {
-            selectColumns.clear(); // 모든 열을 선택하기 위해 초기화
-            ss >> column;  // Move to the next token (should be 'FROM')
-            break;  // Exit loop to process 'FROM'
-        } else {
-            // 쉼표로 구분된 여러 열을 처리
-            size_t commaPos;
-            while ((commaPos = column.find(' ')) != string::npos) {
-                string colName = column.substr(0, commaPos);
-                cout << "col: " << colName << endl;
-                colName.erase(remove(colName.begin(), colName.end(), ' '), colName.end());
-                selectColumns.push_back(colName);
-                column.erase(0, commaPos + 1);
-                column.erase(remove(column.begin(), column.end(), ' '), column.end());
+            auto it = sessions.find(fd);
+            if (it == sessions.end()) continue;
+            shared_ptr<ClientSession> session = it->second;
+            bool open = true;
+            while (true) {
+                ssize_t count = read(fd, buffer.data(), buffer.size());
+                if (count > 0) {
+                    session->input.append(buffer.data(), count);
+                } else if (count < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    open = count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                    break;
+                }
+            }
+            if (!open && !session->input.empty()) session->input.push_back('\n'); // 줄바꿈 없이 끝난 마지막 쿼리
+            queueQueries(session, workers);
+            if (!open) {
+                // 소켓은 워커가 세션을 놓을 때 닫힘 (그 전에는 같은 fd 번호가 다시 쓰이지 않음)
+                epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+                sessions.erase(it);
             }
-            column.erase(remove(column.begin(), column.end(), ' '), column.end());
-            selectColumns.push_back(column);
         }
     }
+}
 
-    if (column != "FROM") {
-        cerr << "SQL 구문 오류: 'FROM' 키워드가 누락되었습니다.\n";
-        return;
+// 서버에 쿼리 한 줄을 보내고 응답 끝까지 읽는 함수
+bool roundTrip(int fd, const string& query, string& response) {
+    string line = query + "\n";
+    if (!sendAll(fd, line.data(), line.size())) return false;
+    response.clear();
+    char buffer[4096];
+    while (response.empty() || response.back() != kResponseEnd) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        response.append(buffer, count);
     }
+    response.pop_back();
+    return true;
+}
 
-    string tableName;
-    ss >> tableName; // 테이블 이름을 읽음
+// ./DBMS --load <address> <clients> <seconds> <database> <query> [query ...]
+// 클라이언트마다 연결 하나를 열어 USE database 후 쿼리들을 차례로 반복해 보내고, 처리량과 지연 시간 분포를 출력
+int runLoadGenerator(const string& address, size_t clients, double seconds, const string& database, const vector<string>& queries) {
+    vector<vector<double>> latencies(clients); // 클라이언트별 쿼리 지연 (마이크로초)
+    atomic<size_t> failed{0};
+    auto start = chrono::steady_clock::now();
+    auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds));
 
-    // 세미콜론 제거
-    tableName.erase(remove(tableName.begin(), tableName.end(), ';'), tableName.end());
+    vector<thread> threads;
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            int fd = connectServer(address);
+            string response;
+            if (fd < 0 || !roundTrip(fd, "USE " + database, response)) {
+                failed++;
+                if (fd >= 0) close(fd);
+                return;
+            }
+            for (size_t i = 0; chrono::steady_clock::now() < deadline; ++i) {
+                auto sent = chrono::steady_clock::now();
+                if (!roundTrip(fd, queries[i % queries.size()], response)) {
+                    failed++;
+                    break;
+                }
+                latencies[c].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - sent).count());
+            }
+            roundTrip(fd, "exit", response);
+            close(fd);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-    auto it = databases[currentDatabase].tables.find(tableName);
-    if (it == databases[currentDatabase].tables.end()) {
-        cerr << "ERROR: " << tableName << "이 데이터베이스 " << currentDatabase << "에 존재하지 않습니다.\n";
-        return;
+    vector<double> all;
+    for (auto& list : latencies) all.insert(all.end(), list.begin(), list.end());
+    if (all.empty()) {
+        cerr << "ERROR: " << address << " 서버에서 완료된 쿼리가 없습니다 (연결 실패 " << failed.load() << "건).\n";
+        return 1;
     }
+    sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[min(all.size() - 1, static_cast<size_t>(p * all.size()))] / 1000.0; };
 
-    TableData& table = it->second;
+    cout << fixed << setprecision(2);
+    cout << "clients: " << clients << ", queries: " << all.size() << ", seconds: " << elapsed << ", failed: " << failed.load() << "\n";
+    cout << "QPS: " << all.size() / elapsed << "\n";
+    cout << "latency ms: p50 " << percentile(0.50) << ", p99 " << percentile(0.99) << ", max " << all.back() / 1000.0 << "\n";
+    cout.unsetf(ios::fixed);
+    return 0;
+}
 
-    // 모든 열 선택하는 경우 처리
-    if (selectColumns.empty() || (selectColumns.size() == 1 && selectColumns[0] == "*")) {
-        selectColumns = table.schema.columns; // 현재 테이블의 모든 열 선택
+// ./DBMS --bench-scan [rows] : 합성 테이블을 스레드 수를 바꿔 가며 스캔해 처리량을 출력하는 함수
+// 스레드 수는 1부터 두 배씩 CPU 코어 수(또는 DBMS_THREADS)까지 늘림
+int benchmarkScan(size_t rowCount) {
+    TableData table;
+    table.schema = {"bench", {"id", "amount", "day"}, {"int", "float", "date"}};
+    initColumns(table);
+    uint64_t state = 88172645463325252ull;
+    for (size_t row = 0; row < rowCount; ++row) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        table.columns[0].ints.push_back(static_cast<int64_t>(row));
+        table.columns[1].floats.push_back(static_cast<double>(state % 100000) / 100.0);
+        table.columns[2].dates.push_back(20240101 + static_cast<int32_t>(state % 28));
     }
+    table.rowCount = rowCount;
+    extendZoneMaps(table, 0);
 
-    // WHERE 절이 있는지 확인
-    string whereClause;
-    size_t wherePos = query.find("WHERE");
-    if (wherePos != string::npos) {
-        whereClause = query.substr(wherePos + 6); // 'WHERE ' 이후의 문자열
-    }
+    // amount > 100 AND day < 2024-01-15 OR id < rowCount / 100
+    vector<vector<Condition>> groups = {
+        {makeCondition(table, 1, ">", "100"), makeCondition(table, 2, "<", "2024-01-15")},
+        {makeCondition(table, 0, "<", to_string(rowCount / 100))},
+    };
 
-    // WHERE 절 조건 처리
-    string whereColumn, op, whereValue;
-    if (!whereClause.empty()) {
-        istringstream whereStream(whereClause);
-        whereStream >> whereColumn >> op >> whereValue;
+    size_t maxThreads = scanThreads;
+    double baseline = 0;
+    cout << "rows: " << rowCount << ", WHERE amount > 100 AND day < 2024-01-15 OR id < " << rowCount / 100 << "\n";
+    cout << "threads\tms\tMrows/s\tspeedup\n";
+    for (size_t threads = 1; threads <= maxThreads; threads = threads * 2 > maxThreads && threads < maxThreads ? maxThreads : threads * 2) {
+        scanThreads = threads;
+        double best = 1e30;
+        size_t matched = 0;
+        for (int repeat = 0; repeat < 5; ++repeat) {
+            auto start = chrono::steady_clock::now();
+            matched = 0;
+            scanTable(table, groups, [&](const uint64_t*, size_t count) { matched += count; });
+            best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+        if (threads == 1) baseline = best;
+        cout << threads << "\t" << fixed << setprecision(2) << best * 1000 << "\t" << rowCount / best / 1e6 << "\t" << baseline / best << "x (" << matched << " rows)\n";
+        cout.unsetf(ios::fixed);
     }
+    scanThreads = maxThreads;
+    return 0;
+}
 
-    // 선택한 열의 인덱스를 찾기 위한 맵
-    unordered_map<string, int> columnIndices;
-    for (int i = 0; i < table.schema.columns.size(); ++i) {
-        columnIndices[table.schema.columns[i]] = i;
-    }
+// 컴파일된 조건 이전의 행 단위 평가 방식 (행마다 연산자 문자열을 비교), --bench-predicates의 비교 기준으로만 씀
+template <typename T>
+bool compareByOperatorText(const T& lhs, const string& op, const T& rhs) {
+    if (op == "=") return lhs == rhs;
+    if (op == "<") return lhs < rhs;
+    if (op == ">") return lhs > rhs;
+    if (op == "<=") return lhs <= rhs;
+    if (op == ">=") return lhs >= rhs;
+    if (op == "<>") return lhs != rhs;
+    return false;
+}
 
-    // 선택한 열 출력
-    for (const auto& col : selectColumns) {
-        if (columnIndices.find(col) == columnIndices.end()) {
-            cerr << "ERROR: " << col << " 컬럼이 테이블 " << tableName << "에 존재하지 않습니다.\n";
-            return;  // 존재하지 않는 열이면 오류 출력 후 반환
-        }
-        cout << col << "\t";
+bool rowMatchesByOperatorText(const TableData& table, const Condition& cond, const string& op, size_t row) {
+    if (!cond.valid) return false;
+    const ColumnData& column = table.columns[cond.columnIndex];
+    switch (column.type) {
+        case ColumnType::Int: return compareByOperatorText(column.ints[row], op, cond.intValue);
+        case ColumnType::Float: return compareByOperatorText(column.floats[row], op, cond.floatValue);
+        case ColumnType::Date: return compareByOperatorText(column.dates[row], op, cond.dateValue);
+        case ColumnType::String: return compareByOperatorText(column.strings.get(row), op, string_view(cond.stringValue));
     }
-    cout << "\n";
+    return false;
+}
 
-    int whereColumnIndex = -1;
-    if (!whereColumn.empty() && columnIndices.find(whereColumn) != columnIndices.end()) {
-        whereColumnIndex = columnIndices[whereColumn];
+// ./DBMS --bench-predicates [rows] : 조건 타입마다 행 단위 평가와 컴파일된 조건의 단일 스레드 처리량을 비교하는 함수
+// 두 방식 모두 조건을 만족하는 행 번호를 선택 벡터에 모으며, 5번 중 가장 빠른 시간을 씀 (zone map으로 건너뛰지 않음)
+int benchmarkPredicates(size_t rowCount) {
+    TableData table;
+    table.schema = {"bench", {"id", "amount", "name", "day"}, {"int", "float", "string", "date"}};
+    initColumns(table);
+    uint64_t state = 88172645463325252ull;
+    for (size_t row = 0; row < rowCount; ++row) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        table.columns[0].ints.push_back(static_cast<int64_t>(row));
+        table.columns[1].floats.push_back(static_cast<double>(state % 100000) / 100.0);
+        table.columns[2].strings.push_back("\"n" + to_string(state % 10) + "\"");
+        table.columns[3].dates.push_back(20240101 + static_cast<int32_t>(state % 28));
     }
+    table.rowCount = rowCount;
+
+    struct Case {
+        const char* type;
+        int column;
+        const char* op;
+        string literal;
+    };
+    vector<Case> cases = {
+        {"int", 0, ">", to_string(rowCount / 2)},
+        {"float", 1, "<", "100.0"},
+        {"string", 2, "=", "n5"},
+        {"date", 3, ">=", "2024-01-20"},
+    };
 
-    for (const auto& row : table.rows) {
-        if (row.empty()) {
-            continue;  // 빈 행은 무시
+    auto best = [](const function<void()>& run) {
+        double fastest = 1e30;
+        for (int repeat = 0; repeat < 5; ++repeat) {
+            auto start = chrono::steady_clock::now();
+            run();
+            fastest = min(fastest, chrono::duration<double>(chrono::steady_clock::now() - start).count());
         }
+        return fastest;
+    };
 
-        if (whereColumnIndex == -1 || (whereColumnIndex != -1 && whereColumnIndex < row.size() && evaluateCondition(row[whereColumnIndex], op, whereValue))) {
-            for (const auto& col : selectColumns) {
-                int colIndex = columnIndices[col];
-                if (colIndex < row.size()) {
-                    cout << row[colIndex] << "\t";
-                } else {
-                    cerr << "Invalid column index: " << colIndex << " for row size " << row.size() << ".\n";
-                    return;
+    cout << "rows: " << rowCount << ", 1 thread, best of 5\n";
+    cout << "predicate\trow Mrows/s\tcompiled Mrows/s\tspeedup\tmatched\n";
+    vector<uint64_t> selected;
+    selected.reserve(kScanBlockRows);
+    for (const Case& c : cases) {
+        Condition cond = makeCondition(table, c.column, c.op, c.literal);
+        size_t rowMatched = 0;
+        double rowSeconds = best([&] {
+            rowMatched = 0;
+            for (size_t begin = 0; begin < rowCount; begin += kScanBlockRows) {
+                size_t end = min(rowCount, begin + kScanBlockRows);
+                selected.clear();
+                for (size_t row = begin; row < end; ++row) {
+                    if (rowMatchesByOperatorText(table, cond, c.op, row)) selected.push_back(row);
                 }
+                rowMatched += selected.size();
+            }
+        });
+
+        unique_ptr<Predicate> predicate = compilePredicate(table, cond);
+        size_t compiledMatched = 0;
+        double compiledSeconds = best([&] {
+            compiledMatched = 0;
+            uint64_t bits[kScanBlockRows / 64];
+            for (size_t begin = 0; begin < rowCount; begin += kScanBlockRows) {
+                size_t end = min(rowCount, begin + kScanBlockRows);
+                size_t words = bitmapWords(end - begin);
+                fill(bits, bits + words, 0);
+                predicate->evaluate(begin, end, bits);
+                selected.clear();
+                appendSelection(bits, words, begin, selected);
+                compiledMatched += selected.size();
             }
-            cout << "\n";
+        });
+
+        if (rowMatched != compiledMatched) {
+            cerr << "ERROR: " << c.type << " 조건의 결과 행 수가 다릅니다 (" << rowMatched << " / " << compiledMatched << ").\n";
+            return 1;
         }
+        cout << c.type << " " << table.schema.columns[c.column] << " " << c.op << " " << c.literal << "\t" << fixed << setprecision(2)
+             << rowCount / rowSeconds / 1e6 << "\t" << rowCount / compiledSeconds / 1e6 << "\t" << rowSeconds / compiledSeconds
+             << "x\t" << compiledMatched << "\n";
+        cout.unsetf(ios::fixed);
     }
+    return 0;
 }
 
-// COMMIT 쿼리를 처리하고 데이터를 파일에 저장하는 함수
-void commitDatabase() {
-    if (currentDatabase.empty()) {
-        cerr << "데이터베이스 선택 후 진행해주세요. \n";
-        return;
+// ---- 임베딩 API (DBMS.h의 dbms::Database / Connection / ResultCursor) ----
+
+const uint64_t kNullRow = UINT64_MAX; // 커서 행 번호 목록에서 값이 없는 MIN / MAX
+
+dbms::ValueType valueType(ColumnType type) {
+    switch (type) {
+        case ColumnType::Int: return dbms::ValueType::Int;
+        case ColumnType::Float: return dbms::ValueType::Float;
+        case ColumnType::Date: return dbms::ValueType::Date;
+        case ColumnType::String: return dbms::ValueType::String;
     }
+    return dbms::ValueType::String;
+}
+
+// 커서가 읽는 결과 열 하나
+// 테이블 값이면 source 열의 rowSets[rowSet] 행을 가리키고, COUNT / SUM / AVG처럼 계산한 값이면 computed에 행 순서로 둠
+struct CursorColumn {
+    string name;
+    ColumnType type = ColumnType::Int;
+    const ColumnData* source = nullptr;
+    size_t rowSet = 0;
+    ColumnData computed;
+    vector<char> nulls; // computed 값이 NULL인지
+};
 
-    string filename = currentDatabase + ".mydb";
-    ofstream file(filename); // 파일을 텍스트 모드로 열기
+// 커서의 결과: 열마다 값을 찾는 방법과 행 번호 목록 (CursorSink가 채움)
+struct CursorResult {
+    vector<CursorColumn> columns;
+    vector<vector<uint64_t>> rowSets;
+    size_t rows = 0;
+};
 
-    if (!file.is_open()) {
-        cerr << "Error: " << filename << "파일을 쓰는데 실패했습니다. \n";
-        return;
+// 결과를 텍스트로 쓰지 않고 행 번호만 모으는 쪽 (값은 실행에 쓴 스냅샷 뷰에 그대로 있음)
+// 단일 테이블이면 행 번호 목록 하나, 조인이면 양쪽 테이블의 목록 두 개, 집계면 그룹 행과 MIN / MAX 값을 가진 행의 목록
+class CursorSink : public ResultSink {
+public:
+    CursorSink(const QueryPlan& plan, CursorResult& result) : result_(result) {
+        auto sourceType = [&](int columnIndex) {
+            if (plan.join) {
+                const JoinColumnRef& ref = plan.join->columns[columnIndex];
+                return plan.join->sides[ref.side].table->columns[ref.columnIndex].type;
+            }
+            return plan.table->columns[columnIndex].type;
+        };
+        bool joinStream = plan.join && !plan.aggregate && plan.order.empty();
+        result_.rowSets.resize(joinStream ? 2 : 1);
+        result_.columns.resize(plan.labels.size());
+        for (size_t i = 0; i < result_.columns.size(); ++i) {
+            CursorColumn& column = result_.columns[i];
+            column.name = plan.labels[i];
+            if (!plan.aggregate) {
+                column.type = sourceType(plan.projection[i]);
+                column.rowSet = joinStream ? plan.join->columns[plan.projection[i]].side : 0;
+                continue;
+            }
+            const AggregateSpec& spec = plan.items[i];
+            switch (spec.func) {
+                case AggregateFunc::None: column.type = sourceType(spec.columnIndex); break;
+                case AggregateFunc::Min:
+                case AggregateFunc::Max:
+                    column.type = sourceType(spec.columnIndex);
+                    column.rowSet = result_.rowSets.size();
+                    result_.rowSets.emplace_back();
+                    break;
+                case AggregateFunc::Count: column.type = ColumnType::Int; break;
+                case AggregateFunc::Sum: column.type = sourceType(spec.columnIndex) == ColumnType::Int ? ColumnType::Int : ColumnType::Float; break;
+                case AggregateFunc::Avg: column.type = ColumnType::Float; break;
+            }
+            column.computed.type = column.type;
+        }
     }
 
-    Database& db = databases[currentDatabase];
+    void tableRows(const QueryPlan& plan, const TableData& table, const uint64_t* rows, size_t count) override {
+        for (size_t i = 0; i < result_.columns.size(); ++i) result_.columns[i].source = &table.columns[plan.projection[i]];
+        result_.rowSets[0].insert(result_.rowSets[0].end(), rows, rows + count);
+        result_.rows += count;
+    }
 
-    // 각 테이블의 데이터를 파일에 저장
-    for (const auto& tablePair : db.tables) {
-        const TableData& table = tablePair.second;
+    void joinRows(const QueryPlan& plan, const uint64_t* const* rows, size_t count) override {
+        const JoinPlan& join = *plan.join;
+        for (size_t i = 0; i < result_.columns.size(); ++i) {
+            const JoinColumnRef& ref = join.columns[plan.projection[i]];
+            result_.columns[i].source = &join.sides[ref.side].table->columns[ref.columnIndex];
+        }
+        for (int side = 0; side < 2; ++side) result_.rowSets[side].insert(result_.rowSets[side].end(), rows[side], rows[side] + count);
+        result_.rows += count;
+    }
+
+    void aggregateRow(const QueryPlan& plan, const TableData& table, size_t groupRow, const AggregateState* const* states) override {
+        result_.rowSets[0].push_back(groupRow);
+        for (size_t i = 0; i < result_.columns.size(); ++i) {
+            CursorColumn& column = result_.columns[i];
+            const AggregateSpec& spec = plan.items[i];
+            const AggregateState& st = *states[i];
+            bool isInt = spec.columnIndex >= 0 && table.columns[spec.columnIndex].type == ColumnType::Int;
+            switch (spec.func) {
+                case AggregateFunc::None: column.source = &table.columns[spec.columnIndex]; break;
+                case AggregateFunc::Min:
+                case AggregateFunc::Max:
+                    column.source = &table.columns[spec.columnIndex];
+                    result_.rowSets[column.rowSet].push_back(st.count == 0 ? kNullRow : st.row);
+                    break;
+                case AggregateFunc::Count:
+                    column.computed.ints.push_back(st.count);
+                    column.nulls.push_back(0);
+                    break;
+                case AggregateFunc::Sum:
+                    if (isInt) column.computed.ints.push_back(st.count == 0 ? 0 : st.intSum);
+                    else column.computed.floats.push_back(st.count == 0 ? 0 : st.floatSum);
+                    column.nulls.push_back(st.count == 0);
+                    break;
+                case AggregateFunc::Avg:
+                    column.computed.floats.push_back(st.count == 0 ? 0 : (isInt ? static_cast<double>(st.intSum) : st.floatSum) / st.count);
+                    column.nulls.push_back(st.count == 0);
+                    break;
+            }
+        }
+        ++result_.rows;
+    }
+
+    // 조인 뒤 정렬 / 집계한 결과는 JoinPlan::joined의 행을 가리키므로 커서가 닫힐 때까지 남겨 둠
+    bool keepsJoinedRows() const override { return true; }
+
+private:
+    CursorResult& result_;
+};
+
+// 커서 하나의 상태: 계획 (뷰) → 스냅샷 → 결과 순서로 만들고 반대 순서로 놓음 (잠금은 open 안에서만 잡음)
+struct dbms::ResultCursor::State {
+    QueryPlan plan;
+    unique_ptr<ReadSnapshot> snapshot;
+    CursorResult result;
+    size_t position = SIZE_MAX; // 현재 행 (첫 next() 전에는 SIZE_MAX)
+    string error;
 
-        stringstream dataStream;
-        dataStream << "TABLE: " << table.schema.tableName << "\n";
-        
-        // 스키마 정보 저장
-        dataStream << "SCHEMA:";
-        for (size_t i = 0; i < table.schema.columns.size(); ++i) {
-            dataStream << " (" << table.schema.columnTypes[i] << ")" << table.schema.columns[i];
+    ~State() { release(); }
+
+    // 이 스레드의 현재 세션으로 SELECT (또는 준비된 SELECT의 EXECUTE) 문장 하나를 실행해 결과 행 번호를 모음
+    // 실패하면 오류 메시지를 queryErr에 쓰고 false
+    bool open(const string& sql) {
+        vector<Token> tokens;
+        string parseError;
+        if (!tokenize(sql, tokens, parseError)) {
+            *queryErr << parseError << "\n";
+            return false;
+        }
+        size_t end = 0;
+        while (end < tokens.size() && !(tokens[end].kind == TokenKind::Symbol && tokens[end].text == ";")) ++end;
+        for (size_t i = end; i < tokens.size(); ++i) {
+            if (tokens[i].kind != TokenKind::Symbol || tokens[i].text != ";") {
+                *queryErr << "ERROR: 커서로는 문장 하나만 실행할 수 있습니다.\n";
+                return false;
+            }
+        }
+        Statement stmt;
+        SqlParser parser(tokens, 0, end);
+        if (!parser.parseStatement(stmt, parseError)) {
+            *queryErr << parseError << "\n";
+            return false;
         }
-        dataStream << "\n";
 
-        // 데이터 저장
-        for (const auto& row : table.rows) {
-            for (const auto& value : row) {
-                dataStream << value << "\t";
+        const Statement* select = &stmt;
+        if (stmt.kind == StatementKind::Execute) {
+            auto it = preparedStatements.find(stmt.name);
+            if (it == preparedStatements.end()) {
+                *queryErr << "ERROR: " << stmt.name << " 준비된 문장이 존재하지 않습니다.\n";
+                return false;
             }
-            dataStream << "\n";
+            select = &it->second.statement;
+            if (static_cast<int>(stmt.params.size()) != select->paramCount) {
+                *queryErr << "ERROR: 파라미터 개수가 맞지 않습니다. 필요: " << select->paramCount << "개, 입력: " << stmt.params.size() << "개.\n";
+                return false;
+            }
+        } else if (stmt.paramCount > 0) {
+            *queryErr << "ERROR: 파라미터($n, ?)는 PREPARE 문장에서만 사용할 수 있습니다.\n";
+            return false;
+        }
+        if (select->kind != StatementKind::Select) {
+            *queryErr << "ERROR: 커서로는 SELECT 문장만 실행할 수 있습니다.\n";
+            return false;
         }
-        dataStream << "\n";
 
-        // 파일에 저장
-        file << dataStream.str();
+        // 잠금은 실행하는 동안만 잡음: 모은 행 번호와 스냅샷 뷰는 원본 테이블과 따로 버퍼를 붙잡고 있어 (뷰 pin)
+        // 이후 writer / vacuum / CHECKPOINT가 원본을 바꾸거나 옮겨도 커서가 읽는 값은 그대로이므로,
+        // 커서를 연 채로 같은 스레드에서 다른 문장을 실행해도 같은 공유 잠금을 다시 잡지 않음
+        StatementLocks locks(stmt);
+        if (!resolvePlan(*select, plan)) return false;
+        if (select != &stmt && !bindParams(*select, plan, stmt.params)) return false;
+        CursorSink sink(plan, result);
+        plan.sink = &sink;
+        snapshot = make_unique<ReadSnapshot>(plan);
+        if (plan.join) {
+            runJoin(plan);
+        } else {
+            runRows(plan);
+        }
+        plan.sink = nullptr;
+        return true;
+    }
+
+    // 스냅샷 뷰를 놓음 (결과가 가리키는 뷰도 비워지므로 결과도 지움)
+    void release() {
+        result = CursorResult();
+        snapshot.reset();
+        plan = QueryPlan();
     }
 
-    file.close();
-    cout << "Database " << currentDatabase << " committed 완료, " << filename << " 파일에 쓰기 및 저장 완료되었습니다. \n";
+    // 현재 행에서 열의 값을 가진 source 행 번호
+    uint64_t sourceRow(const CursorColumn& column) const { return result.rowSets[column.rowSet][position]; }
+
+    // 현재 행의 열 (타입이 다르거나 값이 없으면 nullptr)
+    const CursorColumn* cell(size_t column, ColumnType type) const {
+        if (position >= result.rows || column >= result.columns.size()) return nullptr;
+        const CursorColumn& cursorColumn = result.columns[column];
+        if (cursorColumn.type != type) return nullptr;
+        if (cursorColumn.source ? sourceRow(cursorColumn) == kNullRow : cursorColumn.nulls[position] != 0) return nullptr;
+        return &cursorColumn;
+    }
+};
+
+dbms::ResultCursor::ResultCursor() = default;
+dbms::ResultCursor::ResultCursor(unique_ptr<State> state) : state_(move(state)) {}
+dbms::ResultCursor::ResultCursor(ResultCursor&& other) noexcept = default;
+dbms::ResultCursor& dbms::ResultCursor::operator=(ResultCursor&& other) noexcept = default;
+dbms::ResultCursor::~ResultCursor() = default;
+
+bool dbms::ResultCursor::ok() const { return state_ && state_->error.empty(); }
+
+const string& dbms::ResultCursor::error() const {
+    static const string none;
+    return state_ ? state_->error : none;
 }
 
-// 쿼리를 파싱하고 해당 기능을 호출하는 함수
-void executeQuery(string query) {
-    // 명령어 끝의 세미콜론 제거
-    query.erase(remove(query.begin(), query.end(), ';'), query.end());
-
-    istringstream ss(query);
-    string command;
-    ss >> command;
-
-    if (command == "CREATE") {
-        string type;
-        ss >> type;
-        if (type == "DATABASE") {
-            createDatabase(query);
-        } else if (type == "TABLE") {
-            createTable(query);
-        } else {
-            cerr << "Unsupported CREATE command type: " << type << "\n";
-        }
-    } else if (command == "USE") {
-        useDatabase(query);
-    } else if (command == "INSERT") {
-        insertIntoTable(query);
-    } else if (command == "SELECT") {
-        selectFromTable(query);
-    } else if (command == "DELETE") {
-        deleteFromTable(query);
-    } else if (command == "COMMIT") {
-        commitDatabase();
-    } else {
-        cerr << "Unsupported command: " << command << "\n";
+size_t dbms::ResultCursor::columnCount() const { return state_ ? state_->result.columns.size() : 0; }
+const string& dbms::ResultCursor::columnName(size_t column) const { return state_->result.columns.at(column).name; }
+dbms::ValueType dbms::ResultCursor::columnType(size_t column) const { return valueType(state_->result.columns.at(column).type); }
+size_t dbms::ResultCursor::rowCount() const { return state_ ? state_->result.rows : 0; }
+
+bool dbms::ResultCursor::next() {
+    if (!state_) return false;
+    size_t next = state_->position == SIZE_MAX ? 0 : state_->position + 1;
+    if (next >= state_->result.rows) {
+        state_->position = state_->result.rows;
+        return false;
     }
+    state_->position = next;
+    return true;
 }
 
-int main() {
-    string query;
-    while (true) {
-        cout << "Enter SQL command (or 'exit' to quit): ";
-        getline(cin, query);
+bool dbms::ResultCursor::isNull(size_t column) const {
+    if (!state_ || state_->position >= state_->result.rows || column >= state_->result.columns.size()) return true;
+    return state_->cell(column, state_->result.columns[column].type) == nullptr;
+}
 
-        if (query == "exit") {
-            break;
+int64_t dbms::ResultCursor::getInt(size_t column) const {
+    const CursorColumn* cell = state_ ? state_->cell(column, ColumnType::Int) : nullptr;
+    if (cell == nullptr) return 0;
+    return cell->source ? cell->source->ints[state_->sourceRow(*cell)] : cell->computed.ints[state_->position];
+}
+
+double dbms::ResultCursor::getFloat(size_t column) const {
+    const CursorColumn* cell = state_ ? state_->cell(column, ColumnType::Float) : nullptr;
+    if (cell == nullptr) return 0;
+    return cell->source ? cell->source->floats[state_->sourceRow(*cell)] : cell->computed.floats[state_->position];
+}
+
+int32_t dbms::ResultCursor::getDate(size_t column) const {
+    const CursorColumn* cell = state_ ? state_->cell(column, ColumnType::Date) : nullptr;
+    return cell == nullptr ? 0 : cell->source->dates[state_->sourceRow(*cell)];
+}
+
+string_view dbms::ResultCursor::getString(size_t column) const {
+    const CursorColumn* cell = state_ ? state_->cell(column, ColumnType::String) : nullptr;
+    return cell == nullptr ? string_view() : cell->source->strings.get(state_->sourceRow(*cell));
+}
+
+void dbms::ResultCursor::close() { state_.reset(); }
+
+// 연결 하나의 세션 상태
+struct dbms::Connection::State {
+    ostream* out;
+    ostream* err;
+    string database;
+    unordered_map<string, PreparedStatement> prepared;
+
+    // 이 스레드의 현재 세션을 연결의 세션으로 바꿔 끼우고, 범위를 벗어나면 원래대로 돌려 놓는 객체
+    // (서버 워커가 클라이언트 세션을 바꿔 끼우는 것과 같음)
+    class Scope {
+    public:
+        Scope(State& session, ostream& out, ostream& err) : session_(session), out_(queryOut), err_(queryErr) {
+            currentDatabase.swap(session_.database);
+            preparedStatements.swap(session_.prepared);
+            queryOut = &out;
+            queryErr = &err;
         }
 
-        executeQuery(query);
+        ~Scope() {
+            queryOut = out_;
+            queryErr = err_;
+            preparedStatements.swap(session_.prepared);
+            currentDatabase.swap(session_.database);
+        }
+
+    private:
+        State& session_;
+        ostream* out_;
+        ostream* err_;
+    };
+};
+
+dbms::Connection::Connection(ostream& out, ostream& err) : state_(new State{&out, &err, string(), {}}) {}
+dbms::Connection::Connection(Connection&& other) noexcept = default;
+dbms::Connection& dbms::Connection::operator=(Connection&& other) noexcept = default;
+dbms::Connection::~Connection() = default;
+
+bool dbms::Connection::execute(const string& sql) {
+    CaptureBuffer errors(*state_->err, 0); // 오류 메시지는 그대로 넘기면서 바이트 수만 셈
+    ostream errorStream(&errors);
+    {
+        State::Scope scope(*state_, *state_->out, errorStream);
+        executeQuery(sql);
     }
+    errorStream.flush();
+    return errors.written() == 0;
+}
 
-    return 0;
+dbms::ResultCursor dbms::Connection::query(const string& sql) {
+    auto cursor = make_unique<ResultCursor::State>();
+    ostringstream errors;
+    auto start = chrono::steady_clock::now();
+    bool ok;
+    {
+        State::Scope scope(*state_, *state_->out, errors);
+        ok = cursor->open(sql);
+    }
+    if (!ok) {
+        cursor->release();
+        cursor->error = errors.str();
+        if (cursor->error.empty()) cursor->error = "ERROR: 쿼리를 실행하지 못했습니다.\n";
+        return ResultCursor(move(cursor));
+    }
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    statementLatency[static_cast<size_t>(StatementKind::Select)].record(static_cast<uint64_t>(elapsed));
+    return ResultCursor(move(cursor));
+}
+
+const string& dbms::Connection::database() const { return state_->database; }
+
+dbms::Database::Database(string name) : name_(move(name)) {}
+
+bool dbms::Database::load() const {
+    ostream discard(nullptr);
+    Connection connection(discard, discard);
+    return connection.execute("USE " + name_ + ";");
+}
+
+bool dbms::Database::unload() const { return unloadDatabase(name_); }
+
+dbms::Connection dbms::Database::connect(ostream& out, ostream& err) const {
+    Connection connection(out, err);
+    ostream discard(nullptr);
+    connection.state_->out = &discard; // USE의 안내 메시지는 쓰지 않음
+    connection.execute("USE " + name_ + ";");
+    connection.state_->out = &out;
+    return connection;
+}
+
+dbms::FileWriter::FileWriter(int fd, size_t bufferBytes) : fd_(fd), buffer_(max<size_t>(bufferBytes, 1)) {
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+}
+
+dbms::FileWriter::~FileWriter() { drain(); }
+
+dbms::FileWriter::int_type dbms::FileWriter::overflow(int_type c) {
+    if (!drain()) return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+// 버퍼보다 큰 덩어리는 버퍼를 비운 뒤 바로 씀
+streamsize dbms::FileWriter::xsputn(const char* data, streamsize count) {
+    if (count > epptr() - pptr()) {
+        if (!drain()) return 0;
+        if (static_cast<size_t>(count) >= buffer_.size()) {
+            size_t written = 0;
+            while (written < static_cast<size_t>(count)) {
+                ssize_t n = write(fd_, data + written, count - written);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    good_ = false;
+                    return static_cast<streamsize>(written);
+                }
+                written += static_cast<size_t>(n);
+            }
+            return count;
+        }
+    }
+    memcpy(pptr(), data, static_cast<size_t>(count));
+    pbump(static_cast<int>(count));
+    return count;
+}
+
+int dbms::FileWriter::sync() { return drain() ? 0 : -1; }
+
+bool dbms::FileWriter::drain() {
+    size_t pending = static_cast<size_t>(pptr() - pbase());
+    size_t written = 0;
+    while (written < pending && good_) {
+        ssize_t n = write(fd_, pbase() + written, pending - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) good_ = false;
+        else written += static_cast<size_t>(n);
+    }
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+    return good_;
 }
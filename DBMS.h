@@ -0,0 +1,164 @@
+// 미니 DBMS 엔진 라이브러리 (libdbms.a)의 공개 함수와 임베딩 API (dbms::Database / Connection / ResultCursor)
+// REPL / 서버 실행 파일(DBMS)과 벤치마크(DBMS_bench)가 이 헤더로 엔진을 사용함
+#ifndef DBMS_H
+#define DBMS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 쿼리 결과와 오류 메시지를 쓸 스트림 (스레드마다 따로, 기본값은 cout / cerr)
+extern thread_local std::ostream* queryOut;
+extern thread_local std::ostream* queryErr;
+
+// 병렬 스캔 스레드 수 (SET THREADS n과 같음)
+extern size_t scanThreads;
+
+// 쿼리 문자열을 세미콜론마다 파싱해 차례로 실행하는 함수
+void executeQuery(const std::string& query);
+
+// 메모리에 로드된 데이터베이스를 내리는 함수 (파일은 그대로, 다음 USE가 파일에서 다시 로드)
+// 로드되어 있지 않으면 false
+bool unloadDatabase(const std::string& dbName);
+
+// 텍스트 형식 .mydb 파일을 바이너리 형식으로 변환하는 함수
+bool convertDatabase(const std::string& dbName);
+
+// 정수 텍스트를 int64_t로 변환하는 함수 (범위를 벗어나면 실패)
+bool parseInt(std::string_view text, int64_t& out);
+
+// 서버 모드 / 부하 생성기 / 병렬 스캔과 조건 평가 처리량 측정 (반환값은 프로세스 종료 코드)
+int runServer(const std::string& address, size_t workerCount);
+int runLoadGenerator(const std::string& address, size_t clients, double seconds, const std::string& database,
+                     const std::vector<std::string>& queries);
+int benchmarkScan(size_t rowCount);
+int benchmarkPredicates(size_t rowCount);
+
+// ---- 임베딩 API ----
+// 같은 프로세스 안에서 엔진을 쓰는 클래스들 (엔진의 데이터베이스 저장소는 프로세스에 하나)
+//
+//   dbms::Connection connection = dbms::Database("testDB").connect();
+//   dbms::ResultCursor cursor = connection.query("SELECT id, name FROM users WHERE age > 30;");
+//   while (cursor.next()) use(cursor.getInt(0), cursor.getString(1));
+namespace dbms {
+
+enum class ValueType { Int, Float, Date, String };
+
+// SELECT 결과를 한 행씩 읽는 커서
+// 테이블 열의 값은 복사하지 않고 실행할 때의 스냅샷을 그대로 가리킴 (getString은 테이블 저장 공간의 view)
+// 잠금은 실행하는 동안만 잡고, 열린 커서는 실행할 때의 스냅샷 버퍼만 붙잡음: 그동안 다른 문장을 실행해도 되지만
+// 이후 테이블에 추가되는 행 때문에 버퍼가 복사될 수 있으므로 다 읽으면 바로 닫을 것 (소멸 또는 close), 만든 스레드에서만 사용
+class ResultCursor {
+public:
+    ResultCursor();
+    ResultCursor(ResultCursor&& other) noexcept;
+    ResultCursor& operator=(ResultCursor&& other) noexcept;
+    ~ResultCursor();
+
+    // 실행에 성공했는지, 실패했으면 그 오류 메시지
+    bool ok() const;
+    const std::string& error() const;
+
+    // 결과 열 이름 (REPL 헤더와 같음) / 타입과 결과 행 수
+    size_t columnCount() const;
+    const std::string& columnName(size_t column) const;
+    ValueType columnType(size_t column) const;
+    size_t rowCount() const;
+
+    // 다음 행으로 이동 (처음 호출하면 첫 행), 더 없으면 false
+    bool next();
+
+    // 현재 행의 값 (값이 없는 집계 결과는 NULL, 열 타입과 다른 함수로 읽으면 0 또는 빈 문자열)
+    bool isNull(size_t column) const;
+    int64_t getInt(size_t column) const;
+    double getFloat(size_t column) const;
+    int32_t getDate(size_t column) const;               // YYYYMMDD (예: 20240601)
+    std::string_view getString(size_t column) const;   // 커서가 열려 있는 동안 유효
+
+    // 스냅샷 버퍼를 놓음 (이후에는 빈 커서)
+    void close();
+
+private:
+    struct State;
+    explicit ResultCursor(std::unique_ptr<State> state);
+    std::unique_ptr<State> state_;
+    friend class Connection;
+};
+
+// 세션 하나: 현재 데이터베이스와 준비된 문장을 연결마다 따로 가짐 (서버 모드의 클라이언트 연결과 같음)
+// 쿼리 결과 텍스트와 오류 메시지는 만들 때 준 스트림에 씀
+// 한 연결은 한 번에 한 스레드에서만 사용
+class Connection {
+public:
+    explicit Connection(std::ostream& out = std::cout, std::ostream& err = std::cerr);
+    Connection(Connection&& other) noexcept;
+    Connection& operator=(Connection&& other) noexcept;
+    ~Connection();
+
+    // 쿼리 문자열의 문장들을 차례로 실행 (REPL에 입력한 한 줄과 같음), 오류 메시지가 나오지 않았으면 true
+    bool execute(const std::string& sql);
+
+    // SELECT 문장 하나 (또는 준비된 SELECT의 EXECUTE)를 실행해 텍스트 대신 커서로 돌려줌
+    ResultCursor query(const std::string& sql);
+
+    // 현재 데이터베이스 이름 (없으면 빈 문자열)
+    const std::string& database() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+    friend class Database;
+};
+
+// 이름으로 가리키는 데이터베이스 (<name>.mydb 파일과 그 로그)
+class Database {
+public:
+    explicit Database(std::string name);
+
+    const std::string& name() const { return name_; }
+
+    // 메모리에 로드 (이미 로드되어 있으면 그대로), 파일이 없거나 읽지 못하면 false
+    bool load() const;
+
+    // 메모리에서 내림 (파일은 그대로), 로드되어 있지 않았으면 false
+    bool unload() const;
+
+    // 이 데이터베이스를 현재 데이터베이스로 둔 새 연결 (로드에 실패하면 오류를 err에 쓰고 현재 데이터베이스가 없는 연결)
+    Connection connect(std::ostream& out = std::cout, std::ostream& err = std::cerr) const;
+
+private:
+    std::string name_;
+};
+
+// 파일 디스크립터에 큰 버퍼로 모아 쓰는 출력 버퍼 (배치 모드에서 결과를 작게 나눠 쓰는 시스템 호출을 줄임)
+// 버퍼가 가득 차거나 flush / 소멸할 때만 write 시스템 호출, 디스크립터는 닫지 않음
+class FileWriter : public std::streambuf {
+public:
+    explicit FileWriter(int fd, size_t bufferBytes = 1 << 20);
+    ~FileWriter() override;
+
+    // 쓰기에 실패한 적이 있으면 false
+    bool good() const { return good_; }
+
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+    int sync() override;
+
+private:
+    bool drain();
+
+    int fd_;
+    std::vector<char> buffer_;
+    bool good_ = true;
+};
+
+} // namespace dbms
+
+#endif
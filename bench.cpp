@@ -0,0 +1,607 @@
+// 미니 DBMS 벤치마크: 합성 users / orders 테이블을 만들어 엔진의 각 작업 시간을 재고 결과를 JSON으로 출력
+// 같은 시드와 옵션이면 같은 데이터와 같은 쿼리를 실행하므로, 버전별 결과 파일을 --compare로 비교해 성능 저하를 찾음
+//
+// ./DBMS_bench [--rows 1000,10000,...] [--seed n] [--queries n] [--threads n] [--clients 1,2,4,...] [--commits n]
+//              [--dir path] [--out file.json]
+// ./DBMS_bench --compare old.json new.json [--threshold 0.1]
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "DBMS.h"
+
+using namespace std;
+
+// orders 행 수의 기본 목록 (users는 orders의 1/10)
+const vector<int64_t> kDefaultRows = {1000, 10000, 100000, 1000000};
+const int64_t kMaxRows = 100000000;
+const size_t kInsertBatchRows = 100;  // 여러 행 INSERT 한 문장의 행 수
+const size_t kMaxInsertRows = 100000; // INSERT 처리량을 잴 때 넣는 최대 행 수
+const double kNoiseMs = 0.05;         // 비교할 때 이보다 작은 ms 차이는 저하로 보지 않음
+const vector<int64_t> kDefaultClients = {1, 2, 4, 8, 16, 32}; // 동시 커밋 측정의 클라이언트 수 기본 목록
+const int64_t kMaxClients = 1024;
+
+// 벤치마크 설정 (결과 파일의 config에 그대로 기록)
+struct BenchConfig {
+    vector<int64_t> rows = kDefaultRows;
+    uint64_t seed = 42;
+    size_t queries = 1000; // 점 조회 / 점 삭제 횟수 (범위 조회는 1/10)
+    size_t threads = 0;    // 0이면 엔진 기본값
+    vector<int64_t> clients = kDefaultClients;
+    size_t commits = 200;  // 동시 커밋 측정에서 클라이언트 하나가 하는 커밋 횟수
+    string dir;            // 데이터 파일을 만들 디렉터리 (비어 있으면 /tmp 아래 임시 디렉터리)
+    string out;            // 결과 JSON 파일 (비어 있으면 표준 출력)
+};
+
+// 시드로 정해지는 난수 (xorshift64*)
+class BenchRandom {
+public:
+    explicit BenchRandom(uint64_t seed) : state_(seed * 0x9e3779b97f4a7c15ull + 1) {}
+
+    uint64_t next() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 0x2545f4914f6cdd1dull;
+    }
+
+    // [0, bound) 범위의 정수
+    uint64_t below(uint64_t bound) { return next() % bound; }
+
+private:
+    uint64_t state_;
+};
+
+// 받은 바이트를 버리는 출력 버퍼 (결과를 만드는 비용은 그대로 재고 출력만 생략)
+class DiscardBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c == EOF ? 0 : c; }
+    streamsize xsputn(const char*, streamsize count) override { return count; }
+};
+
+// 벤치마크 하나의 실행: 쿼리 결과는 버리고, 오류 메시지가 나오면 그 쿼리와 함께 실패로 처리
+class BenchSession {
+public:
+    BenchSession() : out_(&discard_) {
+        queryOut = &out_;
+        queryErr = &errors_;
+    }
+
+    ~BenchSession() {
+        queryOut = &cout;
+        queryErr = &cerr;
+    }
+
+    // 쿼리 하나를 실행하고 걸린 시간(ms)을 돌려줌
+    double run(const string& query) {
+        auto start = chrono::steady_clock::now();
+        executeQuery(query);
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (!errors_.str().empty()) throw runtime_error(query.substr(0, 200) + " -> " + errors_.str());
+        return elapsed;
+    }
+
+private:
+    DiscardBuffer discard_;
+    ostream out_;
+    ostringstream errors_;
+};
+
+// 지연 시간 목록의 요약 (ms)
+struct LatencySummary {
+    double p50 = 0;
+    double p99 = 0;
+    double mean = 0;
+};
+
+LatencySummary summarize(vector<double> samples) {
+    LatencySummary summary;
+    if (samples.empty()) return summary;
+    sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) { return samples[min(samples.size() - 1, static_cast<size_t>(p * samples.size()))]; };
+    summary.p50 = percentile(0.50);
+    summary.p99 = percentile(0.99);
+    for (double sample : samples) summary.mean += sample;
+    summary.mean /= samples.size();
+    return summary;
+}
+
+// 결과 한 줄 (이름 순서를 유지하는 측정값 목록)
+class BenchResult {
+public:
+    void add(const string& name, double value) { metrics_.emplace_back(name, value); }
+
+    void addLatency(const string& prefix, const LatencySummary& summary) {
+        add(prefix + "_p50_ms", summary.p50);
+        add(prefix + "_p99_ms", summary.p99);
+        add(prefix + "_mean_ms", summary.mean);
+    }
+
+    // {"key":N,"metric":value,...} 한 줄 (key는 rows 또는 clients)
+    string json(const string& key, int64_t keyValue) const {
+        string line = "{\"" + key + "\":" + to_string(keyValue);
+        char value[64];
+        for (const auto& metric : metrics_) {
+            snprintf(value, sizeof(value), "%.4f", metric.second);
+            line += ",\"" + metric.first + "\":" + value;
+        }
+        return line + "}";
+    }
+
+private:
+    vector<pair<string, double>> metrics_;
+};
+
+// 표준 출력을 /dev/null로 돌려 두고 query의 결과를 cout에 쓰는 시간 (ms, 예전 REPL이 결과를 쓰던 경로)
+double runToStdout(const string& query) {
+    cout.flush();
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    if (saved < 0 || null < 0) throw runtime_error("/dev/null을 열 수 없습니다.");
+    dup2(null, STDOUT_FILENO);
+    close(null);
+    ostream* out = queryOut;
+    queryOut = &cout;
+    auto start = chrono::steady_clock::now();
+    executeQuery(query);
+    cout.flush();
+    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    queryOut = out;
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    return elapsed;
+}
+
+// 파일 크기 (없으면 0)
+uint64_t fileSize(const string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+}
+
+// users(id, name, age, country)와 orders(order_id, user_id, amount, status, day) CSV를 만드는 함수
+// 같은 시드면 같은 내용, order_id와 id는 1부터 차례로 (zone map으로 잘 건너뛸 수 있는 열)
+bool writeCsvFiles(int64_t orderRows, int64_t userRows, uint64_t seed, const string& usersPath, const string& ordersPath) {
+    static const char* const countries[] = {"KR", "US", "JP", "DE", "FR", "BR", "IN", "GB"};
+    static const char* const statuses[] = {"paid", "shipped", "pending", "cancel"};
+    BenchRandom random(seed);
+    string buffer;
+    buffer.reserve(1 << 20);
+    auto flushTo = [&](FILE* file, bool force) {
+        if (!force && buffer.size() < (1 << 20) - 256) return true;
+        bool ok = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        buffer.clear();
+        return ok;
+    };
+
+    FILE* users = fopen(usersPath.c_str(), "w");
+    if (users == nullptr) return false;
+    bool ok = true;
+    char line[160];
+    for (int64_t id = 1; id <= userRows && ok; ++id) {
+        int length = snprintf(line, sizeof(line), "%lld,\"user%llu\",%llu,\"%s\"\n", static_cast<long long>(id),
+                              static_cast<unsigned long long>(random.below(1000000)), static_cast<unsigned long long>(18 + random.below(63)),
+                              countries[random.below(8)]);
+        buffer.append(line, length);
+        ok = flushTo(users, false);
+    }
+    ok = flushTo(users, true) && ok;
+    ok = fclose(users) == 0 && ok;
+
+    FILE* orders = fopen(ordersPath.c_str(), "w");
+    if (orders == nullptr) return false;
+    for (int64_t id = 1; id <= orderRows && ok; ++id) {
+        uint64_t day = random.below(365);
+        int length = snprintf(line, sizeof(line), "%lld,%llu,%llu.%02llu,\"%s\",2024-%02llu-%02llu\n", static_cast<long long>(id),
+                              static_cast<unsigned long long>(1 + random.below(userRows)), static_cast<unsigned long long>(random.below(1000)),
+                              static_cast<unsigned long long>(random.below(100)), statuses[random.below(4)],
+                              static_cast<unsigned long long>(1 + day / 31 % 12), static_cast<unsigned long long>(1 + day % 28));
+        buffer.append(line, length);
+        ok = flushTo(orders, false);
+    }
+    ok = flushTo(orders, true) && ok;
+    ok = fclose(orders) == 0 && ok;
+    return ok;
+}
+
+// orders 행 수 하나에 대해 전체 작업을 실행하고 측정값을 돌려주는 함수
+// 순서: COPY → COMMIT → CHECKPOINT → 인덱스 → INSERT → COMMIT → 점 / 범위 SELECT → SELECT * → 캐시한 SELECT → DELETE
+//       → CHECKPOINT → LOAD
+BenchResult runBenchmark(const BenchConfig& config, int64_t orderRows) {
+    int64_t userRows = max<int64_t>(1, orderRows / 10);
+    string dbName = "bench" + to_string(orderRows);
+    string usersPath = dbName + "_users.csv";
+    string ordersPath = dbName + "_orders.csv";
+    BenchResult result;
+    result.add("users", static_cast<double>(userRows));
+
+    auto generateStart = chrono::steady_clock::now();
+    if (!writeCsvFiles(orderRows, userRows, config.seed, usersPath, ordersPath)) {
+        throw runtime_error("CSV 파일을 쓰지 못했습니다: " + ordersPath);
+    }
+    result.add("generate_ms", chrono::duration<double, milli>(chrono::steady_clock::now() - generateStart).count());
+
+    BenchSession session;
+    BenchRandom random(config.seed ^ static_cast<uint64_t>(orderRows));
+    unlink((dbName + ".mydb").c_str());
+    session.run("CREATE DATABASE " + dbName + "; USE " + dbName + ";");
+    session.run("CREATE TABLE users (int)id, (string)name, (int)age, (string)country;");
+    session.run("CREATE TABLE orders (int)order_id, (int)user_id, (float)amount, (string)status, (date)day;");
+
+    // 대량 입력과 그 커밋 / 체크포인트
+    double copyMs = session.run("COPY users FROM '" + usersPath + "';");
+    copyMs += session.run("COPY orders FROM '" + ordersPath + "';");
+    result.add("copy_rows_per_sec", (orderRows + userRows) / (copyMs / 1000));
+    result.add("copy_commit_ms", session.run("COMMIT;"));
+    result.add("checkpoint_ms", session.run("CHECKPOINT;"));
+    result.add("create_index_ms", session.run("CREATE INDEX idx_orders_id ON orders (order_id);"));
+
+    // INSERT: 한 행짜리 문장과 여러 행 문장, 이어서 그 로그를 커밋
+    int64_t nextId = orderRows + 1;
+    auto orderValues = [&](int64_t id) {
+        return to_string(id) + ", " + to_string(1 + random.below(userRows)) + ", " + to_string(random.below(1000)) + ".5, \"paid\", 2024-06-01";
+    };
+    size_t insertRows = min<size_t>(static_cast<size_t>(orderRows), kMaxInsertRows);
+    size_t singleRows = max<size_t>(1, insertRows / 10);
+    double insertMs = 0;
+    for (size_t i = 0; i < singleRows; ++i) insertMs += session.run("INSERT INTO orders VALUES (" + orderValues(nextId++) + ");");
+    result.add("insert_rows_per_sec", singleRows / (insertMs / 1000));
+    double batchMs = 0;
+    size_t batchRows = 0;
+    while (batchRows < insertRows) {
+        string query = "INSERT INTO orders VALUES ";
+        size_t count = min(kInsertBatchRows, insertRows - batchRows);
+        for (size_t i = 0; i < count; ++i) query += (i > 0 ? ", (" : "(") + orderValues(nextId++) + ")";
+        batchMs += session.run(query + ";");
+        batchRows += count;
+    }
+    result.add("insert_batch_rows_per_sec", batchRows / (batchMs / 1000));
+    uint64_t walBefore = fileSize(dbName + ".wal");
+    result.add("commit_ms", session.run("COMMIT;"));
+    result.add("commit_bytes", static_cast<double>(fileSize(dbName + ".wal") - walBefore));
+
+    // 점 조회: 인덱스가 있는 orders.order_id와 인덱스 없이 zone map만 쓰는 users.id
+    vector<double> samples;
+    for (size_t i = 0; i < config.queries; ++i) {
+        samples.push_back(session.run("SELECT * FROM orders WHERE order_id = " + to_string(1 + random.below(orderRows)) + ";"));
+    }
+    result.addLatency("point_select", summarize(samples));
+    samples.clear();
+    for (size_t i = 0; i < config.queries; ++i) {
+        samples.push_back(session.run("SELECT * FROM users WHERE id = " + to_string(1 + random.below(userRows)) + ";"));
+    }
+    result.addLatency("point_scan", summarize(samples));
+
+    // 범위 조회: 전체를 스캔하는 집계 (amount 5% 구간)와 인덱스 범위로 행 1000개를 돌려주는 조회
+    size_t rangeQueries = max<size_t>(1, config.queries / 10);
+    samples.clear();
+    for (size_t i = 0; i < rangeQueries; ++i) {
+        uint64_t low = random.below(950);
+        samples.push_back(session.run("SELECT status, COUNT(*), SUM(amount) FROM orders WHERE amount >= " + to_string(low) +
+                                      " AND amount < " + to_string(low + 50) + " GROUP BY status;"));
+    }
+    result.addLatency("range_aggregate", summarize(samples));
+    samples.clear();
+    for (size_t i = 0; i < rangeQueries; ++i) {
+        int64_t low = 1 + static_cast<int64_t>(random.below(max<int64_t>(1, orderRows - 1000)));
+        samples.push_back(session.run("SELECT * FROM orders WHERE order_id >= " + to_string(low) + " AND order_id < " +
+                                      to_string(low + 1000) + ";"));
+    }
+    result.addLatency("range_select", summarize(samples));
+
+    // SELECT * 전체: cout에 쓰는 경로, 배치 모드의 큰 버퍼 writer (dbms::FileWriter), 텍스트 없이 커서로 읽는 경로
+    {
+        const string selectAll = "SELECT * FROM orders;";
+        ostringstream errors;
+        int null = open("/dev/null", O_WRONLY);
+        if (null < 0) throw runtime_error("/dev/null을 열 수 없습니다.");
+        dbms::FileWriter writer(null);
+        ostream out(&writer);
+        dbms::Connection connection(out, errors);
+        connection.execute("USE " + dbName + ";");
+
+        auto start = chrono::steady_clock::now();
+        dbms::ResultCursor cursor = connection.query(selectAll);
+        uint64_t checksum = 0;
+        while (cursor.next()) checksum += static_cast<uint64_t>(cursor.getInt(0)) + cursor.getString(3).size();
+        double cursorMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        size_t rows = cursor.rowCount();
+        if (!cursor.ok() || checksum == 0) throw runtime_error(selectAll + " -> " + cursor.error());
+        cursor.close();
+
+        start = chrono::steady_clock::now();
+        connection.execute(selectAll);
+        out.flush();
+        double batchMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        close(null);
+        if (!errors.str().empty()) throw runtime_error(selectAll + " -> " + errors.str());
+
+        result.add("select_all_cout_rows_per_sec", rows / (runToStdout(selectAll) / 1000));
+        result.add("select_all_batch_rows_per_sec", rows / (batchMs / 1000));
+        result.add("select_all_cursor_rows_per_sec", rows / (cursorMs / 1000));
+    }
+
+    // 결과 캐시: 같은 전체 집계를 반복 (처음 한 번만 스캔하고 나머지는 저장된 출력)
+    session.run("SET RESULT_CACHE 64;");
+    samples.clear();
+    for (size_t i = 0; i < rangeQueries; ++i) {
+        samples.push_back(session.run("SELECT status, COUNT(*), SUM(amount) FROM orders GROUP BY status;"));
+    }
+    result.addLatency("cached_aggregate", summarize(samples));
+    session.run("SET RESULT_CACHE 0;");
+
+    // DELETE: 점 삭제 여러 번과 1% 범위 삭제 한 번
+    samples.clear();
+    for (size_t i = 0; i < config.queries; ++i) {
+        samples.push_back(session.run("DELETE FROM orders WHERE order_id = " + to_string(1 + random.below(orderRows)) + ";"));
+    }
+    result.addLatency("delete", summarize(samples));
+    int64_t rangeStart = 1 + static_cast<int64_t>(random.below(static_cast<uint64_t>(orderRows)));
+    result.add("delete_range_ms", session.run("DELETE FROM orders WHERE order_id >= " + to_string(rangeStart) + " AND order_id < " +
+                                              to_string(rangeStart + max<int64_t>(1, orderRows / 100)) + ";"));
+    session.run("COMMIT;");
+
+    // LOAD: 체크포인트한 파일을 메모리에서 내린 뒤 다시 열고, 처음 전체 스캔하는 시간
+    session.run("CHECKPOINT;");
+    unloadDatabase(dbName);
+    result.add("load_ms", session.run("USE " + dbName + ";"));
+    result.add("first_scan_ms", session.run("SELECT COUNT(*), SUM(amount) FROM orders;"));
+
+    unloadDatabase(dbName);
+    for (const string& path : {dbName + ".mydb", dbName + ".wal", usersPath, ordersPath}) unlink(path.c_str());
+    return result;
+}
+
+// 클라이언트 수 하나에 대해 동시 커밋 처리량을 재는 함수
+// 클라이언트마다 스레드 하나가 INSERT 한 행 + COMMIT을 반복함 (SYNC와 ASYNC 커밋 모드를 차례로)
+BenchResult runCommitBenchmark(const BenchConfig& config, int64_t clients) {
+    const string dbName = "benchcommit";
+    BenchResult result;
+    for (const string mode : {"sync", "async"}) {
+        unlink((dbName + ".mydb").c_str());
+        unlink((dbName + ".wal").c_str());
+        BenchSession session;
+        session.run("CREATE DATABASE " + dbName + "; USE " + dbName + ";");
+        session.run("CREATE TABLE events (int)id, (int)client;");
+        session.run("SET COMMIT_MODE " + mode + ";");
+
+        vector<vector<double>> latencies(static_cast<size_t>(clients));
+        vector<string> errors(static_cast<size_t>(clients));
+        atomic<int64_t> nextId{1};
+        vector<thread> workers;
+        auto start = chrono::steady_clock::now();
+        for (int64_t client = 0; client < clients; ++client) {
+            workers.emplace_back([&, client] {
+                try {
+                    BenchSession worker;
+                    worker.run("USE " + dbName + ";");
+                    auto& samples = latencies[static_cast<size_t>(client)];
+                    for (size_t i = 0; i < config.commits; ++i) {
+                        worker.run("INSERT INTO events VALUES (" + to_string(nextId++) + ", " + to_string(client) + ");");
+                        samples.push_back(worker.run("COMMIT;"));
+                    }
+                } catch (const exception& e) {
+                    errors[static_cast<size_t>(client)] = e.what();
+                }
+            });
+        }
+        for (thread& worker : workers) worker.join();
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        for (const string& error : errors) {
+            if (!error.empty()) throw runtime_error(error);
+        }
+
+        vector<double> samples;
+        for (const auto& client : latencies) samples.insert(samples.end(), client.begin(), client.end());
+        result.add(mode + "_commits_per_sec", samples.size() / (elapsedMs / 1000));
+        result.addLatency(mode + "_commit", summarize(samples));
+
+        session.run("SET COMMIT_MODE SYNC;");
+        unloadDatabase(dbName);
+    }
+    unlink((dbName + ".mydb").c_str());
+    unlink((dbName + ".wal").c_str());
+    return result;
+}
+
+// 결과 JSON 파일에서 ("rows=N" 또는 "clients=N", 측정값 이름) → 값을 읽는 함수
+// (이 프로그램이 쓴 형식: results / commit_results의 한 줄에 결과 하나, 첫 필드가 그 줄의 키)
+bool readResults(const string& path, vector<pair<string, double>>& values) {
+    ifstream file(path);
+    if (!file.is_open()) return false;
+    string line;
+    while (getline(file, line)) {
+        size_t begin = line.find("{\"");
+        if (begin == string::npos || line.compare(begin, 14, "{\"benchmark\":\"") == 0) continue;
+        string key;
+        size_t pos = begin + 1;
+        while (pos < line.size() && line[pos] == '"') {
+            size_t nameEnd = line.find('"', pos + 1);
+            if (nameEnd == string::npos || nameEnd + 1 >= line.size() || line[nameEnd + 1] != ':') return false;
+            string name = line.substr(pos + 1, nameEnd - pos - 1);
+            size_t valueEnd = line.find_first_of(",}", nameEnd + 2);
+            if (valueEnd == string::npos) return false;
+            string value = line.substr(nameEnd + 2, valueEnd - nameEnd - 2);
+            if (key.empty()) {
+                key = name + "=" + value;
+            } else {
+                values.emplace_back(key + "\t" + name, strtod(value.c_str(), nullptr));
+            }
+            pos = valueEnd + 1;
+        }
+    }
+    return true;
+}
+
+// ./DBMS_bench --compare old.json new.json: 같은 키(행 수 / 클라이언트 수)의 측정값을 비교해 threshold보다 나빠진 항목을 표시
+// _per_sec는 클수록, _ms는 작을수록 좋은 값 (그 외 항목은 비교하지 않음). 저하가 하나라도 있으면 종료 코드 1
+int compareResults(const string& oldPath, const string& newPath, double threshold) {
+    vector<pair<string, double>> before, after;
+    if (!readResults(oldPath, before) || !readResults(newPath, after)) {
+        cerr << "ERROR: 결과 파일을 읽지 못했습니다: " << oldPath << ", " << newPath << "\n";
+        return 1;
+    }
+    size_t regressions = 0;
+    cout << "key\tmetric\told\tnew\tchange\t\n";
+    for (const auto& entry : after) {
+        const string& key = entry.first;
+        string name = key.substr(key.find('\t') + 1);
+        bool higherBetter = name.size() > 8 && name.compare(name.size() - 8, 8, "_per_sec") == 0;
+        bool lowerBetter = name.size() > 3 && name.compare(name.size() - 3, 3, "_ms") == 0;
+        if (!higherBetter && !lowerBetter) continue;
+        auto old = find_if(before.begin(), before.end(), [&](const pair<string, double>& e) { return e.first == key; });
+        if (old == before.end() || old->second <= 0) continue;
+        double change = entry.second / old->second - 1;
+        bool worse = higherBetter ? change < -threshold : change > threshold && entry.second - old->second > kNoiseMs;
+        regressions += worse;
+        char text[160];
+        snprintf(text, sizeof(text), "%s\t%.4f\t%.4f\t%+.1f%%\t%s\n", key.c_str(), old->second, entry.second, change * 100,
+                 worse ? "REGRESSION" : "");
+        cout << text;
+    }
+    cout << "regressions: " << regressions << " (threshold " << threshold * 100 << "%)\n";
+    return regressions > 0 ? 1 : 0;
+}
+
+// 쉼표로 나눈 정수 목록 (행 수 / 클라이언트 수)을 읽는 함수
+bool parseCountList(const string& text, int64_t limit, vector<int64_t>& counts) {
+    counts.clear();
+    stringstream stream(text);
+    string item;
+    while (getline(stream, item, ',')) {
+        int64_t value;
+        if (!parseInt(item, value) || value < 1 || value > limit) return false;
+        counts.push_back(value);
+    }
+    return !counts.empty();
+}
+
+int usage() {
+    cerr << "Usage: ./DBMS_bench [--rows 1000,10000,...] [--seed n] [--queries n] [--threads n] [--clients 1,2,4,...] [--commits n]\n"
+            "                    [--dir path] [--out file.json]\n"
+            "       ./DBMS_bench --compare old.json new.json [--threshold 0.1]\n"
+            "rows: orders 행 수 (1 ~ " << kMaxRows << ", users는 1/10)\n"
+            "clients: 동시 커밋 측정의 클라이언트 수 (1 ~ " << kMaxClients << "), commits: 클라이언트 하나의 커밋 횟수\n";
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> args(argv + 1, argv + argc);
+    if (!args.empty() && args[0] == "--compare") {
+        double threshold = 0.1;
+        if (args.size() == 5 && args[3] == "--threshold") {
+            char* end = nullptr;
+            threshold = strtod(args[4].c_str(), &end);
+            if (*end != '\0' || threshold < 0) return usage();
+        } else if (args.size() != 3) {
+            return usage();
+        }
+        return compareResults(args[1], args[2], threshold);
+    }
+
+    BenchConfig config;
+    for (size_t i = 0; i < args.size(); i += 2) {
+        if (i + 1 >= args.size()) return usage();
+        const string& option = args[i];
+        const string& value = args[i + 1];
+        int64_t number = 0;
+        if (option == "--rows") {
+            if (!parseCountList(value, kMaxRows, config.rows)) return usage();
+        } else if (option == "--clients") {
+            if (!parseCountList(value, kMaxClients, config.clients)) return usage();
+        } else if (option == "--commits" && parseInt(value, number) && number > 0) {
+            config.commits = static_cast<size_t>(number);
+        } else if (option == "--seed" && parseInt(value, number) && number >= 0) {
+            config.seed = static_cast<uint64_t>(number);
+        } else if (option == "--queries" && parseInt(value, number) && number > 0) {
+            config.queries = static_cast<size_t>(number);
+        } else if (option == "--threads" && parseInt(value, number) && number > 0 && number <= 1024) {
+            config.threads = static_cast<size_t>(number);
+        } else if (option == "--dir") {
+            config.dir = value;
+        } else if (option == "--out") {
+            config.out = value;
+        } else {
+            return usage();
+        }
+    }
+    if (config.threads > 0) scanThreads = config.threads;
+
+    // 결과 파일 경로는 실행한 디렉터리 기준이므로 데이터 디렉터리로 옮기기 전에 엶
+    ofstream outFile;
+    if (!config.out.empty()) {
+        outFile.open(config.out);
+        if (!outFile.is_open()) {
+            cerr << "ERROR: " << config.out << " 파일을 열 수 없습니다.\n";
+            return 1;
+        }
+    }
+    ostream& out = config.out.empty() ? cout : outFile;
+
+    string dir = config.dir;
+    bool temporary = dir.empty();
+    if (temporary) {
+        char pattern[] = "/tmp/dbms_bench.XXXXXX";
+        if (mkdtemp(pattern) == nullptr) {
+            cerr << "ERROR: 임시 디렉터리를 만들 수 없습니다: " << strerror(errno) << "\n";
+            return 1;
+        }
+        dir = pattern;
+    }
+    if (chdir(dir.c_str()) != 0) {
+        cerr << "ERROR: " << dir << " 디렉터리로 이동할 수 없습니다: " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    out << "{\"benchmark\":\"mini_dbms\",\"config\":{\"seed\":" << config.seed << ",\"queries\":" << config.queries
+        << ",\"commits\":" << config.commits
+        << ",\"threads\":" << scanThreads << ",\"hardware_threads\":" << thread::hardware_concurrency()
+        << ",\"compiler\":\"" << __VERSION__ << "\",\"optimized\":" <<
+#ifdef __OPTIMIZE__
+        "true"
+#else
+        "false"
+#endif
+        << "},\n\"results\":[\n";
+    int status = 0;
+    for (size_t i = 0; i < config.rows.size(); ++i) {
+        cerr << "rows " << config.rows[i] << " ...\n";
+        try {
+            BenchResult result = runBenchmark(config, config.rows[i]);
+            out << (i > 0 ? ",\n" : "") << result.json("rows", config.rows[i]);
+            out.flush();
+        } catch (const exception& e) {
+            cerr << "ERROR: rows " << config.rows[i] << ": " << e.what() << "\n";
+            status = 1;
+            break;
+        }
+    }
+    out << "\n],\n\"commit_results\":[\n";
+    for (size_t i = 0; i < config.clients.size() && status == 0; ++i) {
+        cerr << "clients " << config.clients[i] << " ...\n";
+        try {
+            BenchResult result = runCommitBenchmark(config, config.clients[i]);
+            out << (i > 0 ? ",\n" : "") << result.json("clients", config.clients[i]);
+            out.flush();
+        } catch (const exception& e) {
+            cerr << "ERROR: clients " << config.clients[i] << ": " << e.what() << "\n";
+            status = 1;
+        }
+    }
+    out << "\n]}\n";
+    if (temporary) rmdir(dir.c_str());
+    return status;
+}
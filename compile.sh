@@ -1 +1,6 @@
-g++ -o DBMS DBMS.cpp -lssl -lcrypto
+# 엔진 라이브러리 (libdbms.a)
+g++ -std=c++17 -O2 -pthread -c -o DBMS.o DBMS.cpp
+ar rcs libdbms.a DBMS.o
+# REPL / 서버 실행 파일과 벤치마크
+g++ -std=c++17 -O2 -pthread -o DBMS main.cpp libdbms.a -lssl -lcrypto
+g++ -std=c++17 -O2 -pthread -o DBMS_bench bench.cpp libdbms.a
@@ -0,0 +1,98 @@
+// 미니 DBMS 실행 파일: REPL / 배치 스크립트와 서버 / 부하 생성기 / 변환 / 스캔 측정 모드
+// 엔진은 DBMS.cpp (libdbms.a)에 있고 DBMS.h의 함수와 dbms::Connection으로만 사용
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <unistd.h>
+#include "DBMS.h"
+
+using namespace std;
+
+// 입력의 쿼리를 한 줄씩 연결로 실행하는 함수 ('exit' 줄이나 입력 끝에서 멈춤)
+// prompt가 있으면 줄마다 먼저 출력, 오류 메시지가 나온 줄이 있었으면 false
+bool runLines(istream& input, dbms::Connection& connection, const char* prompt) {
+    bool ok = true;
+    string query;
+    while (true) {
+        if (prompt != nullptr) cout << prompt << flush;
+        if (!getline(input, query) || query == "exit") break;
+        ok = connection.execute(query) && ok;
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    // ./DBMS --convert <db> : 텍스트 형식 .mydb 파일을 바이너리 형식으로 변환
+    if (argc == 3 && string(argv[1]) == "--convert") {
+        return convertDatabase(argv[2]) ? 0 : 1;
+    }
+    // ./DBMS --bench-scan [rows] : 병렬 스캔 처리량 측정
+    if (argc >= 2 && string(argv[1]) == "--bench-scan") {
+        int64_t rows = 20000000;
+        if (argc == 3 && (!parseInt(argv[2], rows) || rows <= 0)) {
+            cerr << "Usage: ./DBMS --bench-scan [rows]\n";
+            return 1;
+        }
+        return benchmarkScan(static_cast<size_t>(rows));
+    }
+    // ./DBMS --bench-predicates [rows] : 조건 타입별 행 단위 평가 / 컴파일된 조건 처리량 비교
+    if (argc >= 2 && string(argv[1]) == "--bench-predicates") {
+        int64_t rows = 5000000;
+        if (argc == 3 && (!parseInt(argv[2], rows) || rows <= 0)) {
+            cerr << "Usage: ./DBMS --bench-predicates [rows]\n";
+            return 1;
+        }
+        return benchmarkPredicates(static_cast<size_t>(rows));
+    }
+
+    // ./DBMS --server <port | unix-socket-path> [workers] : 여러 클라이언트를 받는 서버 모드
+    if (argc >= 3 && string(argv[1]) == "--server") {
+        int64_t workers = max<int64_t>(1, thread::hardware_concurrency());
+        if (argc > 4 || (argc == 4 && (!parseInt(argv[3], workers) || workers <= 0))) {
+            cerr << "Usage: ./DBMS --server <port | unix-socket-path> [workers]\n";
+            return 1;
+        }
+        return runServer(argv[2], static_cast<size_t>(workers));
+    }
+    // ./DBMS --load <address> <clients> <seconds> <database> <query> [query ...] : 서버 부하 측정
+    if (argc >= 2 && string(argv[1]) == "--load") {
+        int64_t clients = 0, seconds = 0;
+        if (argc < 7 || !parseInt(argv[3], clients) || clients <= 0 || !parseInt(argv[4], seconds) || seconds <= 0) {
+            cerr << "Usage: ./DBMS --load <address> <clients> <seconds> <database> <query> [query ...]\n";
+            return 1;
+        }
+        return runLoadGenerator(argv[2], static_cast<size_t>(clients), static_cast<double>(seconds), argv[5], vector<string>(argv + 6, argv + argc));
+    }
+
+    // ./DBMS --batch <script.sql | -> : 스크립트의 쿼리를 프롬프트 없이 실행하고 결과는 큰 버퍼로 모아 표준 출력에 씀
+    // 오류가 난 줄이 있으면 종료 코드 1
+    if (argc >= 2 && string(argv[1]) == "--batch") {
+        if (argc != 3) {
+            cerr << "Usage: ./DBMS --batch <script.sql | ->\n";
+            return 1;
+        }
+        ifstream file;
+        string path = argv[2];
+        if (path != "-") {
+            file.open(path);
+            if (!file.is_open()) {
+                cerr << "ERROR: " << path << " 파일을 열 수 없습니다.\n";
+                return 1;
+            }
+        }
+        dbms::FileWriter writer(STDOUT_FILENO);
+        ostream out(&writer);
+        dbms::Connection connection(out, cerr);
+        bool ok = runLines(path == "-" ? cin : file, connection, nullptr);
+        out.flush();
+        return ok && writer.good() ? 0 : 1;
+    }
+
+    // REPL: 입력이 터미널일 때만 프롬프트를 출력 (파이프로 받은 입력은 배치처럼 실행)
+    dbms::Connection connection;
+    runLines(cin, connection, isatty(STDIN_FILENO) ? "Enter SQL command (or 'exit' to quit): " : nullptr);
+    return 0;
+}